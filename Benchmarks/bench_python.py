@@ -0,0 +1,185 @@
+#!/usr/bin/env python3
+#
+# Throughput and latency of log.info() from python: 1..N threads, several message sizes,
+# and the sink combinations of Examples/Two_Sinks.py. Results as JSON.
+#
+#   python3 Benchmarks/bench_python.py [--threads 1,2,4,8] [--sizes 16,256,4096] [--messages 20000]
+#                                      [--sinks logrotate,logrotate+colorterm,syslog+logrotate+colorterm]
+#                                      [--staging] [--out results.json] [--baseline old.json [--tolerance 0.1]]
+#
+# g3log can only be started once per process: each sink combination runs in its own child process.
+# capture: time spent in the log calls only. end_to_end: until logger.flush() returns (messages written).
+# The color terminal sink writes to stderr, redirected to /dev/null in the child processes.
+# With --baseline, the cases whose capture throughput dropped by more than the tolerance are listed,
+# and the exit status is 1.
+#
+
+import argparse
+import json
+import os
+import platform
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+SINKS = ("syslog", "logrotate", "colorterm", "binary")
+
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return 0.0
+    index = min(len(sorted_values) - 1, int(round(p / 100.0 * (len(sorted_values) - 1))))
+    return sorted_values[index]
+
+
+def run_case(log, logger, threads, size, messages):
+    """logs "messages" messages of "size" bytes from "threads" threads"""
+    message = "x" * size
+    per_thread = max(1, messages // threads)
+    latencies = [None] * threads
+    start_barrier = threading.Barrier(threads + 1)
+
+    def worker(index):
+        lat = []
+        clock = time.perf_counter_ns
+        info = log.info
+        start_barrier.wait()
+        for _ in range(per_thread):
+            t0 = clock()
+            info(message)
+            lat.append(clock() - t0)
+        latencies[index] = lat
+
+    pool = [threading.Thread(target=worker, args=(i,)) for i in range(threads)]
+    for thd in pool:
+        thd.start()
+    start_barrier.wait()
+    t0 = time.perf_counter()
+    for thd in pool:
+        thd.join()
+    capture = time.perf_counter() - t0
+    if not logger.flush(120.0):
+        raise RuntimeError("flush timeout")
+    end_to_end = time.perf_counter() - t0
+
+    merged = sorted(v for lat in latencies for v in lat)
+    total = per_thread * threads
+    return {
+        "threads": threads,
+        "size": size,
+        "messages": total,
+        "capture_msgs_per_s": total / capture,
+        "end_to_end_msgs_per_s": total / end_to_end,
+        "p50_us": percentile(merged, 50) / 1000.0,
+        "p99_us": percentile(merged, 99) / 1000.0,
+        "max_us": merged[-1] / 1000.0,
+    }
+
+
+def child(args):
+    import g3logPython as log
+    logger = log.get_ifaceLogWorker(False)
+    logdir = tempfile.mkdtemp(prefix="g3logBench_")
+    for sink in args.child.split("+"):
+        if sink == "syslog":
+            logger.SysLogSinks.new_Sink("bench syslog", "id=g3logBench")
+        elif sink == "logrotate":
+            logger.LogRotateSinks.new_Sink("bench logrotate", "g3logBench", logdir)
+        elif sink == "colorterm":
+            logger.ClrTermSinks.new_Sink("bench colorterm")
+        elif sink == "binary":
+            logger.BinSinks.new_Sink("bench binary", "g3logBench", logdir)
+        else:
+            raise ValueError("unknown sink " + sink)
+    if args.staging:
+        logger.startStaging(65536, 64 * 1024 * 1024)
+
+    results = []
+    for size in args.sizes:
+        for threads in args.threads:
+            case = run_case(log, logger, threads, size, args.messages)
+            case["sinks"] = args.child
+            case["staging"] = args.staging
+            results.append(case)
+    if args.staging:
+        logger.stopStaging()
+    json.dump(results, sys.stdout)
+    sys.stdout.flush()
+    for name in os.listdir(logdir):
+        os.remove(os.path.join(logdir, name))
+    os.rmdir(logdir)
+
+
+def case_key(case):
+    return (case["sinks"], case["staging"], case["threads"], case["size"])
+
+
+def compare(results, baseline_file, tolerance):
+    with open(baseline_file) as f:
+        baseline = {case_key(c): c for c in json.load(f)["results"]}
+    regressions = []
+    for case in results:
+        old = baseline.get(case_key(case))
+        if old is None:
+            continue
+        ratio = case["capture_msgs_per_s"] / old["capture_msgs_per_s"]
+        if ratio < 1.0 - tolerance:
+            regressions.append((case_key(case), ratio))
+    for key, ratio in regressions:
+        print("REGRESSION sinks=%s staging=%s threads=%d size=%d: %.0f%% of the baseline throughput" % (key + (ratio * 100,)))
+    return not regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description="g3logPython capture benchmark")
+    parser.add_argument("--threads", default="1,2,4,8", help="thread counts")
+    parser.add_argument("--sizes", default="16,256,4096", help="message sizes, in bytes")
+    parser.add_argument("--messages", type=int, default=20000, help="messages per case")
+    parser.add_argument("--sinks", default="logrotate,logrotate+colorterm,syslog+logrotate+colorterm",
+                        help="sink combinations (among %s, joined with +)" % ", ".join(SINKS))
+    parser.add_argument("--staging", action="store_true", help="asynchronous capture (startStaging)")
+    parser.add_argument("--out", default=None, help="JSON output file (default: stdout)")
+    parser.add_argument("--baseline", default=None, help="previous JSON results, to detect regressions")
+    parser.add_argument("--tolerance", type=float, default=0.1, help="throughput drop tolerated, relative")
+    parser.add_argument("--child", default=None, help=argparse.SUPPRESS)
+    args = parser.parse_args()
+    args.threads = [int(n) for n in args.threads.split(",")]
+    args.sizes = [int(n) for n in args.sizes.split(",")]
+
+    if args.child is not None:
+        child(args)
+        return 0
+
+    results = []
+    for combo in args.sinks.split(","):
+        cmd = [sys.executable, os.path.abspath(__file__), "--child", combo, "--threads", ",".join(map(str, args.threads)),
+               "--sizes", ",".join(map(str, args.sizes)), "--messages", str(args.messages)]
+        if args.staging:
+            cmd.append("--staging")
+        out = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.DEVNULL, check=True).stdout
+        # the module may print on stdout before the results: the JSON is the last line
+        results.extend(json.loads(out.decode().strip().splitlines()[-1]))
+
+    report = {
+        "python": platform.python_version(),
+        "machine": platform.machine(),
+        "cpus": os.cpu_count(),
+        "date": time.strftime("%Y-%m-%dT%H:%M:%S"),
+        "results": results,
+    }
+    text = json.dumps(report, indent=2)
+    if args.out:
+        with open(args.out, "w") as f:
+            f.write(text + "\n")
+    else:
+        print(text)
+
+    if args.baseline and not compare(results, args.baseline, args.tolerance):
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
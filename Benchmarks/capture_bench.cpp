@@ -0,0 +1,183 @@
+//
+// Benchmarks of the C++ side: capture path, sink handles, ThdStore, and the sinks' receive functions.
+// Google Benchmark. Build and run with run_cpp.sh (results as JSON).
+//
+// The color terminal sink writes to stderr, which is redirected to /dev/null once the benchmarks are parsed:
+// it is the "null" sink of the capture benchmarks. The file sinks write under /tmp/g3logBench.
+// The syslog sink is not measured: it always goes through the system logger.
+//
+
+#include "intern_log.h"
+#include "g3logPython.h"
+#include "staging.h"
+
+#include <benchmark/benchmark.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <future>
+#include <mutex>
+#include <string>
+
+namespace {
+
+const char *BenchDir = "/tmp/g3logBench/";
+
+std::shared_ptr<g3::ifaceLogWorker> worker()
+{
+static std::shared_ptr<g3::ifaceLogWorker> pworker = g3::ifaceLogWorker::get_ifaceLogWorker(false);
+return pworker;
+}
+
+g3::ClrTermSnkHndl &nullSink()
+{
+static g3::ClrTermSnkHndl hndl = worker() -> ClrTermSinks.new_Sink("bench null sink");
+return hndl;
+}
+
+// called by every thread of a benchmark: idempotent
+void setStaging(bool on)
+{
+static std::mutex lck;
+std::lock_guard<std::mutex> lock(lck);
+if(on && !g3::stagingRing().active()) worker() -> startStaging(65536, 64*1024*1024);
+if(!on && g3::stagingRing().active()) worker() -> stopStaging();
+}
+
+g3::LogMessage prototype(size_t size)
+{
+g3::LogMessage msg(__FILE__, __LINE__, "prototype", INFO);
+msg.write() = std::string(size, 'x');
+return msg;
+}
+
+// ----------------------------------------------------------------------------
+// capture path
+
+void BM_receivelog(benchmark::State &state, bool staging)
+{
+nullSink();
+setStaging(staging);
+g3::setMinLevel((int)g3::pyLEVEL::pyDEBUG);
+std::string message(state.range(0), 'm');
+for(auto _ : state) g3::receivelog(__FILE__, __LINE__, __func__, (int)g3::pyLEVEL::pyINFO, message.c_str());
+state.SetItemsProcessed(state.iterations());
+state.SetBytesProcessed(state.iterations() * state.range(0));
+worker() -> flush(); // not timed: the backlog doesn't leak into the next benchmark
+}
+BENCHMARK_CAPTURE(BM_receivelog, sync, false) -> RangeMultiplier(16) -> Range(16, 4096) -> ThreadRange(1, 8) -> UseRealTime();
+BENCHMARK_CAPTURE(BM_receivelog, staged, true) -> RangeMultiplier(16) -> Range(16, 4096) -> ThreadRange(1, 8) -> UseRealTime();
+
+void BM_receivelog_filtered(benchmark::State &state)
+{
+nullSink();
+setStaging(false);
+g3::setMinLevel((int)g3::pyLEVEL::pyWARNING);
+for(auto _ : state) g3::receivelog(__FILE__, __LINE__, __func__, (int)g3::pyLEVEL::pyDEBUG, "rejected");
+g3::setMinLevel((int)g3::pyLEVEL::pyDEBUG);
+state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_receivelog_filtered) -> ThreadRange(1, 8) -> UseRealTime();
+
+void BM_receivelog_fmt(benchmark::State &state)
+{
+nullSink();
+setStaging(true);
+for(auto _ : state) {
+    std::vector<g3::LogValue> args;
+    args.push_back(g3::LogValue::from_int(42));
+    args.push_back(g3::LogValue::from_double(1.5));
+    g3::receivelog_fmt(__FILE__, __LINE__, __func__, (int)g3::pyLEVEL::pyINFO, std::string("request %d took %.3f ms"), std::move(args));
+    }
+state.SetItemsProcessed(state.iterations());
+worker() -> flush();
+setStaging(false);
+}
+BENCHMARK(BM_receivelog_fmt) -> ThreadRange(1, 8) -> UseRealTime();
+
+// ----------------------------------------------------------------------------
+// sink handles: Ptr_Mnger::access() (shared lock), the call() through g3log, and ThdStore::store()
+// (Ptr_Mnger is private to the handle access classes: it is measured through a handle method)
+
+void BM_sink_handle_call(benchmark::State &state)
+{
+g3::ClrTermSnkHndl &hndl = nullSink();
+for(auto _ : state) benchmark::DoNotOptimize(hndl.setBufferPolicy(0, 0));
+state.SetItemsProcessed(state.iterations());
+hndl.flush().wait(-1);
+}
+BENCHMARK(BM_sink_handle_call) -> ThreadRange(1, 8) -> UseRealTime();
+
+void BM_ThdStore_store(benchmark::State &state)
+{
+static g3::ThdStore store;
+std::promise<void> done;
+done.set_value();
+std::shared_future<void> fut = done.get_future().share();
+for(auto _ : state) {
+    auto p_Data = g3::make_stored<g3::StoredForThd<void>>();
+    p_Data -> set_future(std::shared_future<void>(fut));
+    store.store(p_Data);
+    }
+state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ThdStore_store) -> ThreadRange(1, 8) -> UseRealTime();
+
+// ----------------------------------------------------------------------------
+// the sinks' receive functions, called directly (the LogMessage copy is measured by BM_LogMessage_copy)
+
+void BM_LogMessage_copy(benchmark::State &state)
+{
+g3::LogMessage proto = prototype(state.range(0));
+for(auto _ : state) {
+    g3::LogMessage msg(proto);
+    benchmark::DoNotOptimize(msg);
+    }
+state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LogMessage_copy) -> RangeMultiplier(16) -> Range(16, 4096);
+
+void BM_ColorTermSink(benchmark::State &state, size_t buffer)
+{
+g3::ColorTermSink sink;
+sink.setBufferPolicy(buffer, 100);
+g3::LogMessage proto = prototype(state.range(0));
+for(auto _ : state) sink.ReceiveLogMessage(g3::LogMessageMover(g3::LogMessage(proto)));
+state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(BM_ColorTermSink, unbuffered, 0) -> RangeMultiplier(16) -> Range(16, 4096);
+BENCHMARK_CAPTURE(BM_ColorTermSink, buffered, 64*1024) -> RangeMultiplier(16) -> Range(16, 4096);
+
+void BM_BinarySink(benchmark::State &state)
+{
+g3::BinarySink sink("bench", BenchDir);
+g3::LogMessage proto = prototype(state.range(0));
+for(auto _ : state) sink.ReceiveLogMessage(g3::LogMessageMover(g3::LogMessage(proto)));
+state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BinarySink) -> RangeMultiplier(16) -> Range(16, 4096);
+
+void BM_LogRotate(benchmark::State &state)
+{
+LogRotate sink("bench", BenchDir);
+g3::LogMessage proto = prototype(state.range(0));
+for(auto _ : state) sink.save(g3::LogMessage(proto).toString());
+state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LogRotate) -> RangeMultiplier(16) -> Range(16, 4096);
+
+} // anonymous namespace
+
+int main(int argc, char **argv)
+{
+benchmark::Initialize(&argc, argv);
+if(benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+
+int devnull = open("/dev/null", O_WRONLY);
+if(devnull >= 0) dup2(devnull, STDERR_FILENO); // the color terminal sink's output
+
+benchmark::RunSpecifiedBenchmarks();
+setStaging(false);
+return 0;
+}
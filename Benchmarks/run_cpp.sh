@@ -0,0 +1,27 @@
+#!/usr/bin/env bash
+#
+# builds and runs the C++ benchmarks (needs g3log, g3sinks, pybind11, and Google Benchmark)
+#   Benchmarks/run_cpp.sh [results.json] [google benchmark options, ex: --benchmark_filter=receivelog]
+#
+
+set -e
+here=`cd "$(dirname "$0")" && pwd`
+src="$here/../g3logPython"
+out=${1:-$here/results_cpp.json}
+shift || true
+
+mkdir -p "$here/build"
+# every source of the extension, but its pybind11 module definition
+sources=`ls "$src"/*.cpp | grep -v '/g3logPython.cpp$'`
+pyldflags=`python3-config --ldflags --embed 2>/dev/null || python3-config --ldflags`
+# the libraries of the extension (setup.py: libraries), then Google Benchmark: keep them in sync
+g++ -std=c++14 -O2 -DNDEBUG -I"$src" -I/usr/local/include `python3 -m pybind11 --includes` \
+    "$here/capture_bench.cpp" $sources -o "$here/build/capture_bench" \
+    -L/usr/local/lib -lg3logger -lg3logrotate -lg3log_syslog -lsystemd -lz -lbenchmark -lpthread $pyldflags
+
+export LD_LIBRARY_PATH=/usr/local/lib:$LD_LIBRARY_PATH
+rm -rf /tmp/g3logBench
+mkdir -p /tmp/g3logBench
+"$here/build/capture_bench" --benchmark_out="$out" --benchmark_out_format=json "$@"
+rm -rf /tmp/g3logBench
+echo "results: $out"
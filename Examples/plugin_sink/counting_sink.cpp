@@ -0,0 +1,55 @@
+//
+//  example of a sink plugin (see g3logPython/plugin.h): counts the messages per level
+//
+//    cd Examples/plugin_sink && python3 setup.py build_ext --inplace
+//
+//    import g3logPython, counting_sink
+//    sink = counting_sink.add("counter")   # a g3logPython.PluginSnkHndl
+//    sink.control("WARNING").result()      # number of warnings received
+//
+
+#include <g3logPython/plugin.h>
+
+#include <pybind11/pybind11.h>
+
+#include <map>
+#include <string>
+
+namespace {
+
+class CountingSink: public g3::plugin::Sink
+{
+public:
+    // receive() and control() both run on the sink's thread: no lock
+    void receive(g3::LogMessageMover msg) override {
+        ++_counts[msg.get().level()];
+        ++_total;
+        };
+
+    // "total", or a level name: the number of messages received
+    std::string control(const std::string &command) override {
+        if(command == "total") return std::to_string(_total);
+        if(command == "reset") {_counts.clear(); _total = 0; return std::string();}
+        auto it = _counts.find(command);
+        return std::to_string(it == _counts.end() ? 0 : it -> second);
+        };
+
+private:
+    std::map<std::string, uint64_t> _counts;
+    uint64_t _total = 0;
+};
+
+} // anonymous namespace
+
+PYBIND11_MODULE(counting_sink, m)
+{
+m.doc() = "example of a g3logPython sink plugin";
+
+m.def("add", [](const std::string &name) {
+    const g3::plugin::Api *api = g3::plugin::importApi();
+    if(api == nullptr) throw pybind11::error_already_set();
+    PyObject *hndl = api -> addSink(name.c_str(), new CountingSink());
+    if(hndl == nullptr) throw pybind11::error_already_set();
+    return pybind11::reinterpret_steal<pybind11::object>(hndl);
+    }, "adds a counting sink to the logger, returns its PluginSnkHndl", pybind11::arg("name"));
+}
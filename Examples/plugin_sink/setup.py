@@ -0,0 +1,37 @@
+import setuptools
+
+# build in place: python3 setup.py build_ext --inplace
+# the plugin must use the g3log headers and compiler of the installed g3logPython
+
+class get_include(object):
+    """postpones importing the modules until they are installed"""
+
+    def __init__(self, module):
+        self.module = module
+
+    def __str__(self):
+        return __import__(self.module).get_include()
+
+
+ext_modules = [
+    setuptools.Extension(
+        'counting_sink',
+        ['counting_sink.cpp'],
+        include_dirs=[
+            get_include('g3logPython'),
+            get_include('pybind11'),
+            '/usr/local/include/',
+        ],
+        libraries=['stdc++'],
+        extra_compile_args=["-std=c++14", "-fPIC"],
+        language='c++'
+    ),
+]
+
+setuptools.setup(
+    name='counting_sink',
+    version='0.1.0',
+    description='example of a g3logPython sink plugin',
+    ext_modules=ext_modules,
+    zip_safe=False,
+)
@@ -0,0 +1,49 @@
+#!/usr/bin/env python3
+
+print("start test")
+
+import g3logPython as log
+import sys
+print("g3logPython imported")
+
+logger = log.get_ifaceLogWorker(False)
+colorTermSink = logger.ClrTermSinks.new_Sink("color term")
+
+print("loggers created")
+
+# (level, message): logged with the call-site of the batch() call
+log.batch([(log.g3DEBUG, "batch message 1"), (log.g3INFO, "batch message 2")])
+
+# (file, line, function, level, message)
+log.receivelog_batch([("some_file.py", 12, "some_function", log.g3WARNING, "batch message 3"),
+                      (log.g3INFO, "batch message 4")])
+
+# invalid level: reported as a warning, like receivelog()
+log.batch([(1234, "batch message with a bad level")])
+
+try:
+    log.batch([("not", "a", "record")])
+    print("ERROR: this should have failed!")
+    sys.exit(1)
+except Exception as inst:
+    print(inst)
+    print("error triggered as expected")
+
+
+# the records preceding a malformed one are logged before the error is raised
+rotateSink = logger.LogRotateSinks.new_Sink("batch file", "py_g3logTest_batch", "/tmp/")
+try:
+    log.batch([(log.g3INFO, "logged before the error"), (log.g3INFO, "also logged"), (log.g3INFO,)])
+    print("ERROR: this should have failed!")
+    sys.exit(1)
+except TypeError:
+    pass
+if not logger.flush(10.0):
+    print("ERROR: flush timeout")
+    sys.exit(1)
+with open(rotateSink.logFileName().result()) as f:
+    text = f.read()
+if "logged before the error" not in text or "also logged" not in text:
+    print("ERROR: the records before the error were dropped")
+    sys.exit(1)
+print("test finished")
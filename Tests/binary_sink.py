@@ -0,0 +1,42 @@
+#!/usr/bin/env python3
+
+print("start test")
+
+import g3logPython as log
+from g3logPython import bindecode
+import os
+import sys
+
+print("g3logPython imported")
+
+logdir = "/tmp/g3logPython/"
+if not os.path.exists(logdir):
+    os.mkdir(logdir)
+logdir = logdir + "binary"
+if not os.path.exists(logdir):
+    os.mkdir(logdir)
+
+logger = log.get_ifaceLogWorker(False)
+binSink = logger.BinSinks.new_Sink("binary records", "py_g3logTest_bin", logdir)
+
+print("loggers created")
+
+count = 20000
+for i in range(count):
+    log.info("binary record %d" % i)
+log.warning("last binary record")
+if not logger.flush(10.0):
+    print("ERROR: flush timeout")
+    sys.exit(1)
+
+segment = binSink.segmentName().result()
+print("segment: " + segment)
+records = [rec for rec in bindecode.read_segments([segment]) if rec.message.startswith(("binary record", "last binary"))]
+if len(records) != count + 1:
+    print("ERROR: %d records decoded instead of %d" % (len(records), count + 1))
+    sys.exit(1)
+if records[-1].level != bindecode.LEVEL_VALUES["WARNING"] or not records[-1].file.endswith("binary_sink.py"):
+    print("ERROR: bad record " + bindecode.format_record(records[-1]))
+    sys.exit(1)
+print(bindecode.format_record(records[-1]))
+print("test finished")
@@ -0,0 +1,37 @@
+#!/usr/bin/env python3
+
+print("start test")
+
+import g3logPython as log
+import sys
+print("g3logPython imported")
+
+logger = log.get_ifaceLogWorker(False)
+colorTermSink = logger.ClrTermSinks.new_Sink("color term")
+
+print("loggers created")
+
+SITE = log.register_callsite("some_file.py", 42, "some_function")
+if log.register_callsite("some_file.py", 42, "some_function") != SITE:
+    print("ERROR: a call-site should only be registered once")
+    sys.exit(1)
+
+def handler():
+    return log.callsite() # registers this line
+
+HERE = handler()
+
+log.receivelog_id(SITE, log.g3INFO, "message from some_file.py:42")
+logger.startStaging()
+for i in range(10):
+    log.receivelog_id(HERE, log.g3DEBUG, "staged message from handler() " + str(i))
+logger.stopStaging()
+
+try:
+    log.receivelog_id(123456, log.g3INFO, "bad id")
+    print("ERROR: this should have failed!")
+    sys.exit(1)
+except Exception as inst:
+    print(inst)
+    print("error triggered as expected")
+
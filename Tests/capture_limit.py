@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+
+print("start test")
+
+import g3logPython as log
+import os
+import sys
+
+print("g3logPython imported")
+
+logdir = "/tmp/g3logPython/"
+if not os.path.exists(logdir):
+    os.mkdir(logdir)
+logdir = logdir + "capture_limit"
+if not os.path.exists(logdir):
+    os.mkdir(logdir)
+
+def fail(what):
+    print("ERROR: " + what)
+    sys.exit(1)
+
+# the limit can be set with the first call
+logger = log.get_ifaceLogWorker(False, capacity=10, overflow=log.g3OVERFLOW_DROP_NEWEST)
+sink = logger.BinSinks.new_Sink("capture limit", "py_g3logTest_capture_limit", logdir)
+
+print("loggers created")
+
+def counters():
+    stats = logger.stats()
+    delivered = [s["messages"] for s in stats["sinks"] if s["name"] == "capture limit"][0]
+    return delivered, stats["overflow"]
+
+# one batch is captured with the GIL released: 10 messages are captured much faster than the sink's thread wakes up
+count = 20000
+def burst(tag):
+    log.receivelog_batch([(log.g3INFO, "%s %d" % (tag, i)) for i in range(count)])
+    if not logger.flush(30.0):
+        fail("flush timeout")
+
+before, _ = counters()
+burst("newest")
+after, overflow = counters()
+if overflow["capacity"] != 10 or overflow["policy"] != "drop_newest":
+    fail("bad limit: " + str(overflow))
+if overflow["dropped_newest"] == 0:
+    fail("nothing dropped")
+if (after - before) + overflow["dropped_newest"] != count:
+    fail("drop_newest: %d delivered, %d dropped" % (after - before, overflow["dropped_newest"]))
+
+# drop oldest: the records waiting in the staging ring make room for the new ones
+logger.startStaging(4096)
+logger.setCaptureLimit(10, log.g3OVERFLOW_DROP_OLDEST)
+before, base = counters()
+burst("oldest")
+after, overflow = counters()
+dropped = overflow["dropped_oldest"] - base["dropped_oldest"]
+if dropped == 0 or overflow["dropped_newest"] != base["dropped_newest"]:
+    fail("drop_oldest: " + str(overflow))
+if (after - before) + dropped != count:
+    fail("drop_oldest: %d delivered, %d dropped" % (after - before, dropped))
+logger.stopStaging()
+
+# block without a timeout: nothing is lost, the callers wait for the sink
+logger.setCaptureLimit(100, log.g3OVERFLOW_BLOCK, -1)
+before, base = counters()
+burst("block")
+for i in range(1000):
+    log.info("block python %d" % i)
+if not logger.flush(30.0):
+    fail("flush timeout")
+after, overflow = counters()
+if after - before != count + 1000:
+    fail("block: %d delivered" % (after - before))
+if overflow["blocked"] == base["blocked"] or overflow["timeouts"] != base["timeouts"]:
+    fail("block: " + str(overflow))
+if overflow["in_flight"] != 0:
+    fail("in flight after flush: %d" % overflow["in_flight"])
+
+try:
+    logger.setCaptureLimit(100, 7)
+    fail("invalid policy accepted")
+except Exception:
+    pass
+
+logger.setCaptureLimit(0)
+before, _ = counters()
+burst("unlimited")
+after, _ = counters()
+if after - before != count:
+    fail("unlimited: %d delivered" % (after - before))
+print("test finished")
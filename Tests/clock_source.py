@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+
+print("start test")
+
+import g3logPython as log
+from g3logPython import bindecode
+import os
+import sys
+import time
+
+print("g3logPython imported")
+
+logdir = "/tmp/g3logPython/"
+if not os.path.exists(logdir):
+    os.mkdir(logdir)
+logdir = logdir + "clock_source"
+if not os.path.exists(logdir):
+    os.mkdir(logdir)
+
+def fail(what):
+    print("ERROR: " + what)
+    sys.exit(1)
+
+# the source can be selected with the first call
+logger = log.get_ifaceLogWorker(False, clock=log.g3CLOCK_REALTIME_COARSE)
+if log.get_clock_source() != log.g3CLOCK_REALTIME_COARSE:
+    fail("clock source not set")
+sink = logger.BinSinks.new_Sink("clock source", "py_g3logTest_clock", logdir)
+
+print("loggers created")
+
+sources = [("realtime", log.g3CLOCK_REALTIME, 0.001), ("coarse", log.g3CLOCK_REALTIME_COARSE, 0.02)]
+if log.tsc_available():
+    sources.append(("tsc", log.g3CLOCK_TSC, 0.001))
+else:
+    print("no invariant TSC: g3CLOCK_TSC not tested")
+    try:
+        log.set_clock_source(log.g3CLOCK_TSC)
+        fail("TSC accepted")
+    except Exception:
+        pass
+
+def check(tag, margin):
+    start = time.time()
+    for i in range(100):
+        log.info("clock %s %d" % (tag, i))
+    log.receivelog_batch([(log.g3INFO, "clock %s batch %d" % (tag, i)) for i in range(100)])
+    end = time.time()
+    if not logger.flush(10.0):
+        fail("flush timeout")
+    recs = [rec for rec in bindecode.read_segments([sink.segmentName().result()]) if rec.message.startswith("clock %s " % tag)]
+    if len(recs) != 200:
+        fail("%s: %d records" % (tag, len(recs)))
+    for rec in recs:
+        stamp = rec.timestamp_ns * 1e-9
+        if stamp < start - margin or stamp > end + margin:
+            fail("%s: timestamp %f out of [%f, %f]" % (tag, stamp, start, end))
+    batch = set(rec.timestamp_ns for rec in recs if " batch " in rec.message)
+    if len(batch) != 1:
+        fail("%s: %d timestamps in one batch" % (tag, len(batch)))
+
+for tag, source, margin in sources:
+    log.set_clock_source(source)
+    check(tag, margin)
+    print(tag + " checked")
+
+# staged: the TSC readings are converted by the drainer
+logger.startStaging()
+check("staged", 0.02)
+logger.stopStaging()
+
+try:
+    log.set_clock_source(5)
+    fail("invalid source accepted")
+except Exception:
+    pass
+log.set_clock_source(log.g3CLOCK_REALTIME)
+print("test finished")
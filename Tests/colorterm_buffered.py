@@ -0,0 +1,34 @@
+#!/usr/bin/env python3
+
+print("start test")
+
+import g3logPython as log
+import time
+print("g3logPython imported")
+
+logger = log.get_ifaceLogWorker(False)
+colorTermSink = logger.ClrTermSinks.new_Sink("color term")
+
+print("loggers created")
+
+log.info("unbuffered: one write per line")
+
+colorTermSink.setBufferPolicy(64 * 1024, 50)
+for i in range(2000):
+    log.debug("buffered line %d" % i)
+log.info("this line is written by the timer, 50 ms later at most")
+time.sleep(0.2)
+
+colorTermSink.setBufferPolicy(1024 * 1024, 10000)
+log.warning("this line is written by flush()")
+colorTermSink.flush()
+
+colorTermSink.setBufferPolicy(1024 * 1024, 0) # by size only
+for i in range(100):
+    log.debug("size-only buffered line %d" % i)
+log.info("these lines are written together, by flush()")
+colorTermSink.flush()
+
+colorTermSink.setBufferPolicy(0)
+log.info("unbuffered again")
+print("test finished")
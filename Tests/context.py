@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+
+print("start test")
+
+import g3logPython as log
+import asyncio
+import json
+import os
+import sys
+import threading
+
+print("g3logPython imported")
+
+logdir = "/tmp/g3logPython/"
+if not os.path.exists(logdir):
+    os.mkdir(logdir)
+logdir = logdir + "context/"
+if not os.path.exists(logdir):
+    os.mkdir(logdir)
+
+def fail(what):
+    print("ERROR: " + what)
+    sys.exit(1)
+
+logger = log.get_ifaceLogWorker(False)
+jsonSink = logger.LogRotateSinks.new_Sink("context json", "py_g3logTest_context", logdir)
+jsonSink.setFieldFormat(log.g3FIELDS_JSON)
+
+print("loggers created")
+
+log.info("no context")
+with log.context(request_id="r1", tenant="acme"):
+    log.info("in context")
+    with log.context(tenant="other", depth=2):
+        if log.get_context() != {"request_id": "r1", "tenant": "other", "depth": 2}:
+            fail("nested get_context: " + str(log.get_context()))
+        log.info("nested")
+        log.info("own field", tenant="mine", user="bob")
+    log.batch([(log.g3INFO, "batched")])
+if log.get_context() != {}:
+    fail("context left: " + str(log.get_context()))
+
+# each thread has its own context
+def worker(n):
+    with log.context(worker=n):
+        for i in range(100):
+            log.info("thread")
+threads = [threading.Thread(target=worker, args=(n,)) for n in range(4)]
+with log.context(request_id="main"):
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+
+# and each asyncio task
+async def task(n):
+    with log.context(task=n):
+        await asyncio.sleep(0.01)
+        log.info("task")
+async def tasks():
+    await asyncio.gather(*(task(n) for n in range(4)))
+asyncio.run(tasks())
+
+if not logger.flush(10.0):
+    fail("flush timeout")
+
+records = []
+with open(jsonSink.logFileName().result()) as f:
+    for line in f:
+        if line.startswith("{"):
+            if line.count('"tenant"') > 1:
+                fail("duplicated field: " + line)
+            records.append(json.loads(line))
+def find(msg):
+    return [rec for rec in records if rec["msg"] == msg]
+
+if "request_id" in find("no context")[0]:
+    fail("context outside of the block")
+rec = find("in context")[0]
+if rec["request_id"] != "r1" or rec["tenant"] != "acme":
+    fail("in context: %s" % rec)
+rec = find("nested")[0]
+if rec["request_id"] != "r1" or rec["tenant"] != "other" or rec["depth"] != 2:
+    fail("nested: %s" % rec)
+rec = find("own field")[0]
+if rec["tenant"] != "mine" or rec["user"] != "bob" or rec["request_id"] != "r1":
+    fail("own field: %s" % rec)
+rec = find("batched")[0]
+if rec["request_id"] != "r1" or rec["tenant"] != "acme" or "depth" in rec:
+    fail("batched: %s" % rec)
+
+threaded = find("thread")
+if len(threaded) != 400:
+    fail("%d thread messages" % len(threaded))
+for n in range(4):
+    if len([rec for rec in threaded if rec["worker"] == n]) != 100:
+        fail("thread %d: wrong context" % n)
+if any("request_id" in rec for rec in threaded):
+    fail("the context of another thread")
+
+tasked = find("task")
+if sorted(rec["task"] for rec in tasked) != [0, 1, 2, 3]:
+    fail("tasks: %s" % tasked)
+
+print(json.dumps(find("own field")[0]))
+print("Test Finished.")
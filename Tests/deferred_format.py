@@ -0,0 +1,41 @@
+#!/usr/bin/env python3
+
+print("start test")
+
+import g3logPython as log
+print("g3logPython imported")
+
+logger = log.get_ifaceLogWorker(False)
+colorTermSink = logger.ClrTermSinks.new_Sink("color term")
+
+print("loggers created")
+
+class BigObject:
+    def __str__(self):
+        return "<big object>"
+    def __repr__(self):
+        return "BigObject()"
+
+obj = BigObject()
+log.info("state=%s id=%d ratio=%.2f ok=%s", obj, 42, 0.1234, True)
+log.info("repr: %r %r", obj, "text")
+log.info("mapping: %(user)s", {"user": "bob"})
+log.info("star width: [%*d] [%.*f]", 5, 42, 2, 3.14159) # formatted by python: [   42] [3.14]
+log.info("utf-8 width: [%-6s] [%.2s]", "h\u00e9llo", "\u00e9t\u00e9") # counted in code points, as python: [héllo ] [ét]
+log.info("100%% literal percent, no argument")
+log.info("bad format %d", "not a number")
+
+log.set_level(log.g3INFO)
+class MustNotFormat:
+    def __str__(self):
+        print("ERROR: a disabled message was formatted")
+        return ""
+log.debug("disabled: %s", MustNotFormat())
+log.set_level(log.g3DEBUG)
+
+logger.startStaging()
+for i in range(10):
+    log.debug("staged %d/%d: %s", i, 10, obj)
+logger.stopStaging()
+
+print("expected above: formatted messages, one with a format error note")
@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+
+print("start test")
+
+import g3logPython as log
+import glob
+import os
+import subprocess
+import sys
+
+print("g3logPython imported")
+
+logdir = "/tmp/g3logPython/"
+if not os.path.exists(logdir):
+    os.mkdir(logdir)
+logdir = logdir + "flight_recorder"
+if not os.path.exists(logdir):
+    os.mkdir(logdir)
+for old in glob.glob(logdir + "/*"):
+    os.remove(old)
+
+def fail(what):
+    print("ERROR: " + what)
+    sys.exit(1)
+
+log.set_level(log.g3DEBUG)
+logger = log.get_ifaceLogWorker(False)
+rotate = logger.LogRotateSinks.new_Sink("recorder file", "py_g3logTest_recorder", logdir)
+rotate.setMinLevel(log.g3INFO)
+recorder = logger.FlightRecSinks.new_Sink("recorder", 100, 128)
+
+print("loggers created")
+
+for i in range(250):
+    log.debug("debug context %d" % i)
+log.info("long " + "x" * 500)
+if not logger.flush(10.0):
+    fail("flush timeout")
+
+# the last 100 messages only, oldest first
+text = recorder.dump().result()
+if "debug context 150\n" in text or "debug context 151\n" not in text or "debug context 249\n" not in text:
+    fail("not the last messages:\n" + text)
+if text.find("debug context 151\n") > text.find("debug context 249\n"):
+    fail("not in order")
+if "[truncated]" not in text:
+    fail("long message not truncated")
+counters = recorder.counters().result()
+print("counters: " + str(counters))
+if counters["recorded"] != 251 or counters["kept"] != 100 or counters["overwritten"] != 151 or counters["truncated"] != 1:
+    fail("counters " + str(counters))
+
+# the DEBUG messages only reached the recorder
+with open(rotate.logFileName().result()) as f:
+    if "debug context" in f.read():
+        fail("DEBUG in the LogRotate file")
+
+# on demand: to a file, and with the LogRotate sink
+dump_file = logdir + "/dump.txt"
+if recorder.dumpToFile(dump_file).result() != dump_file:
+    fail("dumpToFile result")
+with open(dump_file) as f:
+    if "debug context 249" not in f.read():
+        fail("dumpToFile content")
+recorder.dumpToSink(rotate).result()
+if not logger.flush(10.0):
+    fail("flush timeout")
+with open(rotate.logFileName().result()) as f:
+    if "debug context 249" not in f.read():
+        fail("dumpToSink content")
+
+recorder.clear().result()
+if recorder.counters().result()["kept"] != 0 or "debug context" in recorder.dump().result():
+    fail("clear")
+
+# on FATAL: both dump targets get the context of the crash (in a child, the FATAL ends the process)
+child = """
+import g3logPython as log
+logger = log.get_ifaceLogWorker(False)
+rotate = logger.LogRotateSinks.new_Sink("fatal file", "py_g3logTest_fatal", "%s")
+rotate.setMinLevel(log.g3INFO)
+recorder = logger.FlightRecSinks.new_Sink("fatal recorder")
+recorder.setDumpFile("%s/fatal_dump.txt").result()
+recorder.setDumpSink(rotate).result()
+for i in range(50):
+    log.debug("before the crash %%d" %% i)
+log.fatal("crash")
+""" % (logdir, logdir)
+subprocess.run([sys.executable, "-c", child], stdout = subprocess.DEVNULL, stderr = subprocess.DEVNULL)
+with open(logdir + "/fatal_dump.txt") as f:
+    if "before the crash 49" not in f.read():
+        fail("no FATAL dump file")
+fatal_logs = glob.glob(logdir + "/py_g3logTest_fatal*.log")
+if len(fatal_logs) == 0:
+    fail("no LogRotate file in the child")
+with open(fatal_logs[0]) as f:
+    content = f.read()
+    if "before the crash 49" not in content or "crash" not in content:
+        fail("no FATAL dump in the LogRotate file:\n" + content)
+
+print("Test Finished.")
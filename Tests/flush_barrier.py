@@ -0,0 +1,50 @@
+#!/usr/bin/env python3
+
+print("start test")
+
+import g3logPython as log
+import os
+import sys
+
+print("g3logPython imported")
+
+logdir = "/tmp/g3logPython/"
+if not os.path.exists(logdir):
+    os.mkdir(logdir)
+logdir = logdir + "flush"
+if not os.path.exists(logdir):
+    os.mkdir(logdir)
+
+logger = log.get_ifaceLogWorker(False)
+logrotateSink = logger.LogRotateSinks.new_Sink("log flush","py_g3logTest_flush",logdir)
+colorTermSink = logger.ClrTermSinks.new_Sink("color term")
+colorTermSink.setBufferPolicy(1024 * 1024, 60000) # only flushed by the barrier
+
+print("loggers created")
+
+for i in range(1000):
+    log.info("synchronous message %d" % i)
+if not logger.flush(10.0):
+    print("ERROR: flush timeout")
+    sys.exit(1)
+logfile = logrotateSink.logFileName().result()
+size = os.path.getsize(logfile)
+print("log file %s: %d bytes after flush" % (logfile, size))
+if size == 0:
+    print("ERROR: nothing written after flush")
+    sys.exit(1)
+
+# the staged messages are flushed too
+logger.startStaging()
+for i in range(1000):
+    log.info("staged message %d" % i)
+if not logger.flush(10.0):
+    print("ERROR: flush timeout with staging")
+    sys.exit(1)
+logger.stopStaging()
+if os.path.getsize(logfile) <= size:
+    print("ERROR: the staged messages were not flushed")
+    sys.exit(1)
+
+logrotateSink.flush().wait()
+print("test finished")
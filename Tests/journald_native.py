@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+
+print("start test")
+
+import g3logPython as log
+import json
+import shutil
+import subprocess
+import sys
+import time
+
+print("g3logPython imported")
+
+logger = log.get_ifaceLogWorker(False)
+journalSink = logger.JournaldSinks.new_Sink("journald native", "g3logPython_TEST_native")
+
+print("loggers created")
+
+def fail(what):
+    print("ERROR: " + what)
+    sys.exit(1)
+
+if journalSink.identifier().result() != "g3logPython_TEST_native":
+    fail("bad identifier")
+
+marker = "journald native %f" % time.time()
+log.info(marker, user="bob", latency_ms=1.5)
+log.warning("journald native warning", user="alice")
+if not logger.flush(10.0):
+    fail("flush timeout")
+
+if shutil.which("journalctl") is None:
+    print("journalctl not found: the entries are not checked")
+    print("test finished")
+    sys.exit(0)
+
+found = None
+deadline = time.time() + 5.0
+while found is None and time.time() < deadline:
+    out = subprocess.run(["journalctl", "--no-pager", "-o", "json", "SYSLOG_IDENTIFIER=g3logPython_TEST_native"],
+                         stdout=subprocess.PIPE, stderr=subprocess.DEVNULL, universal_newlines=True).stdout
+    for line in out.splitlines():
+        entry = json.loads(line)
+        if entry.get("MESSAGE") == marker:
+            found = entry
+    if found is None:
+        time.sleep(0.2)
+
+if found is None:
+    print("entry not found in the journal (no access to the journal?): not checked")
+    print("test finished")
+    sys.exit(0)
+
+print(found)
+if found.get("USER") != "bob" or found.get("LATENCY_MS") != "1.5":
+    fail("bad structured fields")
+if not found.get("CODE_FILE", "").endswith("journald_native.py"):
+    fail("bad CODE_FILE")
+if found.get("PRIORITY") != "6" or found.get("G3LOG_LEVEL") != "INFO":
+    fail("bad priority")
+
+print("test finished")
@@ -0,0 +1,36 @@
+#!/usr/bin/env python3
+
+print("start test")
+
+import g3logPython as log
+import sys
+print("g3logPython imported")
+
+logger = log.get_ifaceLogWorker(False)
+colorTermSink = logger.ClrTermSinks.new_Sink("color term")
+
+print("loggers created")
+
+if log.get_level() != log.g3DEBUG:
+    print("ERROR: the default level should be DEBUG")
+    sys.exit(1)
+
+log.set_level(log.g3INFO)
+if log.level_enabled(log.g3DEBUG) or not log.level_enabled(log.g3WARNING):
+    print("ERROR: bad level threshold")
+    sys.exit(1)
+
+log.debug("ERROR: this debug message should not be displayed")
+log.info("this info message should be displayed")
+
+log.set_level(log.g3DEBUG)
+log.debug("this debug message should be displayed")
+
+try:
+    log.set_level(1234)
+    print("ERROR: this should have failed!")
+    sys.exit(1)
+except Exception as inst:
+    print(inst)
+    print("error triggered as expected")
+
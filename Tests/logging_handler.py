@@ -0,0 +1,83 @@
+#!/usr/bin/env python3
+
+print("start test")
+
+import g3logPython as log
+from g3logPython import bindecode
+import logging
+import os
+import sys
+
+print("g3logPython imported")
+
+logdir = "/tmp/g3logPython/"
+if not os.path.exists(logdir):
+    os.mkdir(logdir)
+logdir = logdir + "logging_handler"
+if not os.path.exists(logdir):
+    os.mkdir(logdir)
+
+logger = log.get_ifaceLogWorker(False)
+binSink = logger.BinSinks.new_Sink("logging records", "py_g3logTest_logging", logdir)
+
+print("loggers created")
+
+def fail(what):
+    print("ERROR: " + what)
+    sys.exit(1)
+
+pylogger = logging.getLogger("test.bridge")
+pylogger.setLevel(logging.DEBUG)
+pylogger.propagate = False
+handler = log.Handler()
+pylogger.addHandler(handler)
+
+class NoSecrets(logging.Filter):
+    def filter(self, record):
+        return "secret" not in record.getMessage()
+
+def library_function():
+    pylogger.info("bridge info %d %s", 42, "text") # the call-site of the record
+    pylogger.debug("bridge debug %(key)s", {"key": "mapped"})
+    pylogger.error("bridge error")
+    try:
+        1 / 0
+    except ZeroDivisionError:
+        pylogger.exception("bridge exception")
+
+library_function()
+handler.addFilter(NoSecrets())
+pylogger.warning("bridge secret")
+pylogger.warning("bridge filtered in")
+handler.logger_field = False
+pylogger.info("bridge without logger")
+if not logger.flush(10.0):
+    fail("flush timeout")
+
+segment = binSink.segmentName().result()
+records = [rec for rec in bindecode.read_segments([segment]) if rec.message.startswith("bridge")]
+for rec in records:
+    print(bindecode.format_record(rec))
+messages = [rec.message for rec in records]
+
+expected = ["bridge info 42 text logger=test.bridge",
+            "bridge debug mapped logger=test.bridge",
+            "bridge error logger=test.bridge levelname=ERROR",
+            "bridge filtered in logger=test.bridge",
+            "bridge without logger"]
+for text in expected:
+    if text not in messages:
+        fail("missing record: " + text)
+if any("secret" in text for text in messages):
+    fail("the handler's filter was not applied")
+exc = [rec for rec in records if rec.message.startswith("bridge exception")]
+if len(exc) != 1 or "ZeroDivisionError" not in exc[0].message:
+    fail("missing traceback")
+
+info = records[messages.index(expected[0])]
+if not info.file.endswith("logging_handler.py") or info.function != "library_function" or info.level != bindecode.LEVEL_VALUES["INFO"]:
+    fail("bad call-site or level " + bindecode.format_record(info))
+error = records[messages.index(expected[2])]
+if error.level != bindecode.LEVEL_VALUES["WARNING"]:
+    fail("ERROR is not logged as WARNING")
+print("test finished")
@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+
+print("start test")
+
+import g3logPython as log
+import glob
+import os
+import sys
+import time
+
+print("g3logPython imported")
+
+logdir = "/tmp/g3logPython/"
+if not os.path.exists(logdir):
+    os.mkdir(logdir)
+logdir = logdir + "logrotate_background"
+if not os.path.exists(logdir):
+    os.mkdir(logdir)
+for old in glob.glob(logdir + "/py_g3logTest_bg*"):
+    os.remove(old)
+
+def fail(what):
+    print("ERROR: " + what)
+    sys.exit(1)
+
+def wait_for(condition, timeout = 10.0):
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        if condition():
+            return True
+        time.sleep(0.05)
+    return False
+
+logger = log.get_ifaceLogWorker(False)
+sink = logger.LogRotateSinks.new_Sink("background rotate", "py_g3logTest_bg", logdir)
+sink.setMaxLogSize(20000).result()
+sink.setMaxArchiveLogCount(3).result()
+if sink.getMaxLogSize().result() != 20000:
+    fail("max log size not set")
+if not sink.getCompression().result():
+    fail("compression off by default")
+
+try:
+    sink.setMaxLogSize(0)
+    fail("size 0 accepted")
+except Exception:
+    print("size 0 rejected")
+
+logfile = sink.logFileName().result()
+print("loggers created, log file: " + logfile)
+
+# ~100 bytes per line: 10 files or so, 3 archives kept
+for i in range(2000):
+    log.info("background rotation line %d ......................................" % i)
+if not logger.flush(10.0):
+    fail("flush timeout")
+
+archives = lambda pattern: glob.glob(logfile + pattern)
+if not wait_for(lambda: len(archives(".*.gz")) == 3 and len(archives(".*[0-9]")) == 0):
+    fail("archives: " + str(sorted(os.listdir(logdir))))
+print("compressed archives: " + str(len(archives(".*.gz"))))
+if os.path.getsize(logfile) > 20000 + 200:
+    fail("the current file was not rotated")
+
+# uncompressed archives, rotation on demand
+sink.setCompression(False).result()
+archive = sink.rotate().result()
+if archive == "" or not os.path.exists(archive):
+    fail("rotate() archive missing: " + archive)
+log.info("after rotate()")
+if not logger.flush(10.0):
+    fail("flush timeout")
+time.sleep(0.5)
+if not os.path.exists(archive) or os.path.exists(archive + ".gz"):
+    fail("archive compressed while the compression is off")
+if not wait_for(lambda: len(archives(".*")) == 3):
+    fail("archives not expired: " + str(sorted(os.listdir(logdir))))
+with open(sink.logFileName().result()) as f:
+    if "after rotate()" not in f.read():
+        fail("no line in the new file")
+
+print("Test Finished.")
@@ -0,0 +1,22 @@
+#!/usr/bin/env python3
+
+print("start test")
+
+import g3logPython as log
+print("g3logPython imported")
+
+logger = log.get_ifaceLogWorker(False)
+colorTermSink = logger.ClrTermSinks.new_Sink("color term")
+
+print("loggers created")
+
+big = "x" * 100000
+log.info("str message")
+log.info(b"bytes message")
+log.info(bytearray(b"bytearray message"))
+log.info(memoryview(b"memoryview message"))
+log.info(12345)
+log.info(big)
+log.receivelog("some_file.py", 1, "some_function", log.g3WARNING, b"receivelog with bytes")
+
+print("6 messages + 1 long line of x are expected above")
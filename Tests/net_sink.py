@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+
+print("start test")
+
+import g3logPython as log
+import json
+import os
+import socket
+import struct
+import sys
+import time
+
+print("g3logPython imported")
+
+logdir = "/tmp/g3logPython/"
+if not os.path.exists(logdir):
+    os.mkdir(logdir)
+logdir = logdir + "net_sink/"
+if not os.path.exists(logdir):
+    os.mkdir(logdir)
+
+def fail(what):
+    print("ERROR: " + what)
+    sys.exit(1)
+
+logger = log.get_ifaceLogWorker(False)
+
+# UDP: newline-separated lines, batched into datagrams
+udp = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+udp.bind(("127.0.0.1", 0))
+udp.settimeout(5.0)
+udpSink = logger.NetSinks.new_Sink("net udp", "udp://127.0.0.1:%d" % udp.getsockname()[1])
+udpSink.setFieldFormat(log.g3FIELDS_JSON)
+
+# TCP: length-prefixed frames. Nobody listens yet: the sink reconnects
+listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+listener.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+listener.bind(("127.0.0.1", 0))
+tcpPort = listener.getsockname()[1]
+tcpSink = logger.NetSinks.new_Sink("net tcp", "tcp://127.0.0.1:%d" % tcpPort)
+
+print("loggers created")
+
+try:
+    logger.NetSinks.new_Sink("net bad", "http://localhost:80")
+    fail("bad address accepted")
+except Exception:
+    pass
+
+count = 2000
+for i in range(count):
+    log.info("net record", seq=i)
+if not logger.flush(10.0):
+    fail("flush timeout")
+
+records = []
+datagrams = 0
+while len(records) < count:
+    data = udp.recv(65536)
+    datagrams += 1
+    records += [json.loads(line) for line in data.decode().split("\n") if line]
+if [rec["seq"] for rec in records] != list(range(count)):
+    fail("UDP: bad records")
+print("UDP: %d records in %d datagrams" % (len(records), datagrams))
+if datagrams >= count // 10:
+    fail("UDP: the records are not batched")
+
+# a multi-line message stays one record (default text layout)
+udpText = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+udpText.bind(("127.0.0.1", 0))
+udpText.settimeout(5.0)
+udpTextSink = logger.NetSinks.new_Sink("net udp text", "udp://127.0.0.1:%d" % udpText.getsockname()[1])
+log.info("first line\nsecond line")
+if not logger.flush(10.0):
+    fail("flush timeout")
+lines = [line for line in udpText.recv(65536).decode().split("\n") if line]
+if len(lines) != 1 or not lines[0].endswith("first line\\nsecond line"):
+    fail("UDP: multi-line message: %s" % lines)
+
+listener.listen(1)
+listener.settimeout(10.0)
+conn, _ = listener.accept() # after the backoff
+conn.settimeout(5.0)
+for i in range(count, 2 * count):
+    log.info("net record", seq=i)
+if not logger.flush(10.0):
+    fail("flush timeout")
+
+buf = b""
+frames = []
+while len(frames) < 2 * count:
+    # the records logged before the connection waited in the spill buffer
+    chunk = conn.recv(65536)
+    if not chunk:
+        break
+    buf += chunk
+    while len(buf) >= 4:
+        (size,) = struct.unpack(">I", buf[:4])
+        if len(buf) < 4 + size:
+            break
+        frames.append(buf[4:4 + size].decode())
+        buf = buf[4 + size:]
+if len(frames) != 2 * count or not all(frame.endswith("net record seq=%d" % i) for i, frame in enumerate(frames)):
+    fail("TCP: %d frames" % len(frames))
+
+counters = tcpSink.counters().result()
+print(counters)
+if counters["sent_records"] != 2 * count or counters["connects"] < 1 or counters["dropped"] != 0:
+    fail("TCP: bad counters")
+
+# the collector is gone: the lines beyond the spill buffer go to the overflow file
+conn.close()
+listener.close()
+tcpSink.setSpillPolicy(4096, "py_g3logTest_net_overflow", logdir).wait(5.0)
+for i in range(count):
+    log.info("net overflow %d" % i)
+if not logger.flush(10.0):
+    fail("flush timeout")
+counters = tcpSink.counters().result()
+print(counters)
+if counters["spilled"] == 0:
+    fail("nothing spilled")
+with open(os.path.join(logdir, "py_g3logTest_net_overflow.log")) as f:
+    spilled = [line for line in f if "net overflow" in line]
+if len(spilled) != counters["spilled"]:
+    fail("overflow file: %d lines" % len(spilled))
+print("test finished")
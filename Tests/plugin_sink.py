@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+
+print("start test")
+
+import g3logPython as log
+import os
+import shutil
+import subprocess
+import sys
+
+print("g3logPython imported")
+
+logdir = "/tmp/g3logPython/"
+if not os.path.exists(logdir):
+    os.mkdir(logdir)
+builddir = logdir + "plugin_sink"
+if os.path.exists(builddir):
+    shutil.rmtree(builddir)
+
+def fail(what):
+    print("ERROR: " + what)
+    sys.exit(1)
+
+# the example plugin, built against the installed g3logPython
+example = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "Examples", "plugin_sink")
+shutil.copytree(example, builddir)
+if not os.path.exists(os.path.join(log.get_include(), "g3logPython", "plugin.h")):
+    fail("plugin.h not installed")
+if subprocess.call([sys.executable, "setup.py", "build_ext", "--inplace"], cwd=builddir) != 0:
+    fail("plugin build")
+sys.path.insert(0, builddir)
+import counting_sink
+
+print("plugin built")
+
+logger = log.get_ifaceLogWorker(False)
+counter = counting_sink.add("plugin counter")
+warnCounter = counting_sink.add("plugin warnings")
+warnCounter.setMinLevel(log.g3WARNING)
+
+try:
+    counting_sink.add("plugin counter")
+    fail("same name accepted")
+except RuntimeError:
+    pass
+
+count = 1000
+for i in range(count):
+    log.debug("plugin debug %d" % i)
+    log.warning("plugin warning %d" % i)
+if not logger.flush(10.0):
+    fail("flush timeout")
+
+if int(counter.control("total").result()) < 2 * count:
+    fail("total: " + counter.control("total").result())
+if int(counter.control("WARNING").result()) < count:
+    fail("warnings: " + counter.control("WARNING").result())
+if int(warnCounter.control("DEBUG").result()) != 0:
+    fail("min level not applied")
+if int(warnCounter.control("WARNING").result()) < count:
+    fail("filtered warnings: " + warnCounter.control("WARNING").result())
+
+counter.control("reset").result()
+log.info("plugin after reset")
+counter.flush().result()
+if not logger.flush(10.0):
+    fail("flush timeout")
+if int(counter.control("total").result()) < 1:
+    fail("nothing after reset")
+
+stats = {sink["name"]: sink for sink in logger.stats()["sinks"]}
+if stats["plugin counter"]["type"] != "plugin":
+    fail("bad sink type in stats")
+if stats["plugin warnings"]["filtered"] < count:
+    fail("bad filtered count")
+print("test finished")
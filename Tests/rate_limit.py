@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+
+print("start test")
+
+import g3logPython as log
+import re
+import sys
+import time
+
+print("g3logPython imported")
+
+logger = log.get_ifaceLogWorker(False)
+rotateSink = logger.LogRotateSinks.new_Sink("rate_limit", "py_g3logTest_rate_limit", "/tmp/")
+
+print("loggers created")
+
+def fail(what):
+    print("ERROR: " + what)
+    sys.exit(1)
+
+# token bucket on the warnings: a burst of 5, then 10 per second
+log.set_rate_limit(per_second=10, burst=5, level=log.g3WARNING)
+log.set_suppressed_summary_interval(0)
+def faulty(i):
+    log.warning("faulty dependency %d", i) # a single call-site
+
+start = time.monotonic()
+for i in range(100000):
+    faulty(i)
+time.sleep(0.3) # refills the bucket: the next message comes with the summary of the suppressed ones
+faulty(-1)
+elapsed = time.monotonic() - start
+
+# a call-site flooding, then quiet: its summary is logged by flush()
+def quiet():
+    for i in range(1000):
+        log.warning("flood then quiet %d", i)
+quiet()
+
+# sampling on the info messages
+log.set_rate_limit(sample_every=10, level=log.g3INFO)
+for i in range(1000):
+    log.info("sampled message %d" % i)
+log.debug("debug messages are not limited")
+
+stats = {(s.level, s.line): s for s in log.rate_limit_stats() if s.file.endswith("rate_limit.py")}
+warnings = [s for (level, _), s in stats.items() if level == log.g3WARNING and s.limited > 0]
+infos = [s for (level, _), s in stats.items() if level == log.g3INFO]
+faultyStats = [s for s in warnings if s.function == "faulty"]
+quietStats = [s for s in warnings if s.function == "quiet"]
+# at most the burst, plus the refill of the elapsed time (measured: slow machines get more)
+if len(faultyStats) != 1 or faultyStats[0].logged > 5 + 10 * elapsed + 1 or faultyStats[0].logged + faultyStats[0].limited != 100001:
+    fail("bad rate limit counters")
+if len(quietStats) != 1 or quietStats[0].logged + quietStats[0].limited != 1000:
+    fail("bad rate limit counters of the quiet call-site")
+if len(infos) != 1 or infos[0].logged != 100 or infos[0].sampled != 900:
+    fail("bad sampling counters")
+if log.dropped_count() != faultyStats[0].limited + quietStats[0].limited + infos[0].sampled:
+    fail("bad dropped count %d" % log.dropped_count())
+
+if not logger.flush(10.0):
+    fail("flush timeout")
+with open(rotateSink.logFileName().result()) as f:
+    text = f.read()
+# every message dropped from the quiet call-site is reported, the last ones by flush()
+reported = sum(int(m.group(1)) for m in re.finditer(r"->quiet:\d+\]\s+suppressed (\d+) messages", text))
+if reported != quietStats[0].limited:
+    fail("quiet call-site: %d suppressed messages reported instead of %d" % (reported, quietStats[0].limited))
+
+log.clear_rate_limits()
+log.warning("rate limits cleared")
+if not logger.flush(10.0):
+    fail("flush timeout")
+
+with open(rotateSink.logFileName().result()) as f:
+    text = f.read()
+if "suppressed" not in text or "faulty dependency -1" not in text or "rate limits cleared" not in text:
+    fail("missing messages in the log file")
+print("logged %d warnings, dropped %d" % (faultyStats[0].logged, faultyStats[0].limited))
+print("test finished")
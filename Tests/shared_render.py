@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+
+print("start test")
+
+import g3logPython as log
+import os
+import sys
+
+print("g3logPython imported")
+
+logdir = "/tmp/g3logPython/"
+if not os.path.exists(logdir):
+    os.mkdir(logdir)
+logdir = logdir + "shared_render/"
+if not os.path.exists(logdir):
+    os.mkdir(logdir)
+
+logger = log.get_ifaceLogWorker(False)
+firstSink = logger.LogRotateSinks.new_Sink("render first", "py_g3logTest_render_1", logdir)
+secondSink = logger.LogRotateSinks.new_Sink("render second", "py_g3logTest_render_2", logdir)
+jsonSink = logger.LogRotateSinks.new_Sink("render json", "py_g3logTest_render_json", logdir)
+jsonSink.setFieldFormat(log.g3FIELDS_JSON)
+warnSink = logger.LogRotateSinks.new_Sink("render warning", "py_g3logTest_render_warn", logdir)
+warnSink.setMinLevel(log.g3WARNING)
+
+print("loggers created")
+
+def fail(what):
+    print("ERROR: " + what)
+    sys.exit(1)
+
+count = 2000
+for i in range(count):
+    log.info("render line %d" % i)
+    log.warning("render fields", seq=i, user="bob")
+if not logger.flush(10.0):
+    fail("flush timeout")
+
+def lines(sink):
+    with open(sink.logFileName().result()) as f:
+        return [line for line in f if "render " in line]
+
+# the sinks sharing the rendering write the same lines as if they had formatted them
+first = lines(firstSink)
+if len(first) != 2 * count or first != lines(secondSink):
+    fail("the shared lines differ: %d lines" % len(first))
+if not any(line.rstrip().endswith("render fields seq=7 user=bob") for line in first):
+    fail("the fields are not rendered as TEXT")
+warn = lines(warnSink)
+if len(warn) != count or not all("render fields seq=" in line for line in warn):
+    fail("warning: %d lines" % len(warn))
+# the JSON sink shares the lines without fields, and writes its own JSON lines
+json_lines = lines(jsonSink)
+if len([line for line in json_lines if line.startswith("{")]) != count:
+    fail("json: bad JSON lines")
+if [line for line in json_lines if not line.startswith("{")] != [line for line in first if "render line" in line]:
+    fail("json: the lines without fields differ")
+
+stats = {sink["name"]: sink for sink in logger.stats()["sinks"]}
+shared = sum(sink["shared_lines"] for sink in stats.values())
+print("shared lines: %d" % shared)
+if shared == 0:
+    fail("no line shared")
+if shared > 5 * count: # each message is rendered at least once
+    fail("too many shared lines")
+print("test finished")
@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+
+print("start test")
+
+import g3logPython as log
+from g3logPython import bindecode
+import os
+import sys
+import time
+
+print("g3logPython imported")
+
+logdir = "/tmp/g3logPython/"
+if not os.path.exists(logdir):
+    os.mkdir(logdir)
+logdir = logdir + "shared_ring"
+if not os.path.exists(logdir):
+    os.mkdir(logdir)
+
+logger = log.get_ifaceLogWorker(False)
+binSink = logger.BinSinks.new_Sink("shared ring records", "py_g3logTest_shm", logdir)
+logger.startSharedRing(256 * 1024, 1000) # small: the ring wraps many times
+
+print("loggers created")
+
+def fail(what):
+    print("ERROR: " + what)
+    sys.exit(1)
+
+children = 4
+count = 5000
+pids = []
+for child in range(children):
+    pid = os.fork()
+    if pid == 0:
+        # the child logs through the parent's ring: no sink of its own
+        worker = log.get_ifaceLogWorker(False)
+        for i in range(count):
+            log.info("child %d record %d", child, i, user="child")
+        try:
+            worker.BinSinks.new_Sink("child sink", "py_g3logTest_shm_child", logdir)
+            os._exit(2) # must throw
+        except Exception:
+            pass
+        os._exit(0 if worker.flush(10.0) else 3)
+    pids.append(pid)
+
+for pid in pids:
+    _, status = os.waitpid(pid, 0)
+    if os.WEXITSTATUS(status) != 0:
+        fail("child exit status %d" % os.WEXITSTATUS(status))
+log.info("parent record")
+if not logger.flush(10.0):
+    fail("flush timeout")
+
+stats = logger.stats()["shared_ring"]
+print(stats)
+if stats["role"] != "parent" or stats["received"] != children * count or stats["dropped"] != 0:
+    fail("bad shared ring stats")
+
+segment = binSink.segmentName().result()
+records = [rec for rec in bindecode.read_segments([segment]) if rec.message.startswith("child ")]
+if len(records) != children * count:
+    fail("%d records decoded instead of %d" % (len(records), children * count))
+for child in range(children):
+    mine = [rec for rec in records if rec.message.startswith("child %d " % child)]
+    if len(mine) != count or not mine[-1].message.startswith("child %d record %d user=child pid=" % (child, count - 1)):
+        fail("bad records of child %d" % child)
+if not records[0].file.endswith("shared_ring.py"):
+    fail("bad call-site " + bindecode.format_record(records[0]))
+print(bindecode.format_record(records[-1]))
+
+# the parent stops reading: the children drop their records at once, instead of waiting for room
+logger.stopSharedRing()
+pid = os.fork()
+if pid == 0:
+    start = time.monotonic()
+    for i in range(count * 4): # more than the ring holds
+        log.info("after the stop %d", i)
+    os._exit(0 if time.monotonic() - start < 5.0 else 4)
+_, status = os.waitpid(pid, 0)
+if os.WEXITSTATUS(status) != 0:
+    fail("child after the stop: exit status %d" % os.WEXITSTATUS(status))
+stats = logger.stats()["shared_ring"]
+print(stats)
+if stats["dropped"] != count * 4:
+    fail("records after the stop not dropped: %s" % stats)
+print("test finished")
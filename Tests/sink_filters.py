@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+
+print("start test")
+
+import g3logPython as log
+from g3logPython import bindecode
+import os
+import sys
+
+print("g3logPython imported")
+
+logdir = "/tmp/g3logPython/"
+if not os.path.exists(logdir):
+    os.mkdir(logdir)
+logdir = logdir + "sink_filters"
+if not os.path.exists(logdir):
+    os.mkdir(logdir)
+
+logger = log.get_ifaceLogWorker(False)
+allSink = logger.BinSinks.new_Sink("filters all", "py_g3logTest_filter_all", logdir)
+warnSink = logger.BinSinks.new_Sink("filters warning", "py_g3logTest_filter_warn", logdir)
+prefixSink = logger.BinSinks.new_Sink("filters prefix", "py_g3logTest_filter_prefix", logdir)
+
+warnSink.setMinLevel(log.g3WARNING)
+prefixSink.setFilePrefixes(["/opt/mylib/", "/srv/other/"])
+
+print("loggers created")
+
+def fail(what):
+    print("ERROR: " + what)
+    sys.exit(1)
+
+if warnSink.getMinLevel() != log.g3WARNING or allSink.getMinLevel() != log.g3DEBUG:
+    fail("bad min level")
+if prefixSink.getFilePrefixes() != ["/opt/mylib/", "/srv/other/"]:
+    fail("bad prefixes")
+
+count = 1000
+for i in range(count):
+    log.debug("filter debug %d" % i)
+    log.info("filter info %d" % i)
+    log.warning("filter warning %d" % i)
+    log.receivelog("/opt/mylib/module.py", 12, "libfunc", log.g3INFO, "filter lib %d" % i)
+if not logger.flush(10.0):
+    fail("flush timeout")
+
+def messages(sink):
+    return [rec.message for rec in bindecode.read_segments([sink.segmentName().result()]) if rec.message.startswith("filter ")]
+
+if len(messages(allSink)) != 4 * count:
+    fail("all: %d messages" % len(messages(allSink)))
+warn = messages(warnSink)
+if len(warn) != count or not all(text.startswith("filter warning") for text in warn):
+    fail("warning: %d messages" % len(warn))
+lib = messages(prefixSink)
+if len(lib) != count or not all(text.startswith("filter lib") for text in lib):
+    fail("prefix: %d messages" % len(lib))
+
+# changed while logging: from the next messages on
+warnSink.setMinLevel(log.g3DEBUG)
+prefixSink.setFilePrefixes([])
+log.debug("filter after change")
+if not logger.flush(10.0):
+    fail("flush timeout")
+if "filter after change" not in messages(warnSink) or "filter after change" not in messages(prefixSink):
+    fail("filters not updated")
+
+stats = {sink["name"]: sink for sink in logger.stats()["sinks"]}
+if stats["filters warning"]["filtered"] < 3 * count or stats["filters all"]["filtered"] != 0:
+    fail("bad filtered counts")
+if stats["filters warning"]["queue_depth"] > 0:
+    fail("the filtered messages are counted as queued")
+try:
+    warnSink.setMinLevel(42)
+    fail("invalid level accepted")
+except Exception:
+    pass
+print("test finished")
@@ -0,0 +1,36 @@
+#!/usr/bin/env python3
+
+print("start test")
+
+import g3logPython as log
+import os
+import threading
+
+print("g3logPython imported")
+
+logdir = "/tmp/g3logPython/"
+if not os.path.exists(logdir):
+    os.mkdir(logdir)
+
+logger = log.get_ifaceLogWorker(False)
+
+# one sink per shard, configured by several threads at the same time
+shards = [logger.LogRotateSinks.new_Sink("shard %d" % i, "py_g3logTest_shard%d" % i, logdir) for i in range(8)]
+colorTermSink = logger.ClrTermSinks.new_Sink("color term")
+
+print("loggers created")
+
+def worker(n):
+    for i in range(2000):
+        shards[(n + i) % len(shards)].setMaxArchiveLogCount(1 + i % 10)
+        if i % 500 == 0:
+            log.info("thread %d: %d sink calls" % (n, i))
+
+threads = [threading.Thread(target=worker, args=(n,)) for n in range(8)]
+for thd in threads:
+    thd.start()
+for thd in threads:
+    thd.join()
+
+log.info("all the sink calls were done")
+print("test finished")
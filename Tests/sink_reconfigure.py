@@ -0,0 +1,24 @@
+#!/usr/bin/env python3
+
+print("start test")
+
+import g3logPython as log
+print("g3logPython imported")
+
+logger = log.get_ifaceLogWorker(False)
+journaldSink = logger.SysLogSinks.new_Sink("journald_reconf","g3logPython_TEST_reconfigure")
+rotateSink = logger.LogRotateSinks.new_Sink("rotate_reconf","g3logPython_TEST_reconfigure","/tmp/")
+
+print("loggers created")
+
+# many reconfigurations: the stored data is recycled by the store's pool,
+# short and long strings (longer than a pool block) alternate
+for i in range(20000):
+    journaldSink.setIdentity("tenant_%d" % (i % 50))
+    journaldSink.setLogHeader(("header %d " % i) * (1 + i % 40))
+    rotateSink.setMaxArchiveLogCount(1 + i % 10)
+    if i % 1000 == 0:
+        log.info("reconfigured %d times" % i)
+
+log.warning("reconfiguration finished")
+print("test finished")
@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+
+print("start test")
+
+import g3logPython as log
+import asyncio
+import os
+import sys
+
+print("g3logPython imported")
+
+logdir_base = "/tmp/g3logPython/"
+if not os.path.exists(logdir_base):
+    os.mkdir(logdir_base)
+logdir1 = logdir_base + "results1"
+if not os.path.exists(logdir1):
+    os.mkdir(logdir1)
+logdir2 = logdir_base + "results2"
+if not os.path.exists(logdir2):
+    os.mkdir(logdir2)
+
+logger = log.get_ifaceLogWorker(False)
+logrotateSink = logger.LogRotateSinks.new_Sink("log results","py_g3logTest_results",logdir1)
+
+print("loggers created")
+
+# blocking wait
+res = logrotateSink.setMaxArchiveLogCount(7)
+if not res.wait(5.0) or not res.done():
+    print("ERROR: setMaxArchiveLogCount not completed")
+    sys.exit(1)
+if logrotateSink.getMaxArchiveLogCount().result(5.0) != 7:
+    print("ERROR: bad max archive log count")
+    sys.exit(1)
+print("log file: " + logrotateSink.logFileName().result())
+
+# asyncio: the event loop keeps running while the sink switches to a new file
+async def switch_file():
+    ticks = 0
+    async def ticker():
+        nonlocal ticks
+        while True:
+            ticks += 1
+            await asyncio.sleep(0)
+    tick_task = asyncio.ensure_future(ticker())
+    log.info("before the file change")
+    new_file = await logrotateSink.changeLogFile(logdir2, "py_g3logTest_results2")
+    log.info("after the file change")
+    size = await logrotateSink.getMaxLogSize()
+    tick_task.cancel()
+    return new_file, size
+
+new_file, size = asyncio.run(switch_file())
+print("new log file: %s, max log size: %d" % (new_file, size))
+if not new_file.startswith(logdir2):
+    print("ERROR: the log file was not changed")
+    sys.exit(1)
+
+# outside of a running loop, the loop must be given
+try:
+    logrotateSink.flush().as_future()
+    print("ERROR: as_future without a loop")
+    sys.exit(1)
+except RuntimeError:
+    pass
+loop = asyncio.new_event_loop()
+if loop.run_until_complete(logrotateSink.logFileName().as_future(loop)) != new_file:
+    print("ERROR: as_future with a loop")
+    sys.exit(1)
+loop.close()
+
+print("test finished")
@@ -0,0 +1,34 @@
+#!/usr/bin/env python3
+
+print("start test")
+
+import g3logPython as log
+import threading
+print("g3logPython imported")
+
+logger = log.get_ifaceLogWorker(False)
+logrotateSink = logger.LogRotateSinks.new_Sink("log rotate","py_g3logTest_staging","/tmp/")
+
+print("loggers created")
+
+# small ring: part of the messages will go through the synchronous fallback
+logger.startStaging(64, 4096)
+
+def worker(num):
+    for i in range(1000):
+        log.info("thread " + str(num) + " message " + str(i))
+
+threads = [threading.Thread(target=worker, args=(n,)) for n in range(8)]
+for t in threads:
+    t.start()
+for t in threads:
+    t.join()
+
+logger.stopStaging()
+log.info("staging stopped")
+
+# restart, and let the interface stop it on exit
+logger.startStaging()
+log.debug("staged again")
+
+print("check /tmp/py_g3logTest_staging*: 8000 thread messages expected")
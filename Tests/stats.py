@@ -0,0 +1,59 @@
+#!/usr/bin/env python3
+
+print("start test")
+
+import g3logPython as log
+import sys
+
+print("g3logPython imported")
+
+logger = log.get_ifaceLogWorker(False)
+rotateSink = logger.LogRotateSinks.new_Sink("stats rotate", "py_g3logTest_stats", "/tmp/")
+binSink = logger.BinSinks.new_Sink("stats binary", "py_g3logTest_stats", "/tmp/")
+
+print("loggers created")
+
+def fail(what):
+    print("ERROR: " + what)
+    sys.exit(1)
+
+before = logger.stats()
+count = 5000
+for i in range(count):
+    log.info("stats message %d" % i)
+    log.debug("stats debug %d", i)
+log.set_level(log.g3WARNING)
+for i in range(100):
+    log.info("filtered %d" % i)
+log.set_level(log.g3DEBUG)
+if not logger.flush(10.0):
+    fail("flush timeout")
+
+after = logger.stats()
+print(after)
+if after["captured"]["INFO"] - before["captured"]["INFO"] != count or after["captured"]["DEBUG"] - before["captured"]["DEBUG"] != count:
+    fail("bad captured counts")
+if after["filtered"] - before["filtered"] != 100:
+    fail("bad filtered count")
+if after["sent"] - before["sent"] != 2 * count:
+    fail("bad sent count")
+
+sinks = {s["name"]: s for s in after["sinks"]}
+for name in ("stats rotate", "stats binary"):
+    sink = sinks.get(name)
+    if sink is None or sink["messages"] < 2 * count:
+        fail("bad metrics for sink " + name)
+    if sink["queue_depth"] != 0:
+        fail("sink %s: queue not empty after flush" % name)
+    buckets = sink["latency_buckets"]
+    if buckets[-1][1] != sink["latency_count"] or any(b[1] > c[1] for b, c in zip(buckets, buckets[1:])):
+        fail("bad latency histogram for sink " + name)
+if after["queue_high_water"] < max(s["queue_high_water"] for s in after["sinks"]):
+    fail("bad queue high-water mark")
+
+# sink call data is freed once the calls have completed
+for i in range(100):
+    rotateSink.getMaxLogSize()
+rotateSink.flush().wait(10.0)
+print("store pending: %d" % logger.stats()["store_pending"])
+print("test finished")
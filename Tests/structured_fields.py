@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+
+print("start test")
+
+import g3logPython as log
+from g3logPython import bindecode
+import json
+import os
+import sys
+
+print("g3logPython imported")
+
+logdir = "/tmp/g3logPython/"
+if not os.path.exists(logdir):
+    os.mkdir(logdir)
+logdir = logdir + "fields/"
+if not os.path.exists(logdir):
+    os.mkdir(logdir)
+
+logger = log.get_ifaceLogWorker(False)
+jsonSink = logger.LogRotateSinks.new_Sink("fields json", "py_g3logTest_fields", logdir)
+jsonSink.setFieldFormat(log.g3FIELDS_JSON)
+binSink = logger.BinSinks.new_Sink("fields logfmt", "py_g3logTest_fields", logdir)
+binSink.setFieldFormat(log.g3FIELDS_LOGFMT)
+
+print("loggers created")
+
+class Unusual:
+    def __str__(self):
+        return "unusual \"object\""
+
+count = 1000
+for i in range(count):
+    log.info("request done", user="bob", latency_ms=i + 0.5, ok=(i % 2 == 0), obj=Unusual(), seq=i)
+log.warning("request %d failed", 7, user="alice")
+if not logger.flush(10.0):
+    print("ERROR: flush timeout")
+    sys.exit(1)
+
+fileName = jsonSink.logFileName().result()
+records = []
+with open(fileName) as f:
+    for line in f:
+        if line.startswith("{"):
+            records.append(json.loads(line))
+if len(records) != count + 1:
+    print("ERROR: %d JSON lines instead of %d" % (len(records), count + 1))
+    sys.exit(1)
+first = records[0]
+if first["msg"] != "request done" or first["user"] != "bob" or first["latency_ms"] != 0.5 or first["ok"] is not True \
+   or first["seq"] != 0 or first["obj"] != "unusual \"object\"" or first["level"] != "INFO":
+    print("ERROR: bad JSON record %s" % first)
+    sys.exit(1)
+if records[-1]["msg"] != "request 7 failed" or records[-1]["user"] != "alice":
+    print("ERROR: bad JSON record %s" % records[-1])
+    sys.exit(1)
+print(json.dumps(records[-1]))
+
+messages = [rec.message for rec in bindecode.read_segments([binSink.segmentName().result()]) if rec.message.startswith("msg=")]
+if len(messages) != count + 1 or messages[1] != 'msg="request done" user=bob latency_ms=1.5 ok=False obj="unusual \\"object\\"" seq=1':
+    print("ERROR: bad logfmt messages: %d %s" % (len(messages), messages[1:2]))
+    sys.exit(1)
+print(messages[-1])
+print("test finished")
@@ -0,0 +1,222 @@
+
+#include "BinarySink.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace g3 {
+
+namespace {
+
+const char Magic[8] = {'G', '3', 'L', 'P', 'B', 'I', 'N', '\0'};
+const uint32_t FormatVersion = 1;
+const size_t SegHeaderSize = 64;
+const size_t MsgHeaderSize = 40;
+const size_t SiteHeaderSize = 24;
+const size_t MaxSiteString = 4096; // longer file or function names are truncated in the segments
+enum : uint16_t {RecMessage = 1, RecSite = 2};
+
+size_t align8(size_t n) {return (n + 7) & ~(size_t)7;}
+
+template<typename T> void put(char *p, T val) {memcpy(p, &val, sizeof(T));}
+
+// the size is written last: a reader seeing it sees the whole record
+void publish(char *rec, uint32_t size) {__atomic_store_n(reinterpret_cast<uint32_t*>(rec), size, __ATOMIC_RELEASE);}
+
+const std::chrono::milliseconds MinRetryDelay(100), MaxRetryDelay(30000);
+
+int64_t nowNs()
+{
+return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // anonymous namespace
+
+BinarySink::BinarySink(const std::string &log_prefix, const std::string &log_directory):
+    _prefix(log_prefix), _directory(log_directory)
+{
+if(!_directory.empty() && _directory.back() != '/') _directory += '/';
+
+char buf[32];
+time_t now = time(nullptr);
+struct tm tm_now;
+localtime_r(&now, &tm_now);
+strftime(buf, sizeof(buf), "%Y%m%d-%H%M%S", &tm_now);
+_startTime = buf;
+
+if(!openSegment()) throw std::logic_error("BinarySink: cannot create the segment " + _segName);
+}
+
+BinarySink::~BinarySink()
+{
+closeSegment();
+}
+
+bool BinarySink::openSegment()
+{
+char seq[16];
+snprintf(seq, sizeof(seq), "%06llu", (unsigned long long)_segSeq);
+_segName = _directory + _prefix + "." + _startTime + "." + seq + ".g3bin";
+_capacity = _segmentSize;
+
+bool report = (_retryDelay.count() == 0); // once per failure streak
+_fd = open(_segName.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+if(_fd < 0) {
+    if(report) std::cerr << "BinarySink: cannot open " << _segName << ": " << strerror(errno) << std::endl;
+    return false;
+    }
+// preallocated: no block allocation while writing the records
+if(posix_fallocate(_fd, 0, _capacity) != 0 && ftruncate(_fd, _capacity) != 0) {
+    if(report) std::cerr << "BinarySink: cannot allocate " << _segName << ": " << strerror(errno) << std::endl;
+    close(_fd);
+    _fd = -1;
+    unlink(_segName.c_str());
+    return false;
+    }
+void *map = mmap(nullptr, _capacity, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+if(map == MAP_FAILED) {
+    if(report) std::cerr << "BinarySink: cannot map " << _segName << ": " << strerror(errno) << std::endl;
+    close(_fd);
+    _fd = -1;
+    unlink(_segName.c_str());
+    return false;
+    }
+_map = static_cast<char*>(map);
+
+memcpy(_map, Magic, sizeof(Magic));
+put<uint32_t>(_map + 8, FormatVersion);
+put<uint32_t>(_map + 12, SegHeaderSize);
+put<uint64_t>(_map + 16, _segSeq);
+put<int64_t>(_map + 24, nowNs());
+put<uint64_t>(_map + 32, _capacity);
+_pos = SegHeaderSize;
+return true;
+}
+
+bool BinarySink::nextSegment()
+{
+auto now = std::chrono::steady_clock::now();
+if(_map != nullptr) closeSegment();
+else if(now < _retryAt) return false; // the last attempt failed: not yet
+
+if(openSegment()) {
+    if(_retryDelay.count() > 0) std::cerr << "BinarySink: writing again to " << _segName << std::endl;
+    _retryDelay = std::chrono::milliseconds(0);
+    return true;
+    }
+_retryDelay = std::min(MaxRetryDelay, std::max(MinRetryDelay, _retryDelay * 2));
+_retryAt = now + _retryDelay;
+return false;
+}
+
+void BinarySink::closeSegment()
+{
+if(_map == nullptr) return;
+munmap(_map, _capacity);
+_map = nullptr;
+if(ftruncate(_fd, _pos) != 0) {} // only the used part is kept
+close(_fd);
+_fd = -1;
+_segSeq++;
+}
+
+uint32_t BinarySink::siteOf(const LogMessage &msg)
+{
+SiteRef ref{&msg._file, msg._line, &msg._function};
+auto search = _siteIds.find(ref);
+if(search != _siteIds.end()) return search -> second;
+
+_sites.push_back(Site{msg._file, msg._line, msg._function, UINT64_MAX});
+Site &site = _sites.back();
+uint32_t id = _sites.size() - 1;
+_siteIds.insert({SiteRef{&site.file, site.line, &site.function}, id});
+return id;
+}
+
+namespace {
+size_t siteLen(const std::string &str) {return (str.size() > MaxSiteString) ? MaxSiteString : str.size();}
+} // anonymous namespace
+
+size_t BinarySink::siteRecordSize(const Site &site)
+{
+return align8(SiteHeaderSize + siteLen(site.file) + siteLen(site.function));
+}
+
+void BinarySink::writeSite(uint32_t site_id)
+{
+Site &site = _sites[site_id];
+size_t size = siteRecordSize(site);
+size_t fileLen = siteLen(site.file), funcLen = siteLen(site.function);
+char *rec = _map + _pos;
+put<uint16_t>(rec + 4, RecSite);
+put<uint16_t>(rec + 6, 0);
+put<uint32_t>(rec + 8, site_id);
+put<int32_t>(rec + 12, site.line);
+put<uint32_t>(rec + 16, fileLen);
+put<uint32_t>(rec + 20, funcLen);
+memcpy(rec + SiteHeaderSize, site.file.data(), fileLen);
+memcpy(rec + SiteHeaderSize + fileLen, site.function.data(), funcLen);
+publish(rec, size);
+_pos += size;
+site.definedInSeg = _segSeq;
+}
+
+void BinarySink::ReceiveLogMessage(g3::LogMessageMover logEntry)
+{
+const LogMessage &msg = logEntry.get();
+uint32_t site_id = siteOf(msg);
+const Site &site = _sites[site_id];
+size_t siteSize = siteRecordSize(site);
+
+// the message is truncated if it doesn't fit in an empty segment
+size_t payload = msg._message.size();
+size_t maxPayload = _segmentSize - SegHeaderSize - siteSize - MsgHeaderSize;
+if(payload > maxPayload) payload = maxPayload;
+size_t size = align8(MsgHeaderSize + payload);
+
+size_t needed = size + ((site.definedInSeg == _segSeq) ? 0 : siteSize);
+if((_map == nullptr || _pos + needed > _capacity) && !nextSegment()) return; // dropped
+if(site.definedInSeg != _segSeq) writeSite(site_id);
+
+char *rec = _map + _pos;
+put<uint16_t>(rec + 4, RecMessage);
+put<uint16_t>(rec + 6, 0);
+put<int32_t>(rec + 8, msg._level.value);
+put<uint32_t>(rec + 12, site_id);
+put<int64_t>(rec + 16, std::chrono::duration_cast<std::chrono::nanoseconds>(msg._timestamp.time_since_epoch()).count());
+put<uint64_t>(rec + 24, std::hash<std::thread::id>()(msg._call_thread_id));
+put<uint32_t>(rec + 32, payload);
+put<uint32_t>(rec + 36, 0);
+memcpy(rec + MsgHeaderSize, msg._message.data(), payload);
+publish(rec, size);
+_pos += size;
+}
+
+void BinarySink::setSegmentSize(size_t bytes)
+{
+_segmentSize = (bytes < MinSegmentSize) ? MinSegmentSize : bytes;
+}
+
+std::string BinarySink::segmentName()
+{
+return _segName;
+}
+
+void BinarySink::flush()
+{
+if(_map != nullptr) msync(_map, _pos, MS_SYNC);
+}
+
+} // g3
@@ -0,0 +1,103 @@
+/*
+
+  Binary record sink.
+
+  The messages are written as fixed-layout binary records (no text formatting), into
+  preallocated, memory-mapped segment files: <directory>/<prefix>.<start time>.<seq>.g3bin
+  A new segment is started when the current one is full. Writing a message is a memcpy:
+  system calls are only made when a segment is opened or closed.
+
+  Decode them with g3logPython/bindecode.py ( python3 -m g3logPython.bindecode ).
+
+  Layout (little-endian, offsets in bytes):
+    segment header (64):  0 magic "G3LPBIN\0", 8 u32 version, 12 u32 header size, 16 u64 segment seq,
+                          24 i64 creation time (ns since epoch), 32 u64 segment capacity
+    then records, 8-bytes aligned. Each record starts with:
+                          0 u32 record size (padded; 0: no record written yet), 4 u16 type, 6 u16 (0)
+    call-site (type 2):   8 u32 site id, 12 i32 line, 16 u32 file length, 20 u32 function length,
+                          24 file, function. Written once per segment, before the first message using it.
+    message (type 1):     8 i32 level (g3log value), 12 u32 site id, 16 i64 timestamp (ns since epoch),
+                          24 u64 thread id (hash), 32 u32 payload length, 36 u32 (0), 40 payload (the message)
+  The record size is written last: a reader can follow a live segment.
+  A closed segment is truncated to its used size.
+  When a segment cannot be created (disk full...), its file is removed and the messages are dropped;
+  the same segment is tried again after a backoff (100 ms, doubled up to 30 s), the error is reported once.
+
+*/
+
+#pragma once
+
+#include <g3log/logmessage.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+
+namespace g3 {
+
+class BinarySink {
+public:
+  static const size_t DefaultSegmentSize = 64 * 1024 * 1024;
+  static const size_t MinSegmentSize = 64 * 1024;
+
+  // throws if the first segment cannot be created
+  BinarySink(const std::string &log_prefix, const std::string &log_directory);
+  ~BinarySink(); // closes the current segment
+  BinarySink(const BinarySink&) = delete;
+  BinarySink &operator=(const BinarySink&) = delete;
+
+  void ReceiveLogMessage(g3::LogMessageMover logEntry);
+
+  void setSegmentSize(size_t bytes); // used from the next segment on (minimum: MinSegmentSize)
+  std::string segmentName(); // file of the current segment
+  void flush(); // msync() of the current segment
+
+private:
+  struct Site {
+      std::string file;
+      int line;
+      std::string function;
+      uint64_t definedInSeg; // segment seq where the site record was last written
+    };
+  // lookup key on the sites, without copying the message's strings
+  struct SiteRef {
+      const std::string *file;
+      int line;
+      const std::string *function;
+      bool operator==(const SiteRef &o) const {return line == o.line && *file == *o.file && *function == *o.function;};
+    };
+  struct SiteRefHash {
+      size_t operator()(const SiteRef &s) const {
+          std::hash<std::string> h;
+          return (h(*s.file) * 31 + h(*s.function)) * 31 + (size_t)s.line;
+          };
+    };
+
+  uint32_t siteOf(const LogMessage &msg);
+  bool openSegment(); // false on error (the file is removed)
+  bool nextSegment(); // closes the current segment and opens the next one. false: the message is dropped
+  void closeSegment(); // the next segment gets the next seq
+  void writeSite(uint32_t site_id);
+  static size_t siteRecordSize(const Site &site);
+
+  std::string _prefix;
+  std::string _directory;
+  std::string _startTime;
+  size_t _segmentSize = DefaultSegmentSize;
+
+  uint64_t _segSeq = 0;
+  std::string _segName;
+  int _fd = -1;
+  char *_map = nullptr;
+  size_t _capacity = 0; // of the current segment
+  size_t _pos = 0; // write offset in the current segment
+  std::chrono::milliseconds _retryDelay{0}; // > 0: openSegment() has failed, retried at _retryAt
+  std::chrono::steady_clock::time_point _retryAt;
+
+  std::deque<Site> _sites; // index: site id (deque: the strings don't move, SiteRef points to them)
+  std::unordered_map<SiteRef, uint32_t, SiteRefHash> _siteIds;
+};
+
+} // g3
@@ -1,14 +1,147 @@
 
 #include "ColorTermSink.h"
 
+#include <cerrno>
+#include <sys/uio.h>
+#include <unistd.h>
+
 namespace g3 {
+
+namespace {
+
+// writes the whole buffer, whatever the partial writes and the signals
+void writeAll(const char *data, size_t len)
+{
+while(len > 0) {
+    ssize_t done = ::write(STDERR_FILENO, data, len);
+    if(done < 0) {
+        if(errno == EINTR) continue;
+        return; // nothing better to do with stderr
+        }
+    data += done;
+    len -= done;
+    }
+}
+
+std::string colorPrefix(int color) {return "\033[" + std::to_string(color) + "m";}
+
+} // anonymous namespace
+
+const std::string ColorTermSink::Suffix = "\033[m\n";
+
+const std::string &ColorTermSink::GetPrefix(const LEVELS level)
+{
+static const std::string yellow = colorPrefix(YELLOW), red = colorPrefix(RED), green = colorPrefix(GREEN), white = colorPrefix(WHITE);
+switch(GetColor(level)) {
+    case YELLOW: return yellow;
+    case RED: return red;
+    case GREEN: return green;
+    default: return white;
+    }
+}
+
+ColorTermSink::~ColorTermSink()
+{
+stopTimer();
+std::lock_guard<std::mutex> lock(_bufLck);
+flushLocked();
+}
     
 void ColorTermSink::ReceiveLogMessage(g3::LogMessageMover logEntry) 
 {
- auto level = logEntry.get()._level;
- auto color = GetColor(level);
+ReceiveLine(logEntry.get()._level, logEntry.get().toString());
+}
+
+void ColorTermSink::ReceiveLine(const LEVELS &level, const std::string &text)
+{
+const std::string &prefix = GetPrefix(level);
+bool fatal = g3::internal::wasFatal(level);
 
- std::cerr << "\033[" << color << "m" << logEntry.get().toString() << "\033[m" << std::endl;
+std::unique_lock<std::mutex> lock(_bufLck);
+if(_maxBytes == 0) {
+    lock.unlock();
+    // 1 system call per line, no temporary concatenation
+    struct iovec iov[3] = {{const_cast<char*>(prefix.data()), prefix.size()},
+                           {const_cast<char*>(text.data()), text.size()},
+                           {const_cast<char*>(Suffix.data()), Suffix.size()}};
+    ssize_t total = (ssize_t)(prefix.size() + text.size() + Suffix.size());
+    ssize_t done;
+    do {
+        done = ::writev(STDERR_FILENO, iov, 3);
+      } while(done < 0 && errno == EINTR);
+    if(done < total) { // partial write, or EAGAIN...: writeAll() writes the rest
+        std::string line = prefix + text + Suffix;
+        size_t written = (done > 0) ? done : 0;
+        writeAll(line.data() + written, line.size() - written);
+        }
+    return;
+    }
+
+if(_buffer.empty()) {
+    _firstBuffered = std::chrono::steady_clock::now();
+    _timerCv.notify_one();
+    }
+_buffer += prefix;
+_buffer += text;
+_buffer += Suffix;
+
+if(fatal || _buffer.size() >= _maxBytes || (_maxDelay.count() > 0 && std::chrono::steady_clock::now() - _firstBuffered >= _maxDelay))
+    flushLocked(); // max_delay_ms 0: by size only
+}
+
+void ColorTermSink::setBufferPolicy(size_t max_bytes, int max_delay_ms)
+{
+stopTimer();
+std::lock_guard<std::mutex> lock(_bufLck);
+flushLocked();
+_maxBytes = max_bytes;
+_maxDelay = std::chrono::milliseconds(max_delay_ms < 0 ? 0 : max_delay_ms);
+if(_maxBytes > 0) {
+    _buffer.reserve(_maxBytes + 512);
+    if(_maxDelay.count() > 0) {
+        _stopTimer = false;
+        _timerThd = std::thread(&g3::ColorTermSink::TimerWorker, this);
+        }
+    }
+}
+
+void ColorTermSink::flush()
+{
+std::lock_guard<std::mutex> lock(_bufLck);
+flushLocked();
+}
+
+void ColorTermSink::flushLocked()
+{
+if(_buffer.empty()) return;
+writeAll(_buffer.data(), _buffer.size());
+_buffer.clear(); // keeps the capacity
+}
+
+void ColorTermSink::stopTimer()
+{
+  {
+    std::lock_guard<std::mutex> lock(_bufLck);
+    _stopTimer = true;
+    _timerCv.notify_one();
+  }
+if(_timerThd.joinable()) _timerThd.join();
+}
+
+// timer thread worker function: the lines never stay buffered longer than max_delay_ms,
+// even when no other message arrives.
+void ColorTermSink::TimerWorker()
+{
+std::unique_lock<std::mutex> lock(_bufLck);
+while(!_stopTimer) {
+    if(_buffer.empty()) {
+        _timerCv.wait(lock);
+        continue;
+        }
+    auto deadline = _firstBuffered + _maxDelay;
+    if(std::chrono::steady_clock::now() >= deadline) flushLocked();
+    else _timerCv.wait_until(lock, deadline);
+    }
 }
   
 } // g3
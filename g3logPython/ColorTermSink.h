@@ -1,6 +1,10 @@
 #pragma once
 #include <string>
 #include <iostream>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <g3log/logmessage.hpp>
 
 // inspired by the code snippets of g3sinks
@@ -13,24 +17,44 @@ public:
   enum FG_Color {YELLOW = 33, RED = 31, GREEN=32, WHITE = 37};
 
   ColorTermSink() {};
+  ~ColorTermSink(); // flushes the buffer
   
   void ReceiveLogMessage(g3::LogMessageMover logEntry);
-//   {
-//      auto level = logEntry.get()._level;
-//      auto color = GetColor(level);
-// 
-//      std::cout << "\033[" << color << "m" 
-//        << logEntry.get().toString() << "\033[m" << std::endl;
-//   }
-//   
+  // a line already rendered (LogMessage::toString() ), shared with the other sinks (see render.h)
+  void ReceiveLine(const LEVELS &level, const std::string &text);
+  
+  // Buffering: the lines are accumulated, and written to stderr in one write(2) when
+  // max_bytes are buffered, when the oldest buffered line is max_delay_ms old, on FATAL, or on flush().
+  // max_bytes == 0: no buffering (default), each line is written with one writev(2).
+  // max_delay_ms == 0: no timer, the buffer is only written by size (and on FATAL, flush()).
+  void setBufferPolicy(size_t max_bytes, int max_delay_ms);
+  void flush();
+  
 private:
-  FG_Color GetColor(const LEVELS level) const {
+  // "\033[<color>m" for each color, and the line ending
+  static const std::string &GetPrefix(const LEVELS level);
+  static const std::string Suffix;
+  
+  static FG_Color GetColor(const LEVELS level) {
      if (level.value == WARNING.value) { return YELLOW; }
      if (level.value == DEBUG.value) { return GREEN; }
      if (g3::internal::wasFatal(level)) { return RED; }
 
      return WHITE;
   }
+  
+  void flushLocked(); // _bufLck must be held
+  void TimerWorker(); // flushes the buffer when max_delay_ms expires
+  void stopTimer();
+  
+  std::mutex _bufLck; // the timer thread flushes too
+  std::condition_variable _timerCv;
+  std::string _buffer;
+  size_t _maxBytes = 0;
+  std::chrono::milliseconds _maxDelay{0};
+  std::chrono::steady_clock::time_point _firstBuffered; // time of the oldest line in the buffer
+  bool _stopTimer = false;
+  std::thread _timerThd;
 };
 
 } // g3
@@ -0,0 +1,201 @@
+#include "FlightRecorderSink.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace g3 {
+
+const size_t FlightRecorderSink::MinSlotBytes;
+const size_t FlightRecorderSink::MaxSlotBytes;
+
+namespace {
+
+// copies what fits of "text" at "dst", returns the length copied
+uint16_t put(char *&dst, size_t &room, const std::string &text)
+{
+size_t len = std::min(text.size(), room);
+memcpy(dst, text.data(), len);
+dst += len;
+room -= len;
+return (uint16_t)len;
+}
+
+// as LogMessage::timestamp(): "%Y/%m/%d %H:%M:%S %f6", local time
+void appendTime(std::string &out, int64_t ns)
+{
+time_t seconds = (time_t)(ns / 1000000000);
+int64_t micros = (ns % 1000000000) / 1000;
+if(micros < 0) {
+    seconds--;
+    micros += 1000000;
+    }
+struct tm local;
+localtime_r(&seconds, &local);
+char buf[48];
+size_t len = strftime(buf, sizeof(buf), "%Y/%m/%d %H:%M:%S", &local);
+len += snprintf(buf + len, sizeof(buf) - len, " %06d", (int)micros);
+out.append(buf, len);
+}
+
+} // anonymous namespace
+
+FlightRecorderSink::FlightRecorderSink(size_t max_messages, size_t slot_bytes):
+    _maxMessages(std::max<size_t>(max_messages, 1)), _slotBytes(std::min(std::max(slot_bytes, MinSlotBytes), MaxSlotBytes)),
+    _slots(_maxMessages), _data(_maxMessages * _slotBytes)
+{
+}
+
+void FlightRecorderSink::ReceiveLogMessage(g3::LogMessageMover logEntry)
+{
+const LogMessage &msg = logEntry.get();
+record(msg);
+if(g3::internal::wasFatal(msg._level)) onFatal(false);
+}
+
+void FlightRecorderSink::record(const LogMessage &msg)
+{
+Slot &slot = _slots[_next];
+char *dst = _data.data() + _next * _slotBytes;
+size_t room = _slotBytes;
+
+slot.ns = std::chrono::duration_cast<std::chrono::nanoseconds>(msg._timestamp.time_since_epoch()).count();
+slot.line = msg._line;
+slot.levelLen = put(dst, room, msg._level.text);
+slot.fileLen = put(dst, room, msg._file);
+slot.functionLen = put(dst, room, msg._function);
+slot.messageLen = put(dst, room, msg._message);
+slot.truncated = (size_t)slot.levelLen + slot.fileLen + slot.functionLen + slot.messageLen
+                 < msg._level.text.size() + msg._file.size() + msg._function.size() + msg._message.size();
+
+_recorded++;
+if(slot.truncated) _truncated++;
+if(_kept == _maxMessages) _overwritten++;
+else _kept++;
+_next = (_next + 1 == _maxMessages) ? 0 : _next + 1;
+}
+
+std::string FlightRecorderSink::dump()
+{
+std::string out;
+out.reserve(_kept * (_slotBytes / 2 + 48) + 160);
+out += "---- flight recorder: last " + std::to_string(_kept) + " messages (" + std::to_string(_overwritten) + " older ones overwritten) ----\n";
+size_t index = (_next + _maxMessages - _kept) % _maxMessages; // the oldest
+for(size_t i = 0; i < _kept; i++) {
+    const Slot &slot = _slots[index];
+    const char *src = _data.data() + index * _slotBytes;
+    // LogMessage::toString(): "<time>\t<level> [<file>-><function>:<line>]\t<message>\n"
+    appendTime(out, slot.ns);
+    out += '\t';
+    out.append(src, slot.levelLen);
+    src += slot.levelLen;
+    out += " [";
+    out.append(src, slot.fileLen);
+    src += slot.fileLen;
+    out += "->";
+    out.append(src, slot.functionLen);
+    src += slot.functionLen;
+    out += ':';
+    out += std::to_string(slot.line);
+    out += "]\t";
+    out.append(src, slot.messageLen);
+    if(slot.truncated) out += " [truncated]";
+    out += '\n';
+    index = (index + 1 == _maxMessages) ? 0 : index + 1;
+    }
+out += "---- end of flight recorder ----\n";
+return out;
+}
+
+std::string FlightRecorderSink::dumpToFile(const std::string &path)
+{
+if(path.empty()) throw std::logic_error("FlightRecorderSink::dumpToFile: no file");
+if(!writeFile(path, dump())) {
+    _dumpErrors++;
+    throw std::runtime_error("FlightRecorderSink::dumpToFile: " + path + ": " + strerror(errno));
+    }
+_dumps++;
+return path;
+}
+
+void FlightRecorderSink::dumpToSink(Output out)
+{
+if(!out) return;
+out(dump()); // the exception of a removed sink reaches the handle's result
+_dumps++;
+}
+
+void FlightRecorderSink::setDumpFile(const std::string &path)
+{
+_dumpFile = path;
+}
+
+void FlightRecorderSink::setDumpSink(Output out)
+{
+_dumpSink = std::move(out);
+}
+
+void FlightRecorderSink::fatalDump()
+{
+onFatal(true);
+}
+
+// the process is about to end: nothing to report the errors to, but the counters
+void FlightRecorderSink::onFatal(bool from_hook)
+{
+if(_fatalDumped) return;
+_fatalDumped = from_hook;
+if(_dumpFile.empty() && !_dumpSink) return;
+std::string text = dump();
+if(!_dumpFile.empty()) {
+    if(writeFile(_dumpFile, text)) _dumps++;
+    else _dumpErrors++;
+    }
+if(_dumpSink) {
+    try {
+        _dumpSink(std::move(text));
+        _dumps++;
+        }
+    catch(...) {_dumpErrors++;}
+    }
+}
+
+void FlightRecorderSink::clear()
+{
+_next = 0;
+_kept = 0;
+}
+
+std::map<std::string, uint64_t> FlightRecorderSink::counters()
+{
+return {{"recorded", _recorded}, {"kept", _kept}, {"overwritten", _overwritten}, {"truncated", _truncated},
+        {"dumps", _dumps}, {"dump_errors", _dumpErrors}};
+}
+
+bool FlightRecorderSink::writeFile(const std::string &path, const std::string &text)
+{
+int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+if(fd < 0) return false;
+const char *data = text.data();
+size_t len = text.size();
+while(len > 0) {
+    ssize_t done = ::write(fd, data, len);
+    if(done < 0) {
+        if(errno == EINTR) continue;
+        int err = errno;
+        ::close(fd);
+        errno = err;
+        return false;
+        }
+    data += done;
+    len -= done;
+    }
+return ::close(fd) == 0;
+}
+
+} // g3
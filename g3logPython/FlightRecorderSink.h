@@ -0,0 +1,84 @@
+/*
+
+  Flight recorder sink: the last messages, kept in memory, written out only when needed.
+
+  The messages are copied into a ring of max_messages preallocated slots of slot_bytes each
+  (time, level, line, then the file, the function and the message, truncated to the slot):
+  recording a message is a few memcpy, without allocation nor system call. The oldest slot is reused
+  once the ring is full, so the ring always holds the last max_messages messages (max_messages * slot_bytes bytes).
+  Combined with the per-sink levels (cmmnSinkHndl::setMinLevel), DEBUG can go to the recorder only,
+  while the other sinks stay at INFO.
+
+  The ring is rendered (LogMessage::toString()'s layout, between two marker lines) and written:
+    - on demand: dump() returns the text, dumpToFile() appends it to a file,
+      dumpToSink() hands it to another sink (the handles: to a LogRotate sink),
+    - on FATAL: to the dump file and / or the dump sink set with setDumpFile() / setDumpSink().
+  A FATAL of python (log.fatal(), the logging handler) first waits for the messages logged before it to reach
+  the recorders, and has them dumped while the other sinks are still running (see ifaceLogWorker::dumpFlightRecorders()).
+  The other FATAL events (signals, g3log's CHECK) are dumped when the recorder receives them: the dump file
+  is written, the dump sink only gets the dump if g3log has not stopped it yet.
+  The ring is kept after a dump (clear() empties it).
+
+*/
+
+#pragma once
+
+#include <g3log/logmessage.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace g3 {
+
+class FlightRecorderSink {
+public:
+  static const size_t MinSlotBytes = 64;
+  static const size_t MaxSlotBytes = 65535;
+  typedef std::function<void(std::string)> Output; // gets the rendered ring, as one block of lines
+
+  // max_messages: at least 1, slot_bytes: clamped to [MinSlotBytes, MaxSlotBytes]
+  FlightRecorderSink(size_t max_messages, size_t slot_bytes);
+  FlightRecorderSink(const FlightRecorderSink&) = delete;
+  FlightRecorderSink &operator=(const FlightRecorderSink&) = delete;
+
+  void ReceiveLogMessage(g3::LogMessageMover logEntry);
+
+  std::string dump(); // the recorded lines, oldest first
+  std::string dumpToFile(const std::string &path); // appends the dump, returns the path. Throws on error
+  void dumpToSink(Output out);
+  void setDumpFile(const std::string &path); // written on FATAL ("": none)
+  void setDumpSink(Output out); // gets the dump on FATAL (empty: none)
+  void fatalDump(); // before a FATAL message: dumps now, and not again when the FATAL arrives
+  void clear();
+  std::map<std::string, uint64_t> counters(); // recorded, kept, overwritten, truncated, dumps, dump_errors
+
+private:
+  struct Slot {
+      int64_t ns; // since the epoch
+      int32_t line;
+      uint16_t levelLen, fileLen, functionLen, messageLen;
+      bool truncated;
+    };
+
+  void record(const LogMessage &msg);
+  void onFatal(bool from_hook);
+  bool writeFile(const std::string &path, const std::string &text); // false on error (errno set)
+
+  size_t _maxMessages;
+  size_t _slotBytes;
+  std::vector<Slot> _slots;
+  std::vector<char> _data; // _maxMessages * _slotBytes, slot i at i * _slotBytes
+  size_t _next = 0; // slot of the next message
+  size_t _kept = 0;
+
+  std::string _dumpFile;
+  Output _dumpSink;
+  bool _fatalDumped = false;
+
+  uint64_t _recorded = 0, _overwritten = 0, _truncated = 0, _dumps = 0, _dumpErrors = 0;
+};
+
+} // g3
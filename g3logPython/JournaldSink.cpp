@@ -0,0 +1,84 @@
+
+#define SD_JOURNAL_SUPPRESS_LOCATION // CODE_FILE... are set from the LogMessage, not from this file
+#include "JournaldSink.h"
+#include "fields.h"
+
+#include <systemd/sd-journal.h>
+#include <syslog.h>
+
+#include <cctype>
+#include <cstring>
+
+namespace g3 {
+
+namespace {
+enum {FieldMessage, FieldPriority, FieldFile, FieldLine, FieldFunc, FieldLevel, NumFixedFields};
+} // anonymous namespace
+
+JournaldSink::JournaldSink(const std::string &identifier)
+{
+setIdentifier(identifier);
+_bufs.resize(NumFixedFields);
+}
+
+void JournaldSink::setIdentifier(const std::string &identifier)
+{
+_identifier = "SYSLOG_IDENTIFIER=" + identifier;
+}
+
+std::string JournaldSink::identifier()
+{
+return _identifier.substr(sizeof("SYSLOG_IDENTIFIER=") - 1);
+}
+
+int JournaldSink::priorityOf(const LEVELS &level)
+{
+if(level.value == DEBUG.value) return LOG_DEBUG;
+if(level.value == INFO.value) return LOG_INFO;
+if(level.value == WARNING.value) return LOG_WARNING;
+if(g3::internal::wasFatal(level)) return LOG_CRIT;
+return LOG_ERR;
+}
+
+std::string JournaldSink::fieldName(const std::string &key)
+{
+std::string name;
+name.reserve(key.size());
+for(unsigned char c: key) name += std::isalnum(c) ? (char)std::toupper(c) : '_';
+if(name.empty() || name[0] == '_' || std::isdigit((unsigned char)name[0])) name = "FIELD_" + name;
+if(name.size() > 64) name.resize(64);
+return name;
+}
+
+void JournaldSink::ReceiveLogMessage(g3::LogMessageMover logEntry)
+{
+const LogMessage &msg = logEntry.get();
+
+_bufs[FieldMessage].assign("MESSAGE=").append(msg._message);
+_bufs[FieldPriority].assign("PRIORITY=").append(1, (char)('0' + priorityOf(msg._level)));
+_bufs[FieldFile].assign("CODE_FILE=").append(msg._file);
+_bufs[FieldLine].assign("CODE_LINE=").append(std::to_string(msg._line));
+_bufs[FieldFunc].assign("CODE_FUNC=").append(msg._function);
+_bufs[FieldLevel].assign("G3LOG_LEVEL=").append(msg._level.text);
+
+size_t count = NumFixedFields;
+if(hasFields(msg)) {
+    for(auto &field: decodeFields(msg._expression)) {
+        if(_bufs.size() <= count) _bufs.emplace_back();
+        _bufs[count].assign(fieldName(field.key)).append(1, '=').append(field.value.to_str());
+        count++;
+        }
+    }
+
+_iov.resize(count + 1);
+for(size_t i = 0; i < count; i++) {
+    _iov[i].iov_base = const_cast<char*>(_bufs[i].data());
+    _iov[i].iov_len = _bufs[i].size();
+    }
+_iov[count].iov_base = const_cast<char*>(_identifier.data());
+_iov[count].iov_len = _identifier.size();
+
+sd_journal_sendv(_iov.data(), _iov.size()); // nothing better to do if journald is not there
+}
+
+} // g3
@@ -0,0 +1,45 @@
+/*
+
+  journald sink: each message is sent with one sd_journal_sendv() call, as separate journal fields:
+    MESSAGE, PRIORITY, CODE_FILE, CODE_LINE, CODE_FUNC, SYSLOG_IDENTIFIER, G3LOG_LEVEL,
+    plus the structured fields of the message (see fields.h), as KEY=value ( user="bob" -> USER=bob ).
+  No header is formatted, and the fields can be queried: journalctl SYSLOG_IDENTIFIER=myapp USER=bob
+
+  The field buffers are kept between the messages: no allocation once they have grown.
+
+*/
+
+#pragma once
+
+#include <g3log/logmessage.hpp>
+
+#include <string>
+#include <vector>
+
+#include <sys/uio.h>
+
+namespace g3 {
+
+class JournaldSink {
+public:
+  explicit JournaldSink(const std::string &identifier);
+  JournaldSink(const JournaldSink&) = delete;
+  JournaldSink &operator=(const JournaldSink&) = delete;
+
+  void ReceiveLogMessage(g3::LogMessageMover logEntry);
+
+  void setIdentifier(const std::string &identifier);
+  std::string identifier();
+
+  // journald field name of a structured field: upper case, [A-Z0-9_], not starting with '_' or a digit
+  static std::string fieldName(const std::string &key);
+
+private:
+  static int priorityOf(const LEVELS &level); // syslog(3) priority
+
+  std::string _identifier; // "SYSLOG_IDENTIFIER=..."
+  std::vector<std::string> _bufs; // one per field, reused
+  std::vector<struct iovec> _iov;
+};
+
+} // g3
@@ -0,0 +1,491 @@
+//
+//  implementation of class NetSink
+//
+// See the description in NetSink.h.
+// The sink's thread appends to _open and pushes the closed batches at the back of _queue (under _lck),
+// the I/O thread sends them from the front and pops them: a batch being sent is not touched by
+// the sink's thread (std::deque::push_back doesn't move the elements), and is sent without the lock.
+//
+
+#include "NetSink.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace g3 {
+
+namespace {
+
+const int MaxBatchesPerCall = 64; // batches per sendmmsg() / writev()
+const std::chrono::milliseconds MinBackoff(100), MaxBackoff(30000);
+const std::chrono::milliseconds Linger(1000); // on destruction
+
+// UDP: each record is one line of the datagram
+std::string escapeNewlines(const std::string &line, size_t len)
+{
+std::string out;
+out.reserve(len + 16);
+for(size_t i = 0; i < len; i++) {
+    if(line[i] == '\n') out += "\\n";
+    else out += line[i];
+    }
+return out;
+}
+
+} // anonymous namespace
+
+const size_t NetSink::DefaultUdpBatchBytes;
+const size_t NetSink::DefaultTcpBatchBytes;
+const size_t NetSink::MaxDatagramBytes;
+const size_t NetSink::DefaultSpillBytes;
+
+NetSink::NetSink(const std::string &address): _address(address)
+{
+std::string rest;
+if(address.compare(0, 6, "udp://") == 0) _tcp = false;
+else if(address.compare(0, 6, "tcp://") == 0) _tcp = true;
+else throw std::logic_error("NetSink: the address must be udp://host:port or tcp://host:port");
+rest = address.substr(6);
+
+size_t colon;
+if(!rest.empty() && rest[0] == '[') { // [IPv6]:port
+    size_t end = rest.find(']');
+    if(end == std::string::npos || end + 1 >= rest.size() || rest[end + 1] != ':') throw std::logic_error("NetSink: bad address " + address);
+    _host = rest.substr(1, end - 1);
+    colon = end + 1;
+} else {
+    colon = rest.rfind(':');
+    if(colon == std::string::npos) throw std::logic_error("NetSink: no port in " + address);
+    _host = rest.substr(0, colon);
+}
+_port = rest.substr(colon + 1);
+if(_host.empty() || _port.empty()) throw std::logic_error("NetSink: bad address " + address);
+_maxBatch = _tcp ? DefaultTcpBatchBytes : DefaultUdpBatchBytes;
+
+_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+_epollFd = epoll_create1(EPOLL_CLOEXEC);
+if(_wakeFd < 0 || _epollFd < 0) {
+    int err = errno;
+    if(_wakeFd >= 0) close(_wakeFd);
+    if(_epollFd >= 0) close(_epollFd);
+    throw std::logic_error(std::string("NetSink: ") + strerror(err));
+    }
+struct epoll_event ev = {};
+ev.events = EPOLLIN;
+ev.data.fd = _wakeFd;
+epoll_ctl(_epollFd, EPOLL_CTL_ADD, _wakeFd, &ev);
+
+_ioThd = std::thread(&g3::NetSink::IoWorker, this);
+}
+
+NetSink::~NetSink()
+{
+  {
+    std::lock_guard<std::mutex> lock(_lck);
+    _terminate = true;
+  }
+wakeIo();
+_ioThd.join();
+closeSocket();
+freeAddresses();
+close(_epollFd);
+close(_wakeFd);
+}
+
+void NetSink::ReceiveLine(std::string line)
+{
+_records.fetch_add(1, std::memory_order_relaxed);
+size_t len = line.size();
+if(len > 0 && line[len - 1] == '\n') len--;
+if(!_tcp && memchr(line.data(), '\n', len) != nullptr) {
+    line = escapeNewlines(line, len);
+    len = line.size();
+    }
+if(!_tcp && len > MaxDatagramBytes - 1) len = MaxDatagramBytes - 1;
+size_t recSize = _tcp ? 4 + len : len + 1;
+
+bool wake = false, full = false;
+  {
+    std::lock_guard<std::mutex> lock(_lck);
+    if(_queuedBytes + recSize > _maxSpill) full = true;
+    else {
+        if(!_open.data.empty() && _open.data.size() + recSize > _maxBatch) {
+            closeBatchLocked();
+            wake = true;
+            }
+        if(_open.data.empty()) {
+            _open.data.reserve(std::max(_maxBatch, recSize));
+            _openSince = std::chrono::steady_clock::now();
+            wake = true; // the I/O thread times the batch
+            }
+        if(_tcp) {
+            char hdr[4] = {(char)(len >> 24), (char)(len >> 16), (char)(len >> 8), (char)len};
+            _open.data.append(hdr, 4).append(line, 0, len);
+        } else {
+            _open.data.append(line, 0, len).append(1, '\n');
+        }
+        _open.records++;
+        _queuedBytes += recSize;
+        if(_open.data.size() >= _maxBatch) closeBatchLocked();
+        }
+  }
+if(full) overflow(line);
+else if(wake) wakeIo();
+}
+
+void NetSink::closeBatchLocked()
+{
+if(_open.data.empty()) return;
+_queue.push_back(std::move(_open));
+_open = Batch();
+}
+
+void NetSink::wakeIo()
+{
+uint64_t one = 1;
+ssize_t rc = write(_wakeFd, &one, sizeof(one));
+(void)rc; // EAGAIN: the counter is already set
+}
+
+// on the sink's thread: the overflow file is only used there
+void NetSink::overflow(const std::string &line)
+{
+if(_overflowFile) {
+    _overflowFile -> save(line);
+    _spilled.fetch_add(1, std::memory_order_relaxed);
+} else {
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+}
+}
+
+void NetSink::setBatchPolicy(size_t max_bytes, int max_delay_ms)
+{
+  {
+    std::lock_guard<std::mutex> lock(_lck);
+    closeBatchLocked();
+    _maxBatch = std::max<size_t>(max_bytes, 1);
+    if(!_tcp) _maxBatch = std::min(_maxBatch, MaxDatagramBytes);
+    _maxDelay = std::chrono::milliseconds(std::max(0, max_delay_ms));
+  }
+wakeIo();
+}
+
+void NetSink::setSpillPolicy(size_t max_spill_bytes, const std::string &overflow_prefix, const std::string &overflow_directory)
+{
+  {
+    std::lock_guard<std::mutex> lock(_lck);
+    _maxSpill = max_spill_bytes;
+  }
+if(overflow_directory.empty()) _overflowFile.reset();
+else _overflowFile.reset(new LogRotate(overflow_prefix.empty() ? "netsink_overflow" : overflow_prefix, overflow_directory));
+}
+
+void NetSink::flush()
+{
+  {
+    std::lock_guard<std::mutex> lock(_lck);
+    closeBatchLocked();
+  }
+wakeIo();
+if(_overflowFile) _overflowFile -> flush();
+}
+
+std::string NetSink::address()
+{
+return _address;
+}
+
+std::map<std::string, uint64_t> NetSink::counters()
+{
+std::map<std::string, uint64_t> out;
+out["records"] = _records.load(std::memory_order_relaxed);
+out["sent_records"] = _sentRecords.load(std::memory_order_relaxed);
+out["sent_batches"] = _sentBatches.load(std::memory_order_relaxed);
+out["dropped"] = _dropped.load(std::memory_order_relaxed);
+out["spilled"] = _spilled.load(std::memory_order_relaxed);
+out["send_errors"] = _sendErrors.load(std::memory_order_relaxed);
+out["connects"] = _connects.load(std::memory_order_relaxed);
+out["connected"] = _connected.load(std::memory_order_relaxed) ? 1 : 0;
+std::lock_guard<std::mutex> lock(_lck);
+out["queued_bytes"] = _queuedBytes;
+return out;
+}
+
+// ============================ I/O thread ============================
+
+bool NetSink::openSocket()
+{
+if(_addrs == nullptr) {
+    struct addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = _tcp ? SOCK_STREAM : SOCK_DGRAM;
+    if(getaddrinfo(_host.c_str(), _port.c_str(), &hints, &_addrs) != 0) _addrs = nullptr;
+    _nextAddr = _addrs;
+    }
+int fd = -1;
+while(fd < 0 && _nextAddr != nullptr) {
+    struct addrinfo *ai = _nextAddr;
+    _nextAddr = ai -> ai_next;
+    fd = socket(ai -> ai_family, ai -> ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai -> ai_protocol);
+    if(fd < 0) continue;
+    if(connect(fd, ai -> ai_addr, ai -> ai_addrlen) == 0) {
+        _connecting = false;
+        break;
+        }
+    if(errno == EINPROGRESS) { // the next addresses are kept, in case it fails
+        _connecting = true;
+        break;
+        }
+    close(fd);
+    fd = -1;
+    }
+
+if(fd < 0) { // unknown host, or no address reachable
+    _sendErrors.fetch_add(1, std::memory_order_relaxed);
+    retryLater();
+    return false;
+    }
+_sock = fd;
+_frontSent = 0; // the batch interrupted by the last disconnection is sent again
+struct epoll_event ev = {};
+ev.events = EPOLLIN | (_connecting ? (uint32_t)EPOLLOUT : 0u);
+ev.data.fd = _sock;
+epoll_ctl(_epollFd, EPOLL_CTL_ADD, _sock, &ev);
+_waitWritable = _connecting;
+if(!_connecting) connected();
+return true;
+}
+
+void NetSink::connected()
+{
+freeAddresses(); // resolved again on the next connection
+_connecting = false;
+_connected.store(true);
+_connects.fetch_add(1, std::memory_order_relaxed);
+_backoff = std::chrono::milliseconds(0);
+}
+
+void NetSink::retryLater()
+{
+closeSocket();
+freeAddresses();
+_backoff = std::min(MaxBackoff, std::max(MinBackoff, _backoff * 2));
+_retryAt = std::chrono::steady_clock::now() + _backoff;
+}
+
+void NetSink::tryNextAddress()
+{
+if(_nextAddr == nullptr) {
+    retryLater();
+    return;
+    }
+closeSocket();
+_retryAt = std::chrono::steady_clock::now(); // opened by the next iteration of IoWorker()
+}
+
+void NetSink::freeAddresses()
+{
+if(_addrs != nullptr) freeaddrinfo(_addrs);
+_addrs = nullptr;
+_nextAddr = nullptr;
+}
+
+// EPOLLOUT only while connecting, or while batches wait for the socket (level-triggered)
+void NetSink::watchWritable(bool on)
+{
+if(on == _waitWritable) return;
+struct epoll_event ev = {};
+ev.events = EPOLLIN | (on ? (uint32_t)EPOLLOUT : 0u);
+ev.data.fd = _sock;
+epoll_ctl(_epollFd, EPOLL_CTL_MOD, _sock, &ev);
+_waitWritable = on;
+}
+
+void NetSink::closeSocket()
+{
+if(_sock < 0) return;
+epoll_ctl(_epollFd, EPOLL_CTL_DEL, _sock, nullptr);
+close(_sock);
+_sock = -1;
+_connecting = false;
+_waitWritable = false;
+_connected.store(false);
+}
+
+// sends the closed batches until the socket would block
+bool NetSink::sendReady()
+{
+for(;;) {
+    Batch *batches[MaxBatchesPerCall];
+    int count = 0;
+      {
+        std::lock_guard<std::mutex> lock(_lck);
+        for(auto &batch: _queue) {
+            batches[count++] = &batch;
+            if(count == MaxBatchesPerCall) break;
+            }
+      }
+    if(count == 0) break;
+
+    int done = 0; // batches completely sent
+    bool blocked = false;
+    if(_tcp) {
+        struct iovec iov[MaxBatchesPerCall];
+        size_t total = 0;
+        for(int i = 0; i < count; i++) {
+            size_t skip = (i == 0) ? _frontSent : 0;
+            iov[i].iov_base = const_cast<char*>(batches[i] -> data.data()) + skip;
+            iov[i].iov_len = batches[i] -> data.size() - skip;
+            total += iov[i].iov_len;
+            }
+        struct msghdr msg = {};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        ssize_t rc = sendmsg(_sock, &msg, MSG_NOSIGNAL); // writev(), without SIGPIPE
+        if(rc < 0) {
+            if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                _sendErrors.fetch_add(1, std::memory_order_relaxed);
+                return false;
+                }
+            blocked = (errno != EINTR);
+        } else {
+            size_t written = rc;
+            while(done < count && written >= iov[done].iov_len) written -= iov[done++].iov_len;
+            _frontSent = (done < count) ? written + (done == 0 ? _frontSent : 0) : 0;
+            blocked = ((size_t)rc < total);
+        }
+    } else {
+        struct mmsghdr msgs[MaxBatchesPerCall];
+        struct iovec iov[MaxBatchesPerCall];
+        memset(msgs, 0, sizeof(msgs));
+        for(int i = 0; i < count; i++) {
+            iov[i].iov_base = const_cast<char*>(batches[i] -> data.data());
+            iov[i].iov_len = batches[i] -> data.size();
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+        int rc = sendmmsg(_sock, msgs, count, 0);
+        if(rc < 0) {
+            if(errno == EAGAIN || errno == EWOULDBLOCK) blocked = true;
+            else if(errno != EINTR) { // refused (no collector listening), too large...: the datagram is lost
+                _sendErrors.fetch_add(1, std::memory_order_relaxed);
+                _dropped.fetch_add(batches[0] -> records, std::memory_order_relaxed);
+                std::lock_guard<std::mutex> lock(_lck);
+                _queuedBytes -= _queue.front().data.size();
+                _queue.pop_front();
+                continue;
+                }
+        } else {
+            done = rc;
+            blocked = (rc < count);
+        }
+    }
+
+    if(done > 0) {
+        std::lock_guard<std::mutex> lock(_lck);
+        for(int i = 0; i < done; i++) {
+            _sentBatches.fetch_add(1, std::memory_order_relaxed);
+            _sentRecords.fetch_add(_queue.front().records, std::memory_order_relaxed);
+            _queuedBytes -= _queue.front().data.size();
+            _queue.pop_front();
+            }
+        }
+    if(blocked) break;
+  }
+return true;
+}
+
+int NetSink::ioTimeoutMs(std::chrono::steady_clock::time_point now)
+{
+auto wake = now + std::chrono::milliseconds(1000);
+  {
+    std::lock_guard<std::mutex> lock(_lck);
+    if(!_open.data.empty()) wake = std::min(wake, _openSince + _maxDelay);
+  }
+if(_sock < 0) wake = std::min(wake, _retryAt);
+auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(wake - now).count();
+return (int)std::max<decltype(ms)>(0, ms) + ((wake > now) ? 1 : 0); // rounded up
+}
+
+// I/O thread worker function
+void NetSink::IoWorker()
+{
+bool lingering = false;
+std::chrono::steady_clock::time_point lingerUntil;
+_retryAt = std::chrono::steady_clock::now();
+for(;;) {
+    auto now = std::chrono::steady_clock::now();
+    bool pending;
+      {
+        std::lock_guard<std::mutex> lock(_lck);
+        if(!_open.data.empty() && (now - _openSince >= _maxDelay || _terminate)) closeBatchLocked();
+        if(_terminate && !lingering) {
+            lingering = true;
+            lingerUntil = now + Linger;
+            }
+        pending = !_queue.empty();
+      }
+    if(lingering && (!pending || now >= lingerUntil)) break;
+
+    if(_sock < 0 && now >= _retryAt) openSocket();
+    if(_sock >= 0 && !_connecting && pending && !sendReady()) retryLater();
+    if(_sock >= 0) {
+        std::unique_lock<std::mutex> lock(_lck);
+        pending = !_queue.empty();
+        lock.unlock();
+        watchWritable(_connecting || pending);
+        }
+
+    struct epoll_event events[4];
+    int timeout = ioTimeoutMs(now);
+    if(lingering) timeout = std::min(timeout, 10);
+    int n = epoll_wait(_epollFd, events, 4, timeout);
+    for(int i = 0; i < n; i++) {
+        if(events[i].data.fd == _wakeFd) {
+            uint64_t val;
+            ssize_t rc = read(_wakeFd, &val, sizeof(val));
+            (void)rc;
+            continue;
+            }
+        if(events[i].data.fd != _sock) continue;
+        bool failed = (events[i].events & (EPOLLERR | EPOLLHUP)) != 0;
+        if(_connecting && !failed && (events[i].events & EPOLLOUT)) {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            getsockopt(_sock, SOL_SOCKET, SO_ERROR, &err, &len);
+            if(err == 0) connected();
+            else failed = true;
+            }
+        if(!failed && (events[i].events & EPOLLIN)) { // the collector has nothing to say: drained, or closed
+            char buf[512];
+            ssize_t rc = recv(_sock, buf, sizeof(buf), 0);
+            if(_tcp && (rc == 0 || (rc < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))) failed = true;
+            }
+        if(failed && !_tcp) { // ICMP error of a datagram (no collector listening): read, and the socket is kept
+            int err = 0;
+            socklen_t len = sizeof(err);
+            getsockopt(_sock, SOL_SOCKET, SO_ERROR, &err, &len);
+            if(err != 0) _sendErrors.fetch_add(1, std::memory_order_relaxed);
+            continue;
+            }
+        if(failed) {
+            _sendErrors.fetch_add(1, std::memory_order_relaxed);
+            if(_connecting) tryNextAddress();
+            else retryLater();
+            }
+        }
+  }
+}
+
+} // g3
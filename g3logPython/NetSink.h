@@ -0,0 +1,122 @@
+/*
+
+  Network sink: sends the log lines to a central collector, without a local file and agent.
+
+  Address: "udp://host:port" or "tcp://host:port" (host name or IPv4 / IPv6 address, "[::1]" form for IPv6).
+    - UDP: datagrams of newline-terminated lines, batched up to max_bytes (default 1400: no IP fragmentation).
+      A record is one line: the newlines inside a message are sent as "\n" (a backslash and 'n').
+    - TCP: frames of one record each, a u32 length (big-endian) then the line without its '\n',
+      batched up to max_bytes (default 64 KiB) per write.
+
+  The sink's thread (g3log's) only appends the lines to the open batch: no system call per message.
+  A batch is closed when it is full, when it is max_delay_ms old, or on flush(), and handed to the sink's
+  I/O thread (epoll, non-blocking socket): one sendmmsg(2) / writev(2) for all the batches ready.
+  The I/O thread connects (TCP) to each address of the host in turn, until one accepts the connection,
+  and reconnects after an error with a backoff (100 ms, doubled up to 30 s) once all of them have failed.
+  A batch interrupted by a disconnection is sent again in full: a collector may get its first records twice.
+
+  Spill buffer: the batches waiting for the network are bounded to max_spill_bytes (default 4 MiB).
+  When it is full (slow or unreachable collector), the next lines are dropped (counted), or appended to a local
+  LogRotate file if an overflow file is set. The g3log worker is never blocked by the network.
+
+*/
+
+#pragma once
+
+#include <g3sinks/LogRotate.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct addrinfo;
+
+namespace g3 {
+
+class NetSink {
+public:
+  static const size_t DefaultUdpBatchBytes = 1400;
+  static const size_t DefaultTcpBatchBytes = 64 * 1024;
+  static const size_t MaxDatagramBytes = 65507; // longer UDP lines are truncated
+  static const size_t DefaultSpillBytes = 4 * 1024 * 1024;
+
+  // throws on a malformed address (the host is resolved by the I/O thread, on each connection)
+  explicit NetSink(const std::string &address);
+  ~NetSink(); // sends the batches still queued (for up to 1 s), and joins the I/O thread
+  NetSink(const NetSink&) = delete;
+  NetSink &operator=(const NetSink&) = delete;
+
+  void ReceiveLine(std::string line);
+
+  void setBatchPolicy(size_t max_bytes, int max_delay_ms);
+  // overflow_directory empty: the lines are dropped when the spill buffer is full
+  void setSpillPolicy(size_t max_spill_bytes, const std::string &overflow_prefix, const std::string &overflow_directory);
+  void flush(); // closes the open batch (does not wait for the network)
+
+  std::string address();
+  std::map<std::string, uint64_t> counters();
+
+private:
+  struct Batch {
+      std::string data;
+      uint64_t records = 0;
+    };
+
+  void closeBatchLocked(); // _lck must be held
+  void wakeIo();
+  void overflow(const std::string &line);
+
+  void IoWorker();
+  bool openSocket(); // false: retry later
+  void connected();
+  void closeSocket();
+  void retryLater(); // closes the socket, and reconnects after the backoff
+  void tryNextAddress(); // the connection to the current address failed: the next one, or retryLater()
+  void freeAddresses();
+  void watchWritable(bool on);
+  bool sendReady(); // false on a connection error
+  int ioTimeoutMs(std::chrono::steady_clock::time_point now);
+
+  std::string _address;
+  bool _tcp = false;
+  std::string _host;
+  std::string _port;
+
+  // sink thread and I/O thread:
+  std::mutex _lck;
+  Batch _open;
+  std::chrono::steady_clock::time_point _openSince;
+  std::deque<Batch> _queue; // closed batches, the front one may be partly sent (TCP)
+  size_t _queuedBytes = 0; // _open + _queue
+  size_t _maxBatch;
+  std::chrono::milliseconds _maxDelay{100};
+  size_t _maxSpill = DefaultSpillBytes;
+  bool _terminate = false;
+
+  // sink thread only:
+  std::unique_ptr<LogRotate> _overflowFile;
+
+  // I/O thread only:
+  int _wakeFd = -1; // eventfd
+  int _epollFd = -1;
+  int _sock = -1;
+  struct addrinfo *_addrs = nullptr; // of the connection in progress: getaddrinfo()'s list
+  struct addrinfo *_nextAddr = nullptr; // the next one to try, nullptr: none left
+  bool _connecting = false; // TCP connect() in progress
+  bool _waitWritable = false; // EPOLLOUT requested
+  size_t _frontSent = 0; // bytes of _queue.front() already written (TCP)
+  std::chrono::milliseconds _backoff{0};
+  std::chrono::steady_clock::time_point _retryAt;
+
+  std::atomic<uint64_t> _records{0}, _sentRecords{0}, _sentBatches{0}, _dropped{0}, _spilled{0}, _sendErrors{0}, _connects{0};
+  std::atomic<bool> _connected{false};
+  std::thread _ioThd;
+};
+
+} // g3
@@ -0,0 +1,39 @@
+/*
+
+  Sink added by another compiled module through the plugin API (see plugin.h):
+  the g3log sink class of the plugin sinks, forwarding the messages to the plugin's g3::plugin::Sink.
+
+*/
+
+#pragma once
+
+#include "plugin.h"
+
+#include <memory>
+#include <string>
+
+namespace g3 {
+
+class PluginSink {
+public:
+  explicit PluginSink(std::shared_ptr<plugin::Sink> sink): _sink(std::move(sink)) {};
+  PluginSink(const PluginSink&) = delete;
+  PluginSink &operator=(const PluginSink&) = delete;
+
+  // an exception of the plugin would end the sink's thread: the message is lost instead
+  void ReceiveLogMessage(g3::LogMessageMover logEntry) {
+      try { _sink -> receive(logEntry); } catch(...) {}
+      };
+  void flush() {
+      try { _sink -> flush(); } catch(...) {}
+      };
+  std::string control(const std::string &command) {return _sink -> control(command);}; // an exception reaches the handle's result
+
+private:
+  std::shared_ptr<plugin::Sink> _sink;
+};
+
+// the API exported in the capsule G3LOGPYTHON_PLUGIN_CAPSULE of _g3logPython
+const plugin::Api *pluginApi();
+
+} // g3
@@ -0,0 +1,217 @@
+//
+//  implementation of class RotatingLogFile
+//
+// See the description in RotatingLogFile.h.
+// The archives are named as g3sinks names its own: "<file>.<%Y-%m-%d-%H-%M-%S>.gz", so that both are expired together.
+//
+
+#include "RotatingLogFile.h"
+
+#include <algorithm>
+#include <climits>
+#include <condition_variable>
+#include <cstdio>
+#include <ctime>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace g3 {
+
+namespace {
+
+struct ArchiveJob
+{
+    std::string archive; // the renamed file
+    std::string current; // the file now written: its older archives are expired
+    bool compress;
+    int maxArchives; // < 0: all kept
+};
+
+// gzips "path" into "path.gz" (through a temporary file), then removes it. false: "path" is left as is
+bool gzipFile(const std::string &path)
+{
+std::string tmp = path + ".gz.tmp";
+FILE *in = fopen(path.c_str(), "rb");
+if(in == nullptr) return false;
+gzFile out = gzopen(tmp.c_str(), "wb6");
+if(out == nullptr) {
+    fclose(in);
+    return false;
+    }
+std::vector<char> buf(64 * 1024);
+bool ok = true;
+size_t got;
+while(ok && (got = fread(buf.data(), 1, buf.size(), in)) > 0) ok = (gzwrite(out, buf.data(), (unsigned)got) == (int)got);
+if(ferror(in)) ok = false;
+fclose(in);
+if(gzclose(out) != Z_OK) ok = false;
+if(ok && rename(tmp.c_str(), (path + ".gz").c_str()) == 0) {
+    unlink(path.c_str());
+    return true;
+    }
+unlink(tmp.c_str());
+return false;
+}
+
+// removes the oldest archives of "current" beyond max_archives (compressed or not)
+void expireArchives(const std::string &current, int max_archives)
+{
+if(max_archives < 0) return;
+size_t slash = current.rfind('/');
+std::string directory = (slash == std::string::npos) ? "." : current.substr(0, slash);
+std::string prefix = ((slash == std::string::npos) ? current : current.substr(slash + 1)) + ".";
+
+DIR *dir = opendir(directory.c_str());
+if(dir == nullptr) return;
+std::vector<std::string> archives;
+while(struct dirent *entry = readdir(dir)) {
+    std::string name = entry -> d_name;
+    if(name.size() <= prefix.size() || name.compare(0, prefix.size(), prefix) != 0) continue;
+    if(name.size() > 4 && name.compare(name.size() - 4, 4, ".tmp") == 0) continue; // being compressed
+    archives.push_back(name);
+    }
+closedir(dir);
+
+// by date: the names without their ".gz"
+auto key = [](const std::string &name) {
+    return (name.size() > 3 && name.compare(name.size() - 3, 3, ".gz") == 0) ? name.substr(0, name.size() - 3) : name;
+    };
+std::sort(archives.begin(), archives.end(), [&key](const std::string &a, const std::string &b) {return key(a) < key(b);});
+for(size_t i = 0; i + (size_t)max_archives < archives.size(); i++) unlink((directory + "/" + archives[i]).c_str());
+}
+
+// the background thread of all the sinks (a rotation is rare: one thread is enough)
+class Archiver
+{
+public:
+    void push(ArchiveJob job) {
+        std::lock_guard<std::mutex> lock(_lck);
+        if(!_started) {
+            std::thread(&Archiver::ArchiverWorker, this).detach(); // as the archiver, never destroyed
+            _started = true;
+            }
+        _jobs.push_back(std::move(job));
+        _cv.notify_one();
+        };
+
+private:
+    void ArchiverWorker() {
+        setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 10); // behind the application's threads
+        for(;;) {
+            ArchiveJob job;
+              {
+                std::unique_lock<std::mutex> lock(_lck);
+                _cv.wait(lock, [this]{return !_jobs.empty();});
+                job = std::move(_jobs.front());
+                _jobs.pop_front();
+              }
+            if(job.compress) gzipFile(job.archive);
+            expireArchives(job.current, job.maxArchives);
+          }
+        };
+
+    std::mutex _lck;
+    std::condition_variable _cv;
+    std::deque<ArchiveJob> _jobs;
+    bool _started = false;
+};
+
+Archiver &archiver()
+{
+static Archiver *instance = new Archiver();
+return *instance;
+}
+
+} // anonymous namespace
+
+RotatingLogFile::RotatingLogFile(const std::string &log_prefix, const std::string &log_directory):
+    LogRotate(log_prefix, log_directory), _prefix(log_prefix), _maxBytes(LogRotate::getMaxLogSize())
+{
+LogRotate::setMaxLogSize(INT_MAX); // LogRotate never rotates by itself: see rotate()
+resetSize();
+}
+
+void RotatingLogFile::save(std::string line)
+{
+size_t size = line.size();
+if(_fileBytes > 0 && _fileBytes + size > (uint64_t)_maxBytes) rotate();
+LogRotate::save(std::move(line));
+_fileBytes += size;
+}
+
+std::string RotatingLogFile::changeLogFile(const std::string &log_directory, const std::string &new_name)
+{
+std::string file = LogRotate::changeLogFile(log_directory, new_name);
+if(!file.empty()) {
+    if(!new_name.empty()) _prefix = new_name;
+    resetSize();
+    }
+return file;
+}
+
+void RotatingLogFile::setMaxLogSize(int max_file_size_in_bytes)
+{
+_maxBytes = max_file_size_in_bytes;
+}
+
+int RotatingLogFile::getMaxLogSize()
+{
+return _maxBytes;
+}
+
+void RotatingLogFile::setCompression(bool compress)
+{
+_compress = compress;
+}
+
+bool RotatingLogFile::getCompression()
+{
+return _compress;
+}
+
+std::string RotatingLogFile::rotate()
+{
+std::string current = logFileName();
+LogRotate::flush();
+
+char stamp[32];
+time_t now = time(nullptr);
+struct tm local;
+localtime_r(&now, &local);
+strftime(stamp, sizeof(stamp), "%Y-%m-%d-%H-%M-%S", &local);
+if(_lastStamp == stamp) _sameSecond++;
+else {
+    _lastStamp = stamp;
+    _sameSecond = 0;
+    }
+std::string archive = current + "." + stamp + (_sameSecond > 0 ? "-" + std::to_string(_sameSecond) : std::string());
+
+// the open stream follows the renamed file until LogRotate reopens one under the old name
+if(rename(current.c_str(), archive.c_str()) != 0) return std::string(); // goes on with the same file
+size_t slash = current.rfind('/');
+std::string directory = (slash == std::string::npos) ? "./" : current.substr(0, slash + 1);
+if(LogRotate::changeLogFile(directory, _prefix).empty()) {
+    rename(archive.c_str(), current.c_str()); // still written to: back under its name
+    return std::string();
+    }
+resetSize();
+archiver().push(ArchiveJob{archive, logFileName(), _compress, getMaxArchiveLogCount()});
+return archive;
+}
+
+void RotatingLogFile::resetSize()
+{
+struct stat st;
+_fileBytes = (stat(logFileName().c_str(), &st) == 0) ? (uint64_t)st.st_size : 0;
+}
+
+} // g3
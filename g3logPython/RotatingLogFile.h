@@ -0,0 +1,51 @@
+/*
+
+  LogRotate sink with the rotation moved off the write path.
+
+  g3sinks' LogRotate rotates inside save(): once the file reaches its size limit, the file is gzipped
+  on the sink's thread, and the messages wait behind the compression (hundreds of ms for large files).
+  Here LogRotate's own rotation is disabled, and save() only appends. When the next line would exceed the size limit:
+    - the file is renamed "<file>.<date-time>" and LogRotate reopens a new file under its name (metadata only),
+    - the archive is handed to a background thread, which gzips it ("<file>.<date-time>.gz", at a lower priority)
+      then removes the oldest archives beyond the maximum archive count (setMaxArchiveLogCount).
+  With the compression switched off (setCompression(false)), the archives are kept as they are (still expired).
+  An archive not compressed yet when the process exits is left uncompressed: nothing is lost.
+
+*/
+
+#pragma once
+
+#include <g3sinks/LogRotate.h>
+
+#include <cstdint>
+#include <string>
+
+namespace g3 {
+
+class RotatingLogFile: public LogRotate {
+public:
+  RotatingLogFile(const std::string &log_prefix, const std::string &log_directory);
+  RotatingLogFile(const RotatingLogFile&) = delete;
+  RotatingLogFile &operator=(const RotatingLogFile&) = delete;
+
+  void save(std::string line); // the mover: rotates first if the line reaches the size limit
+
+  std::string changeLogFile(const std::string &log_directory, const std::string &new_name = "");
+  void setMaxLogSize(int max_file_size_in_bytes);
+  int getMaxLogSize();
+  void setCompression(bool compress); // gzip the archives, in the background (default)
+  bool getCompression();
+  std::string rotate(); // now: returns the archive's name (empty if the file could not be renamed)
+
+private:
+  void resetSize(); // from the file's size (LogRotate writes a header in the new files)
+
+  std::string _prefix;
+  uint64_t _fileBytes = 0;
+  int _maxBytes;
+  bool _compress = true;
+  int _sameSecond = 0; // archives named in the same second get a suffix
+  std::string _lastStamp;
+};
+
+} // g3
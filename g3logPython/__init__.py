@@ -1,21 +1,75 @@
 
-import sys
-import inspect
-from functools import partial
+# g3log(), debug(), info(), warning() and fatal() are implemented in the extension module:
+# the call-site is read by the extension directly from the caller's frame.
 from _g3logPython import *
 
-def g3log(level, message):
-    try:
-        callstack = inspect.stack()[1]
-        receivelog( callstack.filename, callstack.lineno, callstack.function, level, message)
-    except Exception as e:
-        print("ERROR in g3log python: " + str(e), file=sys.stderr )
-
+import asyncio as _asyncio
+import logging as _logging
 
-debug   = partial(g3log, g3DEBUG)
-info    = partial(g3log, g3INFO)
-warning = partial(g3log, g3WARNING)
-fatal   = partial(g3log, g3FATAL)
 #TODO : the fatal callstack should also display the python callstack 
 # (g3log will now display the interpreter's callstack, not that useful for python)
 
+
+# The sink methods return a SinkCallResult (SinkCallResult_str, SinkCallResult_int ...):
+# "await" it from a coroutine, or get an asyncio future with as_future().
+# The event loop watches the result's eventfd, signaled by the sink's own thread once the call has run.
+
+def _set_from_result(fut, res):
+    try:
+        fut.set_result(res.result())
+    except Exception as exc:
+        fut.set_exception(exc)
+
+def _as_future(self, loop=None):
+    """asyncio future, resolved when the sink has executed the call.
+    loop: the running loop by default. Outside of a running loop, pass the loop that will run the future
+    (RuntimeError otherwise)."""
+    if loop is None:
+        try:
+            loop = _asyncio.get_running_loop()
+        except RuntimeError:
+            raise RuntimeError("as_future: no running event loop, pass loop=") from None
+    fut = loop.create_future()
+    if self.done():
+        _set_from_result(fut, self)
+        return fut
+    fd = self.fileno()
+    def on_completion():
+        loop.remove_reader(fd)
+        if not fut.cancelled():
+            _set_from_result(fut, self)
+    loop.add_reader(fd, on_completion)
+    return fut
+
+def _await(self):
+    return _as_future(self).__await__()
+
+for _cls in (SinkCallResult, SinkCallResult_str, SinkCallResult_int, SinkCallResult_bool, SinkCallResult_counts):
+    _cls.as_future = _as_future
+    _cls.__await__ = _await
+del _cls
+
+
+def get_include():
+    """include directory of the sink plugins: #include <g3logPython/plugin.h> (see plugin.h)"""
+    import os
+    return os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+
+class Handler(_logging.Handler):
+    """logging.Handler sending the records of the logging module to g3log.
+
+    handle() and emit() are implemented in the extension: the LogRecord's attributes are read directly
+    (call-site, level, time, msg and args, formatted later as the deferred messages), and no python code
+    runs per record. The logger name is added as a structured field "logger" (unless logger_field is False).
+    Levels: below INFO: DEBUG, below WARNING: INFO, WARNING and above: WARNING (ERROR and CRITICAL
+    get a "levelname" field). With a formatter (setFormatter), the message is the formatted record.
+
+        logging.getLogger().addHandler(g3logPython.Handler())
+    """
+
+    def __init__(self, level=_logging.NOTSET, logger_field=True):
+        super().__init__(level)
+        self.logger_field = logger_field
+
+_bind_logging_handler(Handler)
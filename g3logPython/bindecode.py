@@ -0,0 +1,174 @@
+#!/usr/bin/env python3
+#
+# Decoder for the segments written by the binary record sink (BinSinks, see BinarySink.h for the layout).
+# Only uses the standard library: it can run on a machine without g3log.
+#
+#   python3 bindecode.py [--level INFO] [--since T] [--until T] [--follow] segment_files...
+#   T: seconds since the epoch, or "YYYY-mm-dd HH:MM:SS" (local time)
+#
+# With --follow, the last segment is tailed, and the decoder moves on to the next segments as they are created.
+#
+
+import argparse
+import collections
+import datetime
+import glob
+import os
+import re
+import struct
+import sys
+import time
+
+MAGIC = b"G3LPBIN\0"
+SEG_HEADER = struct.Struct("<8sIIQqQ")
+REC_HEADER = struct.Struct("<IHH")
+SITE_HEADER = struct.Struct("<IHHIiII")
+MSG_HEADER = struct.Struct("<IHHiIqQII")
+REC_MESSAGE = 1
+REC_SITE = 2
+
+LEVELS = {100: "DEBUG", 300: "INFO", 500: "WARNING", 1000: "FATAL", 2000: "CONTRACT", 2001: "FATAL_SIGNAL"}
+LEVEL_VALUES = {name: value for value, name in LEVELS.items()}
+
+Record = collections.namedtuple("Record", "timestamp_ns level file line function thread message")
+
+
+def level_name(value):
+    return LEVELS.get(value, str(value))
+
+
+def format_record(rec):
+    """same text as g3log's LogMessage::toString()"""
+    secs, ns = divmod(rec.timestamp_ns, 1000000000)
+    stamp = datetime.datetime.fromtimestamp(secs).strftime("%Y/%m/%d %H:%M:%S")
+    return "%s %06d\t%s [%s->%s:%d]\t%s" % (stamp, ns // 1000, level_name(rec.level), os.path.basename(rec.file),
+                                           rec.function, rec.line, rec.message)
+
+
+class SegmentReader:
+    """reads the records of one segment, possibly while it is being written"""
+
+    def __init__(self, path):
+        self.path = path
+        self.f = open(path, "rb")
+        header = self.f.read(SEG_HEADER.size)
+        if len(header) < SEG_HEADER.size:
+            raise ValueError("%s: truncated segment header" % path)
+        magic, version, header_size, self.seq, self.created_ns, self.capacity = SEG_HEADER.unpack(header)
+        if magic != MAGIC:
+            raise ValueError("%s: not a g3logPython binary segment" % path)
+        if version != 1:
+            raise ValueError("%s: unsupported version %d" % (path, version))
+        self.pos = header_size
+        self.sites = {}
+
+    def close(self):
+        self.f.close()
+
+    def records(self):
+        """yields the records available now"""
+        while True:
+            self.f.seek(self.pos)
+            head = self.f.read(REC_HEADER.size)
+            if len(head) < REC_HEADER.size:
+                return
+            size, rtype, _ = REC_HEADER.unpack(head)
+            if size == 0:
+                return # not written yet
+            self.f.seek(self.pos)
+            data = self.f.read(size)
+            if len(data) < size:
+                return
+            self.pos += size
+            if rtype == REC_SITE:
+                _, _, _, site_id, line, file_len, func_len = SITE_HEADER.unpack_from(data)
+                start = SITE_HEADER.size
+                file = data[start:start + file_len].decode("utf-8", "replace")
+                function = data[start + file_len:start + file_len + func_len].decode("utf-8", "replace")
+                self.sites[site_id] = (file, line, function)
+            elif rtype == REC_MESSAGE:
+                _, _, _, level, site_id, stamp, thread, length, _ = MSG_HEADER.unpack_from(data)
+                message = data[MSG_HEADER.size:MSG_HEADER.size + length].decode("utf-8", "replace")
+                file, line, function = self.sites.get(site_id, ("?", 0, "?"))
+                yield Record(stamp, level, file, line, function, thread, message)
+            # unknown record types are skipped
+
+
+def next_segment(path):
+    """file name of the segment following "path" (same prefix and start time)"""
+    m = re.match(r"^(.*\.)(\d+)\.g3bin$", path)
+    if m is None:
+        return None
+    return "%s%0*d.g3bin" % (m.group(1), len(m.group(2)), int(m.group(2)) + 1)
+
+
+def read_segments(paths, follow=False, poll=0.2):
+    """yields the records of the segments, in order. With follow: tails the last one."""
+    paths = list(paths)
+    while paths:
+        path = paths.pop(0)
+        reader = SegmentReader(path)
+        try:
+            for rec in reader.records():
+                yield rec
+            if not follow or paths:
+                continue
+            # tail: the writer starts the next segment when this one is full
+            while True:
+                nxt = next_segment(path)
+                if nxt is not None and os.path.exists(nxt):
+                    for rec in reader.records(): # the last records of the closed segment
+                        yield rec
+                    paths.append(nxt)
+                    break
+                got = False
+                for rec in reader.records():
+                    got = True
+                    yield rec
+                if not got:
+                    time.sleep(poll)
+        finally:
+            reader.close()
+
+
+def parse_time(text):
+    try:
+        return int(float(text) * 1e9)
+    except ValueError:
+        return int(datetime.datetime.strptime(text, "%Y-%m-%d %H:%M:%S").timestamp() * 1e9)
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description="decode g3logPython binary log segments")
+    parser.add_argument("segments", nargs="+", help="segment files (or glob patterns)")
+    parser.add_argument("--level", default=None, help="minimum level: DEBUG, INFO, WARNING, FATAL")
+    parser.add_argument("--since", default=None, help="first time shown (epoch seconds, or 'YYYY-mm-dd HH:MM:SS')")
+    parser.add_argument("--until", default=None, help="last time shown")
+    parser.add_argument("--follow", "-f", action="store_true", help="tail the last segment")
+    args = parser.parse_args(argv)
+
+    paths = []
+    for pattern in args.segments:
+        found = sorted(glob.glob(pattern))
+        paths.extend(found if found else [pattern])
+
+    min_level = LEVEL_VALUES[args.level.upper()] if args.level else None
+    since = parse_time(args.since) if args.since else None
+    until = parse_time(args.until) if args.until else None
+
+    try:
+        for rec in read_segments(paths, follow=args.follow):
+            if min_level is not None and rec.level < min_level:
+                continue
+            if since is not None and rec.timestamp_ns < since:
+                continue
+            if until is not None and rec.timestamp_ns > until:
+                continue
+            sys.stdout.write(format_record(rec) + "\n")
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
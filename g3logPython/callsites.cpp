@@ -0,0 +1,63 @@
+//
+//  implementation of class CallSiteRegistry
+//
+// The call-sites are stored in fixed-size chunks, allocated on demand and never freed:
+// a registered call-site never moves, so its strings can be read without any lock.
+// Only the registration takes a mutex (to allocate the chunks and de-duplicate the sites).
+//
+
+#include "intern_log.h"
+
+#include <stdexcept>
+
+namespace g3 {
+
+CallSiteRegistry &callSites()
+{
+static CallSiteRegistry *registry = new CallSiteRegistry(); // never destroyed: may be used until the very end of the process
+return *registry;
+}
+
+CallSiteRegistry::CallSiteRegistry(): _count(0)
+{
+for(auto &chunk: _chunks) chunk.store(nullptr, std::memory_order_relaxed);
+}
+
+int CallSiteRegistry::add(const char *file, int line, const char *function)
+{
+std::lock_guard<std::mutex> lock(_regLck);
+
+auto key = std::make_tuple(std::string(file), line, std::string(function));
+auto search = _ids.find(key);
+if(search != _ids.end()) return search -> second;
+
+int id = _count.load(std::memory_order_relaxed);
+if(id >= MaxChunks * ChunkSize) throw std::logic_error("registerCallSite: too many call-sites");
+
+CallSite *chunk = _chunks[id / ChunkSize].load(std::memory_order_relaxed);
+if(chunk == nullptr) {
+    chunk = new CallSite[ChunkSize];
+    _chunks[id / ChunkSize].store(chunk, std::memory_order_release);
+    }
+CallSite &site = chunk[id % ChunkSize];
+site.file = file;
+site.line = line;
+site.function = function;
+
+_ids.insert({key, id});
+_count.store(id + 1, std::memory_order_release); // publishes the call-site
+return id;
+}
+
+const CallSite &CallSiteRegistry::get(int id) const
+{
+if(id < 0 || id >= _count.load(std::memory_order_acquire)) throw std::logic_error("receivelog_id: unknown call-site id");
+return _chunks[id / ChunkSize].load(std::memory_order_acquire)[id % ChunkSize];
+}
+
+int registerCallSite(const char *file, int line, const char *function)
+{
+return callSites().add(file, line, function);
+}
+
+} // g3
@@ -0,0 +1,173 @@
+//
+//  logging context: see context.h
+//
+// The python context is a capsule holding a shared_ptr to the block, set in a ContextVar.
+// The ContextVar is only created (and read by the capture path) once a context has been entered.
+//
+
+#include "context.h"
+#include "pylog.h"
+
+#include <atomic>
+
+namespace g3 {
+
+namespace {
+
+#define G3LOGPYTHON_CONTEXT_CAPSULE "g3logPython.context"
+
+thread_local std::shared_ptr<const ContextBlock> threadContext; // ContextScope
+
+std::atomic<PyObject *> contextVar{nullptr}; // never released
+
+// GIL held
+PyObject *getContextVar()
+{
+PyObject *var = contextVar.load(std::memory_order_acquire);
+if(var != nullptr) return var;
+var = PyContextVar_New(G3LOGPYTHON_CONTEXT_CAPSULE, NULL);
+if(var == NULL) throw pybind11::error_already_set();
+contextVar.store(var, std::memory_order_release); // the GIL serializes the creation
+return var;
+}
+
+void deleteBlock(PyObject *capsule)
+{
+delete static_cast<std::shared_ptr<const ContextBlock> *>(PyCapsule_GetPointer(capsule, G3LOGPYTHON_CONTEXT_CAPSULE));
+}
+
+// GIL held. nullptr: no context entered in the calling task / thread
+std::shared_ptr<const ContextBlock> pythonContext(PyObject *var)
+{
+PyObject *value = NULL;
+if(PyContextVar_Get(var, NULL, &value) < 0) {
+    PyErr_Clear();
+    return nullptr;
+    }
+if(value == NULL) return nullptr;
+std::shared_ptr<const ContextBlock> block;
+auto *stored = static_cast<std::shared_ptr<const ContextBlock> *>(PyCapsule_GetPointer(value, G3LOGPYTHON_CONTEXT_CAPSULE));
+if(stored) block = *stored;
+else PyErr_Clear();
+Py_DECREF(value);
+return block;
+}
+
+pybind11::object pyValue(const LogValue &value)
+{
+switch(value.kind) {
+    case LogValue::INT: return pybind11::int_(value.i);
+    case LogValue::FLOAT: return pybind11::float_(value.d);
+    case LogValue::BOOL: return pybind11::bool_(value.i != 0);
+    default: return pybind11::str(value.s);
+    }
+}
+
+} // anonymous namespace
+
+std::shared_ptr<const ContextBlock> makeContext(const ContextBlock *parent, const std::vector<LogField> &fields)
+{
+auto block = std::make_shared<ContextBlock>();
+if(parent) block -> fields = parent -> fields;
+for(auto &field: fields) {
+    bool replaced = false;
+    for(auto &existing: block -> fields) {
+        if(existing.key != field.key) continue;
+        existing.value = field.value;
+        replaced = true;
+        break;
+        }
+    if(!replaced) block -> fields.push_back(field);
+    }
+block -> encoded = encodeFields(block -> fields).substr(1);
+return block;
+}
+
+std::shared_ptr<const ContextBlock> currentContext()
+{
+if(threadContext) return threadContext;
+PyObject *var = contextVar.load(std::memory_order_acquire);
+if(var == nullptr || !PyGILState_Check()) return nullptr; // no python context yet, or a thread of C++ (or without the GIL)
+return pythonContext(var);
+}
+
+std::string encodeFields(const std::vector<LogField> &fields, const ContextBlock *context)
+{
+if(context == nullptr || context -> fields.empty()) return encodeFields(fields);
+if(fields.empty()) return std::string(1, G3LOGPYTHON_FIELDS_TAG) + context -> encoded;
+
+bool overridden = false;
+for(auto &field: fields) {
+    for(auto &inherited: context -> fields) if(inherited.key == field.key) overridden = true;
+    }
+if(overridden) { // rare: merged field by field
+    std::vector<LogField> merged;
+    for(auto &inherited: context -> fields) {
+        bool keep = true;
+        for(auto &field: fields) if(inherited.key == field.key) keep = false;
+        if(keep) merged.push_back(inherited);
+        }
+    merged.insert(merged.end(), fields.begin(), fields.end());
+    return encodeFields(merged);
+    }
+
+std::string own = encodeFields(fields);
+std::string out;
+out.reserve(1 + context -> encoded.size() + own.size() - 1);
+out += G3LOGPYTHON_FIELDS_TAG;
+out += context -> encoded;
+out.append(own, 1, std::string::npos);
+return out;
+}
+
+ContextScope::ContextScope(const std::vector<LogField> &fields): _previous(threadContext)
+{
+threadContext = makeContext(currentContext().get(), fields);
+}
+
+ContextScope::~ContextScope()
+{
+threadContext = std::move(_previous);
+}
+
+LogContext::~LogContext()
+{
+for(PyObject *token: _tokens) Py_DECREF(token);
+}
+
+LogContext &LogContext::enter()
+{
+PyObject *var = getContextVar();
+std::shared_ptr<const ContextBlock> parent = pythonContext(var);
+auto *stored = new std::shared_ptr<const ContextBlock>(makeContext(parent.get(), _fields));
+PyObject *capsule = PyCapsule_New(stored, G3LOGPYTHON_CONTEXT_CAPSULE, &deleteBlock);
+if(capsule == NULL) {
+    delete stored;
+    throw pybind11::error_already_set();
+    }
+PyObject *token = PyContextVar_Set(var, capsule);
+Py_DECREF(capsule);
+if(token == NULL) throw pybind11::error_already_set();
+_tokens.push_back(token);
+return *this;
+}
+
+void LogContext::exit(pybind11::args)
+{
+if(_tokens.empty()) throw std::logic_error("LogContext: exit without enter");
+PyObject *token = _tokens.back();
+_tokens.pop_back();
+int rv = PyContextVar_Reset(contextVar.load(std::memory_order_relaxed), token);
+Py_DECREF(token);
+if(rv < 0) throw pybind11::error_already_set(); // entered in another context (a different task)
+}
+
+pybind11::dict currentContextDict()
+{
+pybind11::dict out;
+std::shared_ptr<const ContextBlock> block = currentContext();
+if(block) for(auto &field: block -> fields) out[pybind11::str(field.key)] = pyValue(field.value);
+return out;
+}
+
+} // g3
@@ -0,0 +1,63 @@
+/*
+
+  Logging context (MDC): fields attached to every message logged within a scope,
+  such as the request id and the tenant of a web request.
+
+    with log.context(request_id=rid, tenant=t):
+        log.info("request done", latency_ms=12.5)   # request done request_id=... tenant=... latency_ms=12.5
+
+  A context is an immutable block: its fields (those of the enclosing context, then its own) and their encoding,
+  made once when the context is entered. Each message captured within it only takes a reference to the block
+  (one shared_ptr copy): nothing is converted nor encoded per message. When the LogMessage is built,
+  the block's encoding is copied in front of the message's own fields (see fields.h): the sinks render and
+  send them as any structured field (TEXT, LOGFMT, JSON, journald fields). A field of the message
+  replaces the context field of the same key.
+
+  Where the current context is kept:
+    - python: in a contextvars.ContextVar, so that each thread and each asyncio task sees its own.
+      Read by the capture path with the C API (no python code runs), only once a context has been entered.
+    - C++ callers: ContextScope, in a thread_local. It includes the context in effect where it is created
+      (the python one included), and takes precedence on its thread while it lives.
+  FATAL messages don't carry the context.
+
+*/
+
+#pragma once
+
+#include "fields.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace g3 {
+
+struct ContextBlock
+{
+    std::vector<LogField> fields; // a key appears once
+    std::string encoded; // the fields, encoded as in fields.h (without the tag byte)
+};
+
+// the block of "parent" (may be nullptr) extended with "fields" (replacing the fields of the same keys)
+std::shared_ptr<const ContextBlock> makeContext(const ContextBlock *parent, const std::vector<LogField> &fields);
+
+// the context of the calling thread: its ContextScope, or (with the GIL held) the python context. nullptr: none
+std::shared_ptr<const ContextBlock> currentContext();
+
+// encodeFields() of the message's fields, after those of its context (may be nullptr)
+std::string encodeFields(const std::vector<LogField> &fields, const ContextBlock *context);
+
+// context of the C++ callers, for the lifetime of the object (on the creating thread)
+class ContextScope
+{
+public:
+    explicit ContextScope(const std::vector<LogField> &fields);
+    ~ContextScope(); // back to the previous context of the thread
+    ContextScope(const ContextScope&) = delete;
+    ContextScope &operator=(const ContextScope&) = delete;
+
+private:
+    std::shared_ptr<const ContextBlock> _previous;
+};
+
+} // g3
@@ -0,0 +1,74 @@
+//
+//  flush barriers: see dispatch.h
+//
+// The barriers in progress are registered by id, and their id is carried by the control message:
+// after a timeout the barrier is released, and the sinks arriving late find nothing to signal.
+//
+
+#include "dispatch.h"
+
+#include <g3log/g3log.hpp>
+
+#include <map>
+
+namespace g3 {
+
+namespace {
+
+std::mutex barriersLck;
+std::map<uint64_t, std::weak_ptr<FlushBarrier>> barriers;
+uint64_t nextBarrierId = 1;
+
+const char BarrierTag[] = G3LOGPYTHON_CTRL_PREFIX "barrier:";
+
+} // anonymous namespace
+
+void FlushBarrier::arrive()
+{
+std::lock_guard<std::mutex> lock(_lck);
+if(++_arrived >= _expected) _cv.notify_all();
+}
+
+bool FlushBarrier::wait_until(std::chrono::steady_clock::time_point deadline)
+{
+std::unique_lock<std::mutex> lock(_lck);
+return _cv.wait_until(lock, deadline, [this]{return _arrived >= _expected;});
+}
+
+void arriveBarrier(const LogMessage &msg)
+{
+if(msg._expression.compare(0, sizeof(BarrierTag) - 1, BarrierTag) != 0) return; // unknown control message
+uint64_t id = std::stoull(msg._expression.substr(sizeof(BarrierTag) - 1));
+
+std::shared_ptr<FlushBarrier> barrier;
+  {
+    std::lock_guard<std::mutex> lock(barriersLck);
+    auto search = barriers.find(id);
+    if(search == barriers.end()) return; // released after a timeout
+    barrier = search -> second.lock();
+  }
+if(barrier) barrier -> arrive();
+}
+
+std::shared_ptr<FlushBarrier> pushFlushBarrier(int expected, uint64_t &barrier_id)
+{
+auto barrier = std::make_shared<FlushBarrier>(expected);
+  {
+    std::lock_guard<std::mutex> lock(barriersLck);
+    barrier_id = nextBarrierId++;
+    barriers[barrier_id] = barrier;
+  }
+
+std::unique_ptr<LogMessage> msg(new LogMessage("", 0, "", INFO));
+msg -> _expression = BarrierTag + std::to_string(barrier_id);
+g3::internal::pushMessageToLogger(LogMessagePtr(std::move(msg)));
+return barrier;
+}
+
+void releaseFlushBarrier(uint64_t barrier_id)
+{
+std::lock_guard<std::mutex> lock(barriersLck);
+barriers.erase(barrier_id);
+}
+
+} // g3
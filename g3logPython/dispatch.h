@@ -0,0 +1,194 @@
+/*
+
+  Dispatch of the log messages to each sink.
+
+  g3log calls the mover of each sink on the sink's own thread. Instead of the sink's mover,
+  the LogWorker is given a SinkDispatch: it handles the control messages of this wrapper
+  (flush barriers), skips the messages rejected by the sink's filters (minimum level, file prefixes),
+  renders the structured fields of the messages in the sink's field format (see fields.h),
+  and delivers the messages to the sink's mover.
+  The filters are checked before any rendering: a rejected message costs the sink a few atomic loads.
+  The sinks writing the default layout share the line rendered by the first of them (see render.h).
+
+  Flush barrier (ifaceLogWorker::flush() ):
+    a control message is sent through the LogWorker, behind all the pending messages.
+    Each sink flushes when the barrier reaches it, and then arrives at the barrier.
+    The caller is woken up when all the sinks have arrived (one round-trip through the worker).
+
+*/
+
+#pragma once
+
+#include <g3log/logmessage.hpp>
+#include "RotatingLogFile.h"
+#include "ColorTermSink.h"
+#include "BinarySink.h"
+#include "JournaldSink.h"
+#include "NetSink.h"
+#include "PluginSink.h"
+#include "FlightRecorderSink.h"
+#include "fields.h"
+#include "metrics.h"
+#include "render.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace g3 {
+
+// flushes a sink, on the sink's thread. Nothing to do by default (ex: syslog writes immediately).
+template<class g3logSinkCls> inline void flushSink(g3logSinkCls &) {}
+template<> inline void flushSink<RotatingLogFile>(RotatingLogFile &sink) {sink.flush();}
+template<> inline void flushSink<ColorTermSink>(ColorTermSink &sink) {sink.flush();}
+template<> inline void flushSink<BinarySink>(BinarySink &sink) {sink.flush();}
+template<> inline void flushSink<NetSink>(NetSink &sink) {sink.flush();} // to the I/O thread: does not wait for the network
+template<> inline void flushSink<PluginSink>(PluginSink &sink) {sink.flush();}
+
+// the sinks sending the structured fields by themselves get them undecoded, in the LogMessage's _expression
+template<class g3logSinkCls> inline bool sinkTakesFields() {return false;}
+template<> inline bool sinkTakesFields<JournaldSink>() {return true;}
+
+class FlushBarrier
+{
+public:
+    explicit FlushBarrier(int expected): _expected(expected), _arrived(0) {};
+    FlushBarrier(const FlushBarrier&) = delete;
+    
+    void arrive(); // called by each sink
+    bool wait_until(std::chrono::steady_clock::time_point deadline); // true when all the sinks have arrived
+    
+private:
+    std::mutex _lck;
+    std::condition_variable _cv;
+    int _expected;
+    int _arrived; // a sink added after the barrier was sent may arrive too: >= _expected is enough
+};
+
+// control messages are recognized by their _expression (never set for the regular messages of this wrapper)
+#define G3LOGPYTHON_CTRL_PREFIX "\x01g3logPython:"
+inline bool isControlMessage(const LogMessage &msg)
+{
+return msg._expression.size() > sizeof(G3LOGPYTHON_CTRL_PREFIX) - 1 && msg._expression[0] == '\x01'
+       && msg._expression.compare(0, sizeof(G3LOGPYTHON_CTRL_PREFIX) - 1, G3LOGPYTHON_CTRL_PREFIX) == 0;
+}
+
+// called by the sinks on a control message
+void arriveBarrier(const LogMessage &msg);
+
+// sends a flush barrier for "expected" sinks to the LogWorker, behind all the messages already pushed.
+// wait on the returned barrier, then call releaseFlushBarrier() (whether all sinks have arrived or not).
+std::shared_ptr<FlushBarrier> pushFlushBarrier(int expected, uint64_t &barrier_id);
+void releaseFlushBarrier(uint64_t barrier_id);
+
+// options of one sink, read by its dispatcher, and its metrics, written by the dispatcher.
+// Shared with the sink's python handle and with ifaceLogWorker::stats().
+struct SinkOptions
+{
+    std::atomic<int> fieldFormat{(int)FieldFormat::TEXT};
+    std::atomic<int> minLevel{0}; // g3log level value: the messages below are not delivered (FATAL always is)
+    // file prefixes (LogMessage::_file_path): when not empty, only the messages of these files are delivered.
+    // Replaced as a whole (std::atomic_store), then filterVersion is incremented: the dispatcher reloads it.
+    std::shared_ptr<const std::vector<std::string>> filePrefixes;
+    std::atomic<uint64_t> filterVersion{0};
+    SinkMetrics metrics;
+};
+
+// delivery of a regular message to the sink's mover (g3log accepts both types of movers)
+template<class g3logSinkCls>
+void deliver(g3logSinkCls *sink, void (g3logSinkCls::*mover)(LogMessageMover), LogMessageMover msg) {(sink ->* mover)(msg);}
+template<class g3logSinkCls>
+void deliver(g3logSinkCls *sink, void (g3logSinkCls::*mover)(std::string), LogMessageMover msg) {(sink ->* mover)(msg.get().toString());}
+
+// delivery of a message with fields: each sink gets its own copy of the LogMessage, rendered here.
+// The sinks formatting the LogMessage get "message + fields" as the message,
+// the sinks receiving text get the whole line as LOGFMT or JSON.
+template<class g3logSinkCls>
+void deliverFields(g3logSinkCls *sink, void (g3logSinkCls::*mover)(LogMessageMover), LogMessageMover msg, FieldFormat format)
+{
+LogMessage &m = msg.get();
+m._message = renderMessage(m._message, decodeFields(m._expression), format);
+m._expression.clear();
+(sink ->* mover)(msg);
+}
+template<class g3logSinkCls>
+void deliverFields(g3logSinkCls *sink, void (g3logSinkCls::*mover)(std::string), LogMessageMover msg, FieldFormat format)
+{
+LogMessage &m = msg.get();
+if(format == FieldFormat::TEXT) {
+    m._message = renderMessage(m._message, decodeFields(m._expression), format);
+    m._expression.clear();
+    (sink ->* mover)(m.toString());
+    return;
+    }
+(sink ->* mover)(renderLine(m, decodeFields(m._expression), format));
+}
+
+// delivery of a line rendered once for all the sinks writing the default layout (see render.h)
+template<class g3logSinkCls>
+void deliverLine(g3logSinkCls *sink, void (g3logSinkCls::*mover)(std::string), LogMessageMover, const std::string &line) {(sink ->* mover)(line);}
+template<class g3logSinkCls> // the sinks formatting the LogMessage don't share (see sinkSharesLine)
+void deliverLine(g3logSinkCls *sink, void (g3logSinkCls::*mover)(LogMessageMover), LogMessageMover msg, const std::string &) {(sink ->* mover)(msg);}
+inline void deliverLine(ColorTermSink *sink, void (ColorTermSink::*)(LogMessageMover), LogMessageMover msg, const std::string &line) {sink -> ReceiveLine(msg.get()._level, line);}
+
+// the "mover" given to LogWorker::addSink()
+template<class g3logSinkCls, typename ClbkType, ClbkType g3logMsgMvr>
+struct SinkDispatch
+{
+    explicit SinkDispatch(std::shared_ptr<SinkOptions> options_): options(std::move(options_)) {};
+    
+    void operator()(g3logSinkCls *sink, LogMessageMover msg) const {
+        if(isControlMessage(msg.get())) {
+            flushSink(*sink);
+            arriveBarrier(msg.get());
+            return;
+            }
+        RenderTag tag = untagRender(msg.get());
+        bool shares = tag.id != 0 && sinkSharesLine<g3logSinkCls>();
+        if(!accepts(msg.get())) {
+            if(shares) renderCache().skip(tag);
+            options -> metrics.skipped();
+            return;
+            }
+        auto start = std::chrono::steady_clock::now();
+        FieldFormat format = (FieldFormat)options -> fieldFormat.load(std::memory_order_relaxed);
+        bool fields = hasFields(msg.get()) && !sinkTakesFields<g3logSinkCls>();
+        if(shares && fields && format != FieldFormat::TEXT) { // a LOGFMT or JSON line: this sink's own
+            renderCache().skip(tag);
+            shares = false;
+            }
+        if(shares) {
+            bool shared;
+            std::shared_ptr<const std::string> line = renderCache().line(tag, msg.get(), shared);
+            if(shared) options -> metrics.sharedLine();
+            deliverLine(sink, g3logMsgMvr, msg, *line);
+            }
+        else if(fields) deliverFields(sink, g3logMsgMvr, msg, format);
+        else deliver(sink, g3logMsgMvr, msg);
+        options -> metrics.delivered(start);
+        };
+    
+    bool accepts(const LogMessage &msg) const {
+        if(msg._level.value >= FATAL.value) return true;
+        if(msg._level.value < options -> minLevel.load(std::memory_order_relaxed)) return false;
+        uint64_t version = options -> filterVersion.load(std::memory_order_acquire);
+        if(version != _filterVersion) { // only read on the sink's thread: no lock per message
+            _filePrefixes = std::atomic_load(&options -> filePrefixes);
+            _filterVersion = version;
+            }
+        if(!_filePrefixes || _filePrefixes -> empty()) return true;
+        for(auto &prefix: *_filePrefixes) if(msg._file_path.compare(0, prefix.size(), prefix) == 0) return true;
+        return false;
+        };
+    
+    std::shared_ptr<SinkOptions> options;
+    mutable uint64_t _filterVersion = 0;
+    mutable std::shared_ptr<const std::vector<std::string>> _filePrefixes;
+};
+
+} // g3
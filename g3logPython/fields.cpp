@@ -0,0 +1,212 @@
+//
+//  structured fields: see fields.h
+//
+// encoding of each field, after the tag byte:  u8 kind, u16 key length, key, value
+//   INT, BOOL: i64    FLOAT: double    STR: u32 length, bytes
+//
+
+#include "fields.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace g3 {
+
+namespace {
+
+template<typename T> void append(std::string &out, T val) {out.append(reinterpret_cast<const char*>(&val), sizeof(T));}
+
+template<typename T> bool extract(const std::string &in, size_t &pos, T &val)
+{
+if(pos + sizeof(T) > in.size()) return false;
+memcpy(&val, in.data() + pos, sizeof(T));
+pos += sizeof(T);
+return true;
+}
+
+void jsonString(std::string &out, const std::string &str)
+{
+out += '"';
+for(unsigned char c: str) {
+    switch(c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if(c < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out += buf;
+            } else {
+                out += (char)c;
+            }
+        }
+    }
+out += '"';
+}
+
+void jsonValue(std::string &out, const LogValue &val)
+{
+switch(val.kind) {
+    case LogValue::BOOL: out += val.i ? "true" : "false"; break;
+    case LogValue::INT: out += std::to_string(val.i); break;
+    case LogValue::FLOAT: 
+        if(std::isfinite(val.d)) out += val.to_str();
+        else out += "null";
+        break;
+    default: jsonString(out, val.s); break;
+    }
+}
+
+void logfmtString(std::string &out, const std::string &str)
+{
+bool quote = str.empty();
+for(unsigned char c: str) if(c <= ' ' || c == '=' || c == '"') { quote = true; break; }
+if(!quote) {
+    out += str;
+    return;
+    }
+out += '"';
+for(char c: str) {
+    switch(c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        default: out += c;
+        }
+    }
+out += '"';
+}
+
+void logfmtFields(std::string &out, const std::vector<LogField> &fields)
+{
+for(auto &field: fields) {
+    if(!out.empty()) out += ' ';
+    out += field.key;
+    out += '=';
+    if(field.value.kind == LogValue::STR) logfmtString(out, field.value.s);
+    else out += field.value.to_str();
+    }
+}
+
+void jsonFields(std::string &out, const std::vector<LogField> &fields)
+{
+for(auto &field: fields) {
+    out += ',';
+    jsonString(out, field.key);
+    out += ':';
+    jsonValue(out, field.value);
+    }
+}
+
+} // anonymous namespace
+
+std::string encodeFields(const std::vector<LogField> &fields)
+{
+std::string out(1, G3LOGPYTHON_FIELDS_TAG);
+for(auto &field: fields) {
+    append<uint8_t>(out, field.value.kind);
+    append<uint16_t>(out, field.key.size() > UINT16_MAX ? UINT16_MAX : field.key.size());
+    out.append(field.key, 0, UINT16_MAX);
+    switch(field.value.kind) {
+        case LogValue::INT: case LogValue::BOOL: append<int64_t>(out, field.value.i); break;
+        case LogValue::FLOAT: append<double>(out, field.value.d); break;
+        default:
+            append<uint32_t>(out, field.value.s.size());
+            out += field.value.s;
+        }
+    }
+return out;
+}
+
+std::vector<LogField> decodeFields(const std::string &encoded)
+{
+std::vector<LogField> fields;
+size_t pos = 1;
+while(pos < encoded.size()) {
+    uint8_t kind;
+    uint16_t keyLen;
+    if(!extract(encoded, pos, kind) || !extract(encoded, pos, keyLen) || pos + keyLen > encoded.size()) break;
+    LogField field;
+    field.key = encoded.substr(pos, keyLen);
+    pos += keyLen;
+    if(kind == LogValue::INT || kind == LogValue::BOOL) {
+        int64_t val;
+        if(!extract(encoded, pos, val)) break;
+        field.value = (kind == LogValue::INT) ? LogValue::from_int(val) : LogValue::from_bool(val != 0);
+    } else if(kind == LogValue::FLOAT) {
+        double val;
+        if(!extract(encoded, pos, val)) break;
+        field.value = LogValue::from_double(val);
+    } else {
+        uint32_t len;
+        if(!extract(encoded, pos, len) || pos + len > encoded.size()) break;
+        field.value = LogValue::from_str(encoded.substr(pos, len));
+        pos += len;
+    }
+    fields.push_back(std::move(field));
+  }
+return fields;
+}
+
+std::string renderMessage(const std::string &message, const std::vector<LogField> &fields, FieldFormat format)
+{
+std::string out;
+switch(format) {
+    case FieldFormat::JSON:
+        out = "{\"msg\":";
+        jsonString(out, message);
+        jsonFields(out, fields);
+        out += '}';
+        break;
+    case FieldFormat::LOGFMT:
+        out = "msg=";
+        logfmtString(out, message);
+        logfmtFields(out, fields);
+        break;
+    default: {
+        std::string kv;
+        logfmtFields(kv, fields);
+        out = message;
+        if(!kv.empty()) out += ' ' + kv;
+        }
+    }
+return out;
+}
+
+std::string renderLine(const LogMessage &msg, const std::vector<LogField> &fields, FieldFormat format)
+{
+std::string out;
+if(format == FieldFormat::JSON) {
+    out = "{\"time\":";
+    jsonString(out, msg.timestamp());
+    out += ",\"level\":";
+    jsonString(out, msg._level.text);
+    out += ",\"file\":";
+    jsonString(out, msg.file());
+    out += ",\"line\":" + std::to_string(msg._line) + ",\"function\":";
+    jsonString(out, msg._function);
+    out += ",\"msg\":";
+    jsonString(out, msg._message);
+    jsonFields(out, fields);
+    out += "}\n";
+} else {
+    out = "time=";
+    logfmtString(out, msg.timestamp());
+    out += " level=" + msg._level.text + " file=";
+    logfmtString(out, msg.file());
+    out += " line=" + std::to_string(msg._line) + " function=";
+    logfmtString(out, msg._function);
+    out += " msg=";
+    logfmtString(out, msg._message);
+    logfmtFields(out, fields);
+    out += '\n';
+}
+return out;
+}
+
+} // g3
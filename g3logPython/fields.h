@@ -0,0 +1,50 @@
+/*
+
+  Structured fields of the log messages: log.info("request done", user="bob", latency_ms=12.5)
+
+  The fields are captured on the caller's thread as key / LogValue pairs (numbers and strings are copied:
+  no python object is kept). They travel through g3log encoded in the LogMessage's _expression
+  (unused by g3log for the regular levels), and each sink renders them on its own thread,
+  as selected by its field format:
+    TEXT   : appended to the message:  request done user=bob latency_ms=12.5   (default)
+    LOGFMT : one logfmt line:          time="..." level=INFO file=x.py line=3 function=f msg="request done" user=bob ...
+    JSON   : one JSON object:          {"time":"...","level":"INFO",...,"msg":"request done","user":"bob",...}
+  The sinks formatting the LogMessage by themselves (syslog, color terminal, binary) get the logfmt / JSON
+  rendering of the message and its fields only, as their message.
+
+*/
+
+#pragma once
+
+#include <g3log/logmessage.hpp>
+
+#include "format.h"
+
+#include <string>
+#include <vector>
+
+namespace g3 {
+
+struct LogField
+{
+    std::string key;
+    LogValue value;
+    size_t bytes() const {return key.size() + value.bytes();};
+};
+
+enum class FieldFormat : int {TEXT, LOGFMT, JSON};
+
+// the encoded fields start with this byte (the control messages of dispatch.h start with '\x01')
+#define G3LOGPYTHON_FIELDS_TAG '\x02'
+inline bool hasFields(const LogMessage &msg) {return !msg._expression.empty() && msg._expression[0] == G3LOGPYTHON_FIELDS_TAG;}
+
+std::string encodeFields(const std::vector<LogField> &fields);
+std::vector<LogField> decodeFields(const std::string &encoded); // stops at the first malformed field
+
+// message + fields, as the message of a LogMessage (TEXT: "message k=v ...")
+std::string renderMessage(const std::string &message, const std::vector<LogField> &fields, FieldFormat format);
+
+// complete line of a message with fields (LOGFMT, JSON), for the sinks receiving text. Ends with '\n'.
+std::string renderLine(const LogMessage &msg, const std::vector<LogField> &fields, FieldFormat format);
+
+} // g3
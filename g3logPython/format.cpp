@@ -0,0 +1,264 @@
+//
+//  deferred formatting: see format.h
+//
+// The directives are parsed here, and the values are formatted like python's % operator would do.
+// Only the values captured in LogValue are used: no python object is involved.
+//
+
+#include "format.h"
+
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace g3 {
+
+namespace {
+
+struct Spec
+{
+    std::string flags; // among "-+ #0"
+    int width = -1;
+    int prec = -1;
+    char conv = 0;
+};
+
+// pos: index of the character following the '%'. Returns the index following the directive,
+// or std::string::npos if the directive is incomplete.
+size_t parseSpec(const std::string &fmt, size_t pos, Spec &spec)
+{
+size_t n = fmt.size();
+if(pos < n && fmt[pos] == '(') {
+    spec.conv = '(';
+    size_t close = fmt.find(')', pos);
+    return (close == std::string::npos) ? close : close + 1;
+    }
+while(pos < n && std::string("-+ #0").find(fmt[pos]) != std::string::npos) spec.flags += fmt[pos++];
+if(pos < n && fmt[pos] == '*') { // width from the arguments: not supported
+    spec.conv = '*';
+    return pos + 1;
+    }
+if(pos < n && isdigit((unsigned char)fmt[pos])) {
+    spec.width = 0;
+    while(pos < n && isdigit((unsigned char)fmt[pos])) spec.width = 10 * spec.width + (fmt[pos++] - '0');
+    }
+if(pos < n && fmt[pos] == '.') {
+    pos++;
+    if(pos < n && fmt[pos] == '*') { // precision from the arguments: not supported
+        spec.conv = '*';
+        return pos + 1;
+        }
+    spec.prec = 0;
+    while(pos < n && isdigit((unsigned char)fmt[pos])) spec.prec = 10 * spec.prec + (fmt[pos++] - '0');
+    }
+while(pos < n && (fmt[pos] == 'h' || fmt[pos] == 'l' || fmt[pos] == 'L')) pos++; // length modifiers: ignored by python too
+if(pos >= n) return std::string::npos;
+spec.conv = fmt[pos];
+return pos + 1;
+}
+
+bool hasFlag(const Spec &spec, char flag) {return spec.flags.find(flag) != std::string::npos;}
+
+// the texts are UTF-8: the widths and precisions count code points, as python does
+size_t codePoints(const std::string &text)
+{
+size_t count = 0;
+for(unsigned char c: text) if((c & 0xC0) != 0x80) count++; // not a continuation byte
+return count;
+}
+
+// byte offset of the code point n (text.size() if the text is shorter)
+size_t codePointOffset(const std::string &text, size_t n)
+{
+for(size_t pos = 0; pos < text.size(); pos++) {
+    if(((unsigned char)text[pos] & 0xC0) == 0x80) continue;
+    if(n-- == 0) return pos;
+    }
+return text.size();
+}
+
+// width padding of an already formatted field
+std::string pad(std::string &&text, const Spec &spec)
+{
+if(spec.width < 0) return std::move(text);
+size_t len = codePoints(text);
+if(len >= (size_t)spec.width) return std::move(text);
+size_t fill = spec.width - len;
+if(hasFlag(spec, '-')) return text + std::string(fill, ' ');
+return std::string(fill, ' ') + text;
+}
+
+std::string formatInt(long long val, const Spec &spec)
+{
+int base = 10;
+const char *digitset = "0123456789abcdef";
+std::string prefix;
+switch(spec.conv) {
+    case 'o': base = 8;  if(hasFlag(spec, '#')) prefix = "0o"; break;
+    case 'x': base = 16; if(hasFlag(spec, '#')) prefix = "0x"; break;
+    case 'X': base = 16; if(hasFlag(spec, '#')) prefix = "0X"; digitset = "0123456789ABCDEF"; break;
+    default: break;
+    }
+
+unsigned long long mag = (val < 0) ? 0ULL - (unsigned long long)val : (unsigned long long)val;
+std::string digits;
+do {
+    digits.insert(digits.begin(), digitset[mag % base]);
+    mag /= base;
+  } while(mag > 0);
+if(spec.prec > 0 && digits.size() < (size_t)spec.prec) digits.insert(0, spec.prec - digits.size(), '0');
+
+std::string sign = (val < 0) ? "-" : (hasFlag(spec, '+') ? "+" : (hasFlag(spec, ' ') ? " " : ""));
+size_t len = sign.size() + prefix.size() + digits.size();
+if(hasFlag(spec, '0') && !hasFlag(spec, '-') && spec.width > 0 && len < (size_t)spec.width)
+    digits.insert(0, spec.width - len, '0');
+return pad(sign + prefix + digits, spec);
+}
+
+std::string formatDouble(double val, const Spec &spec)
+{
+std::string cfmt = "%" + spec.flags;
+if(spec.width >= 0) cfmt += std::to_string(spec.width);
+if(spec.prec >= 0) cfmt += "." + std::to_string(spec.prec);
+cfmt += spec.conv;
+
+char buf[128];
+int len = snprintf(buf, sizeof(buf), cfmt.c_str(), val);
+if(len < 0) return std::string();
+if((size_t)len < sizeof(buf)) return std::string(buf, len);
+std::string big(len + 1, '\0');
+snprintf(&big[0], big.size(), cfmt.c_str(), val);
+big.resize(len);
+return big;
+}
+
+// UTF-8 encoding of a code point (for %c)
+std::string utf8Char(long long cp)
+{
+std::string out;
+if(cp < 0 || cp > 0x10FFFF) throw std::logic_error("%c arg not in range(0x110000)");
+if(cp < 0x80) { out += (char)cp; }
+else if(cp < 0x800) { out += (char)(0xC0 | (cp >> 6)); out += (char)(0x80 | (cp & 0x3F)); }
+else if(cp < 0x10000) { out += (char)(0xE0 | (cp >> 12)); out += (char)(0x80 | ((cp >> 6) & 0x3F)); out += (char)(0x80 | (cp & 0x3F)); }
+else { out += (char)(0xF0 | (cp >> 18)); out += (char)(0x80 | ((cp >> 12) & 0x3F)); out += (char)(0x80 | ((cp >> 6) & 0x3F)); out += (char)(0x80 | (cp & 0x3F)); }
+return out;
+}
+
+// python's repr() of a float: the shortest representation that reads back to the same value
+std::string pyFloatRepr(double val)
+{
+if(std::isnan(val)) return "nan";
+if(std::isinf(val)) return (val < 0) ? "-inf" : "inf";
+
+char buf[64];
+int prec = 1;
+for(; prec < 17; prec++) {
+    snprintf(buf, sizeof(buf), "%.*e", prec - 1, val);
+    if(strtod(buf, NULL) == val) break;
+    }
+snprintf(buf, sizeof(buf), "%.*e", prec - 1, val);
+int exponent = atoi(strchr(buf, 'e') + 1); // decimal exponent, after rounding
+
+if(exponent < -4 || exponent >= 16) return std::string(buf);
+
+int decimals = prec - 1 - exponent;
+if(decimals < 0) decimals = 0;
+snprintf(buf, sizeof(buf), "%.*f", decimals, val);
+std::string out(buf);
+if(out.find('.') == std::string::npos) out += ".0";
+return out;
+}
+
+std::string formatValue(const LogValue &val, const Spec &spec)
+{
+switch(spec.conv) {
+    case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+        if(val.kind == LogValue::STR) throw std::logic_error(std::string("%") + spec.conv + " format: a number is required");
+        if(val.kind == LogValue::FLOAT) {
+            if(spec.conv == 'o' || spec.conv == 'x' || spec.conv == 'X') throw std::logic_error(std::string("%") + spec.conv + " format: an integer is required");
+            return formatInt((long long)val.d, spec);
+            }
+        return formatInt(val.i, spec);
+    case 'e': case 'E': case 'f': case 'F': case 'g': case 'G':
+        if(val.kind == LogValue::STR) throw std::logic_error("must be real number, not str");
+        return formatDouble(val.kind == LogValue::FLOAT ? val.d : (double)val.i, spec);
+    case 'c':
+        if(val.kind == LogValue::INT) return pad(utf8Char(val.i), spec);
+        if(val.kind == LogValue::STR) return pad(std::string(val.s), spec);
+        throw std::logic_error("%c requires int or char");
+    case 's': case 'r': case 'a': {
+        std::string text = val.to_str();
+        if(spec.prec >= 0) text.resize(codePointOffset(text, spec.prec)); // on a code point boundary
+        return pad(std::move(text), spec); }
+    default:
+        throw std::logic_error(std::string("unsupported format character '") + spec.conv + "'");
+    }
+}
+
+} // anonymous namespace
+
+std::string LogValue::to_str() const
+{
+switch(kind) {
+    case INT: return std::to_string(i);
+    case BOOL: return i ? "True" : "False";
+    case FLOAT: return pyFloatRepr(d);
+    default: return s;
+    }
+}
+
+std::string fmtConversions(const std::string &fmt)
+{
+std::string convs;
+size_t pos = 0;
+while((pos = fmt.find('%', pos)) != std::string::npos) {
+    Spec spec;
+    size_t next = parseSpec(fmt, pos + 1, spec);
+    if(next == std::string::npos) break;
+    if(spec.conv == '(' || spec.conv == '*') {
+        convs += spec.conv;
+        break;
+        }
+    if(spec.conv != '%') convs += spec.conv;
+    pos = next;
+    }
+return convs;
+}
+
+std::string formatDeferred(const std::string &fmt, const std::vector<LogValue> &args)
+{
+std::string out;
+out.reserve(fmt.size() + 16 * args.size());
+size_t argIdx = 0;
+size_t pos = 0;
+
+try {
+    for(;;) {
+        size_t pct = fmt.find('%', pos);
+        out.append(fmt, pos, (pct == std::string::npos) ? std::string::npos : pct - pos);
+        if(pct == std::string::npos) break;
+
+        Spec spec;
+        size_t next = parseSpec(fmt, pct + 1, spec);
+        if(next == std::string::npos) throw std::logic_error("incomplete format");
+        if(spec.conv == '%') {
+            out += '%';
+        } else {
+            if(argIdx >= args.size()) throw std::logic_error("not enough arguments for format string");
+            out += formatValue(args[argIdx++], spec);
+        }
+        pos = next;
+      }
+    if(argIdx < args.size()) throw std::logic_error("not all arguments converted during string formatting");
+  } catch(std::exception &e) {
+    // never fail while logging: show what we have
+    out = fmt + " [g3logPython format error: " + e.what() + "]";
+    for(auto &arg: args) out += " " + arg.to_str();
+  }
+return out;
+}
+
+} // g3
@@ -0,0 +1,52 @@
+/*
+
+  Deferred formatting of the log messages.
+
+  A message can be logged as a printf-style template plus arguments (as with python's logging:
+  log.info("state=%s id=%d", obj, n) ). The arguments are captured by value (LogValue),
+  and the message is only formatted when the g3log message is built, once the level and the rate limits
+  have accepted it. When the staging is started, this is done by the drainer thread: the formatting cost
+  never reaches the caller's thread. Without staging, the message is built (and formatted) by the log call,
+  on the caller's thread, with the GIL held. Formatting a LogValue never needs the GIL.
+
+  Supported directives: %[flags][width][.precision]conversion, with the conversions of python's
+  % operator: d i u o x X e E f F g G c s r a, and %%. The width and precision taken from the
+  arguments ( %*d, %.*f ) are not supported.
+
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace g3 {
+
+// a value captured on the caller's thread
+struct LogValue
+{
+    enum Kind : char {INT, FLOAT, BOOL, STR};
+    Kind kind;
+    long long i; // INT, BOOL
+    double d;    // FLOAT
+    std::string s; // STR: already converted with str() or repr(), as requested by the directive
+
+    static LogValue from_int(long long val) {LogValue v; v.kind = INT; v.i = val; return v;};
+    static LogValue from_double(double val) {LogValue v; v.kind = FLOAT; v.d = val; return v;};
+    static LogValue from_bool(bool val) {LogValue v; v.kind = BOOL; v.i = val; return v;};
+    static LogValue from_str(std::string &&val) {LogValue v; v.kind = STR; v.s = std::move(val); return v;};
+
+    size_t bytes() const {return s.size();};
+    std::string to_str() const; // same text as python's str() of the original value
+};
+
+// conversion character of each directive of fmt, in order (%% is skipped).
+// A '(' is returned for a mapping key directive ( %(name)s ), a '*' for a width or a precision taken from the arguments:
+// these templates are not deferred.
+std::string fmtConversions(const std::string &fmt);
+
+// formats the template (python's "fmt % args").
+// on error (missing arguments, bad types...), the template is returned with an error note.
+std::string formatDeferred(const std::string &fmt, const std::vector<LogValue> &args);
+
+} // g3
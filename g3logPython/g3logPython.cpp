@@ -1,26 +1,240 @@
 
 #include "intern_log.h"
 #include "g3logPython.h"
+#include "pylog.h"
+#include "ratelimit.h"
+#include "timestamp.h"
 
 #include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include <cmath>
+
+namespace {
+
+// SinkCallResult for each return type of the sink methods.
+// The awaitable part (__await__) is added in __init__.py, on top of fileno().
+template<typename delayed_t>
+void bindSinkCallResult(pybind11::module &m, const char *name)
+{
+pybind11::class_<g3::SinkCallResult<delayed_t>>(m, name)
+    .def("done", &g3::SinkCallResult<delayed_t>::done, "true once the sink has executed the call")
+    .def("wait", &g3::SinkCallResult<delayed_t>::wait, "wait for the completion (timeout in seconds, < 0: none), returns done()", 
+         pybind11::arg("timeout") = -1.0, pybind11::call_guard<pybind11::gil_scoped_release>())
+    .def("result", [](g3::SinkCallResult<delayed_t> &res, double timeout) {
+             bool ready;
+               {
+                 pybind11::gil_scoped_release release;
+                 ready = res.wait(timeout);
+               }
+             if(!ready) {
+                 PyErr_SetString(PyExc_TimeoutError, "SinkCallResult.result: timeout");
+                 throw pybind11::error_already_set();
+                 }
+             return res.result();
+             }, 
+         "value returned by the sink method (waits for it, timeout in seconds, < 0: none)", pybind11::arg("timeout") = -1.0)
+    .def("fileno", &g3::SinkCallResult<delayed_t>::fileno, "eventfd readable once the call has completed (for event loops)");
+}
+
+// ifaceLogWorker.stats() as a dict (latencies in seconds, histogram buckets as cumulative (le, count) pairs)
+pybind11::dict statsDict(const g3::LoggerStats &stats)
+{
+const char *levelNames[] = {"DEBUG", "INFO", "WARNING", "FATAL"};
+pybind11::dict captured;
+for(size_t level = 0; level < stats.captured.size(); level++) captured[levelNames[level]] = stats.captured[level];
+captured["invalid"] = stats.capturedInvalid;
+
+pybind11::list sinks;
+for(auto &sink: stats.sinks) {
+    pybind11::list buckets;
+    for(size_t i = 0; i < sink.latencyBuckets.size(); i++) {
+        uint64_t bound = g3::LatencyHistogram::boundNs(i);
+        double le = (bound == UINT64_MAX) ? HUGE_VAL : bound * 1e-9;
+        buckets.append(pybind11::make_tuple(le, sink.latencyBuckets[i]));
+        }
+    pybind11::dict entry;
+    entry["type"] = sink.type;
+    entry["name"] = sink.name;
+    entry["messages"] = sink.messages;
+    entry["filtered"] = sink.filtered;
+    entry["shared_lines"] = sink.sharedLines;
+    entry["queue_depth"] = sink.queueDepth;
+    entry["queue_high_water"] = sink.queueHighWater;
+    entry["latency_count"] = sink.latencyCount;
+    entry["latency_sum"] = sink.latencySumNs * 1e-9;
+    entry["latency_buckets"] = buckets;
+    sinks.append(entry);
+    }
+
+pybind11::dict out;
+out["captured"] = captured;
+out["filtered"] = stats.filtered;
+out["rate_limited"] = stats.rateLimited;
+out["sent"] = stats.sent;
+out["staged"] = stats.staged;
+out["store_pending"] = stats.storePending;
+out["queue_high_water"] = stats.queueHighWater;
+out["sinks"] = sinks;
+if(stats.sharedRing.parent || stats.sharedRing.attached) {
+    pybind11::dict ring;
+    ring["role"] = stats.sharedRing.attached ? "child" : "parent";
+    ring["received"] = stats.sharedRing.received;
+    ring["dropped"] = stats.sharedRing.dropped;
+    ring["used"] = stats.sharedRing.used;
+    ring["capacity"] = stats.sharedRing.capacity;
+    out["shared_ring"] = ring;
+    }
+const char *policyNames[] = {"block", "drop_newest", "drop_oldest"};
+pybind11::dict overflow;
+overflow["capacity"] = stats.overflow.capacity;
+overflow["policy"] = policyNames[stats.overflow.policy];
+overflow["block_timeout_ms"] = stats.overflow.blockTimeoutMs;
+overflow["in_flight"] = stats.overflow.inFlight;
+overflow["blocked"] = stats.overflow.blocked;
+overflow["timeouts"] = stats.overflow.timeouts;
+overflow["dropped_newest"] = stats.overflow.droppedNewest;
+overflow["dropped_oldest"] = stats.overflow.droppedOldest;
+out["overflow"] = overflow;
+return out;
+}
+
+} // anonymous namespace
 
 PYBIND11_MODULE(_g3logPython, m)
 {
 
+bindSinkCallResult<void>(m, "SinkCallResult");
+bindSinkCallResult<std::string>(m, "SinkCallResult_str");
+bindSinkCallResult<int>(m, "SinkCallResult_int");
+bindSinkCallResult<bool>(m, "SinkCallResult_bool");
+bindSinkCallResult<std::map<std::string, uint64_t>>(m, "SinkCallResult_counts");
+
 m.attr("g3DEBUG")   = pybind11::int_((int)g3::pyLEVEL::pyDEBUG);
 m.attr("g3INFO")    = pybind11::int_((int)g3::pyLEVEL::pyINFO);
 m.attr("g3WARNING") = pybind11::int_((int)g3::pyLEVEL::pyWARNING);
 m.attr("g3FATAL")   = pybind11::int_((int)g3::pyLEVEL::pyFATAL);
 
+// structured fields rendering, per sink (see fields.h)
+m.attr("g3FIELDS_TEXT")   = pybind11::int_((int)g3::FieldFormat::TEXT);
+m.attr("g3FIELDS_LOGFMT") = pybind11::int_((int)g3::FieldFormat::LOGFMT);
+m.attr("g3FIELDS_JSON")   = pybind11::int_((int)g3::FieldFormat::JSON);
+m.attr("g3OVERFLOW_BLOCK")       = pybind11::int_((int)g3::Overflow::BLOCK);
+m.attr("g3OVERFLOW_DROP_NEWEST") = pybind11::int_((int)g3::Overflow::DROP_NEWEST);
+m.attr("g3OVERFLOW_DROP_OLDEST") = pybind11::int_((int)g3::Overflow::DROP_OLDEST);
+m.attr("g3CLOCK_REALTIME")        = pybind11::int_((int)g3::ClockSource::REALTIME);
+m.attr("g3CLOCK_REALTIME_COARSE") = pybind11::int_((int)g3::ClockSource::REALTIME_COARSE);
+m.attr("g3CLOCK_TSC")             = pybind11::int_((int)g3::ClockSource::TSC);
+
 pybind11::class_<g3::SysLogSnkHndl>(m, "SysLogSnkHndl")
+    .def("setFieldFormat", &g3::SysLogSnkHndl::setFieldFormat, "rendering of the structured fields: g3FIELDS_TEXT, g3FIELDS_LOGFMT or g3FIELDS_JSON", pybind11::arg("format"))
+    .def("getFieldFormat", &g3::SysLogSnkHndl::getFieldFormat)
+    .def("setMinLevel", &g3::SysLogSnkHndl::setMinLevel, "minimum level delivered to this sink (g3DEBUG ... g3FATAL)", pybind11::arg("level"))
+    .def("getMinLevel", &g3::SysLogSnkHndl::getMinLevel)
+    .def("setFilePrefixes", &g3::SysLogSnkHndl::setFilePrefixes, "only deliver the messages logged from files starting with one of these prefixes ([]: all)", pybind11::arg("prefixes"))
+    .def("getFilePrefixes", &g3::SysLogSnkHndl::getFilePrefixes)
     .def("setLogHeader", &g3::SysLogSnkHndl::setLogHeader)
     .def("setIdentity",  &g3::SysLogSnkHndl::setIdentity)
     .def("echoToStderr", &g3::SysLogSnkHndl::echoToStderr);    
     
 pybind11::class_<g3::LogRotateSnkHndl>(m, "LogRotateSnkHndl")
-    .def("setMaxArchiveLogCount", &g3::LogRotateSnkHndl::setMaxArchiveLogCount);
+    .def("setFieldFormat", &g3::LogRotateSnkHndl::setFieldFormat, "rendering of the structured fields: g3FIELDS_TEXT, g3FIELDS_LOGFMT or g3FIELDS_JSON", pybind11::arg("format"))
+    .def("getFieldFormat", &g3::LogRotateSnkHndl::getFieldFormat)
+    .def("setMinLevel", &g3::LogRotateSnkHndl::setMinLevel, "minimum level delivered to this sink (g3DEBUG ... g3FATAL)", pybind11::arg("level"))
+    .def("getMinLevel", &g3::LogRotateSnkHndl::getMinLevel)
+    .def("setFilePrefixes", &g3::LogRotateSnkHndl::setFilePrefixes, "only deliver the messages logged from files starting with one of these prefixes ([]: all)", pybind11::arg("prefixes"))
+    .def("getFilePrefixes", &g3::LogRotateSnkHndl::getFilePrefixes)
+    .def("changeLogFile", &g3::LogRotateSnkHndl::changeLogFile, "switch to a new log file, the result is the new file name",
+         pybind11::arg("log_directory"), pybind11::arg("new_name") = "")
+    .def("logFileName", &g3::LogRotateSnkHndl::logFileName)
+    .def("setMaxArchiveLogCount", &g3::LogRotateSnkHndl::setMaxArchiveLogCount)
+    .def("getMaxArchiveLogCount", &g3::LogRotateSnkHndl::getMaxArchiveLogCount)
+    .def("setMaxLogSize", &g3::LogRotateSnkHndl::setMaxLogSize, "the file is archived when it reaches this size (bytes)", pybind11::arg("max_file_size_in_bytes"))
+    .def("getMaxLogSize", &g3::LogRotateSnkHndl::getMaxLogSize)
+    .def("setCompression", &g3::LogRotateSnkHndl::setCompression, "gzip the archives, in the background (default: True)", pybind11::arg("compress"))
+    .def("getCompression", &g3::LogRotateSnkHndl::getCompression)
+    .def("rotate", &g3::LogRotateSnkHndl::rotate, "archive the file now, the result is the archive's name (before compression)")
+    .def("setFlushPolicy", &g3::LogRotateSnkHndl::setFlushPolicy, "0: never (system auto flush), 1 ... N: every n messages", pybind11::arg("flush_policy"))
+    .def("flush", &g3::LogRotateSnkHndl::flush);
+    
+pybind11::class_<g3::ClrTermSnkHndl>(m, "ClrTermSnkHndl")
+    .def("setFieldFormat", &g3::ClrTermSnkHndl::setFieldFormat, "rendering of the structured fields: g3FIELDS_TEXT, g3FIELDS_LOGFMT or g3FIELDS_JSON", pybind11::arg("format"))
+    .def("getFieldFormat", &g3::ClrTermSnkHndl::getFieldFormat)
+    .def("setMinLevel", &g3::ClrTermSnkHndl::setMinLevel, "minimum level delivered to this sink (g3DEBUG ... g3FATAL)", pybind11::arg("level"))
+    .def("getMinLevel", &g3::ClrTermSnkHndl::getMinLevel)
+    .def("setFilePrefixes", &g3::ClrTermSnkHndl::setFilePrefixes, "only deliver the messages logged from files starting with one of these prefixes ([]: all)", pybind11::arg("prefixes"))
+    .def("getFilePrefixes", &g3::ClrTermSnkHndl::getFilePrefixes)
+    .def("setBufferPolicy", &g3::ClrTermSnkHndl::setBufferPolicy,
+         "buffer the output, written when max_bytes are buffered or after max_delay_ms (max_bytes 0: no buffering, max_delay_ms 0: no timer)",
+         pybind11::arg("max_bytes"), pybind11::arg("max_delay_ms") = 100)
+    .def("flush", &g3::ClrTermSnkHndl::flush);
+    
+pybind11::class_<g3::BinSnkHndl>(m, "BinSnkHndl")
+    .def("setFieldFormat", &g3::BinSnkHndl::setFieldFormat, "rendering of the structured fields: g3FIELDS_TEXT, g3FIELDS_LOGFMT or g3FIELDS_JSON", pybind11::arg("format"))
+    .def("getFieldFormat", &g3::BinSnkHndl::getFieldFormat)
+    .def("setMinLevel", &g3::BinSnkHndl::setMinLevel, "minimum level delivered to this sink (g3DEBUG ... g3FATAL)", pybind11::arg("level"))
+    .def("getMinLevel", &g3::BinSnkHndl::getMinLevel)
+    .def("setFilePrefixes", &g3::BinSnkHndl::setFilePrefixes, "only deliver the messages logged from files starting with one of these prefixes ([]: all)", pybind11::arg("prefixes"))
+    .def("getFilePrefixes", &g3::BinSnkHndl::getFilePrefixes)
+    .def("setSegmentSize", &g3::BinSnkHndl::setSegmentSize, "size of the next segments, in bytes", pybind11::arg("bytes"))
+    .def("segmentName", &g3::BinSnkHndl::segmentName)
+    .def("flush", &g3::BinSnkHndl::flush);
+    
+
+pybind11::class_<g3::JournaldSnkHndl>(m, "JournaldSnkHndl")
+    .def("setMinLevel", &g3::JournaldSnkHndl::setMinLevel, "minimum level delivered to this sink (g3DEBUG ... g3FATAL)", pybind11::arg("level"))
+    .def("getMinLevel", &g3::JournaldSnkHndl::getMinLevel)
+    .def("setFilePrefixes", &g3::JournaldSnkHndl::setFilePrefixes, "only deliver the messages logged from files starting with one of these prefixes ([]: all)", pybind11::arg("prefixes"))
+    .def("getFilePrefixes", &g3::JournaldSnkHndl::getFilePrefixes)
+    .def("setIdentifier", &g3::JournaldSnkHndl::setIdentifier, "SYSLOG_IDENTIFIER of the next messages", pybind11::arg("identifier"))
+    .def("identifier", &g3::JournaldSnkHndl::identifier);
+    
+
+pybind11::class_<g3::NetSnkHndl>(m, "NetSnkHndl")
+    .def("setFieldFormat", &g3::NetSnkHndl::setFieldFormat, "rendering of the structured fields: g3FIELDS_TEXT, g3FIELDS_LOGFMT or g3FIELDS_JSON", pybind11::arg("format"))
+    .def("getFieldFormat", &g3::NetSnkHndl::getFieldFormat)
+    .def("setMinLevel", &g3::NetSnkHndl::setMinLevel, "minimum level delivered to this sink (g3DEBUG ... g3FATAL)", pybind11::arg("level"))
+    .def("getMinLevel", &g3::NetSnkHndl::getMinLevel)
+    .def("setFilePrefixes", &g3::NetSnkHndl::setFilePrefixes, "only deliver the messages logged from files starting with one of these prefixes ([]: all)", pybind11::arg("prefixes"))
+    .def("getFilePrefixes", &g3::NetSnkHndl::getFilePrefixes)
+    .def("setBatchPolicy", &g3::NetSnkHndl::setBatchPolicy,
+         "a batch (datagram, or TCP write) is sent when max_bytes are batched, or after max_delay_ms",
+         pybind11::arg("max_bytes"), pybind11::arg("max_delay_ms") = 100)
+    .def("setSpillPolicy", &g3::NetSnkHndl::setSpillPolicy,
+         "at most max_spill_bytes wait for the network: the next lines are dropped, or written to a LogRotate file in overflow_directory",
+         pybind11::arg("max_spill_bytes"), pybind11::arg("overflow_prefix") = "", pybind11::arg("overflow_directory") = "")
+    .def("flush", &g3::NetSnkHndl::flush)
+    .def("address", &g3::NetSnkHndl::address)
+    .def("counters", &g3::NetSnkHndl::counters, "records, sent_records, sent_batches, dropped, spilled, send_errors, connects, connected, queued_bytes");
     
-pybind11::class_<g3::ClrTermSnkHndl>(m, "ClrTermSnkHndl");
+
+pybind11::class_<g3::PluginSnkHndl>(m, "PluginSnkHndl")
+    .def("setFieldFormat", &g3::PluginSnkHndl::setFieldFormat, "rendering of the structured fields: g3FIELDS_TEXT, g3FIELDS_LOGFMT or g3FIELDS_JSON", pybind11::arg("format"))
+    .def("getFieldFormat", &g3::PluginSnkHndl::getFieldFormat)
+    .def("setMinLevel", &g3::PluginSnkHndl::setMinLevel, "minimum level delivered to this sink (g3DEBUG ... g3FATAL)", pybind11::arg("level"))
+    .def("getMinLevel", &g3::PluginSnkHndl::getMinLevel)
+    .def("setFilePrefixes", &g3::PluginSnkHndl::setFilePrefixes, "only deliver the messages logged from files starting with one of these prefixes ([]: all)", pybind11::arg("prefixes"))
+    .def("getFilePrefixes", &g3::PluginSnkHndl::getFilePrefixes)
+    .def("control", &g3::PluginSnkHndl::control, "command specific to the plugin's sink, executed on the sink's thread", pybind11::arg("command"))
+    .def("flush", &g3::PluginSnkHndl::flush);
+
+pybind11::class_<g3::FlightRecSnkHndl>(m, "FlightRecSnkHndl")
+    .def("setFieldFormat", &g3::FlightRecSnkHndl::setFieldFormat, "rendering of the structured fields: g3FIELDS_TEXT, g3FIELDS_LOGFMT or g3FIELDS_JSON", pybind11::arg("format"))
+    .def("getFieldFormat", &g3::FlightRecSnkHndl::getFieldFormat)
+    .def("setMinLevel", &g3::FlightRecSnkHndl::setMinLevel, "minimum level delivered to this sink (g3DEBUG ... g3FATAL)", pybind11::arg("level"))
+    .def("getMinLevel", &g3::FlightRecSnkHndl::getMinLevel)
+    .def("setFilePrefixes", &g3::FlightRecSnkHndl::setFilePrefixes, "only deliver the messages logged from files starting with one of these prefixes ([]: all)", pybind11::arg("prefixes"))
+    .def("getFilePrefixes", &g3::FlightRecSnkHndl::getFilePrefixes)
+    .def("dump", &g3::FlightRecSnkHndl::dump, "the recorded lines, oldest first")
+    .def("dumpToFile", &g3::FlightRecSnkHndl::dumpToFile, "append the recorded lines to a file, the result is the path", pybind11::arg("path"))
+    .def("dumpToSink", &g3::FlightRecSnkHndl::dumpToSink, "write the recorded lines with a LogRotate sink", pybind11::arg("target"))
+    .def("setDumpFile", &g3::FlightRecSnkHndl::setDumpFile, "file the recorded lines are appended to on FATAL (\"\": none)", pybind11::arg("path"))
+    .def("setDumpSink", &g3::FlightRecSnkHndl::setDumpSink, "LogRotate sink writing the recorded lines on FATAL (None: none)", pybind11::arg("target"))
+    .def("clear", &g3::FlightRecSnkHndl::clear)
+    .def("counters", &g3::FlightRecSnkHndl::counters, "recorded, kept, overwritten, truncated, dumps, dump_errors");
+
+// C++ sinks of other modules (see plugin.h)
+m.attr("_sink_plugin_api") = pybind11::capsule(g3::pluginApi(), G3LOGPYTHON_PLUGIN_CAPSULE);
     
 
 pybind11::class_<g3::ifaceLogWorker::SysLogSinkIface_t>(m, "SysLogSinkHndlAccess")
@@ -38,6 +252,29 @@ pybind11::class_<g3::ifaceLogWorker::ClrTermSinkIface_t>(m, "ClrTermSinkHndlAcce
          &g3::ifaceLogWorker::ClrTermSinkIface_t::new_Sink<>,
          "creates a colorTerm sink");
     
+pybind11::class_<g3::ifaceLogWorker::BinSinkIface_t>(m, "BinSinkHndlAccess")
+    .def("new_Sink", 
+         &g3::ifaceLogWorker::BinSinkIface_t::new_Sink<const std::string&, const std::string&>,
+         "creates a binary record sink (decode with g3logPython.bindecode)");
+    
+pybind11::class_<g3::ifaceLogWorker::JournaldSinkIface_t>(m, "JournaldSinkHndlAccess")
+    .def("new_Sink", 
+         &g3::ifaceLogWorker::JournaldSinkIface_t::new_Sink<const std::string&>,
+         "creates a native journald sink (one sd_journal_sendv() per message, with the structured fields)",
+         pybind11::arg("name"), pybind11::arg("identifier"));
+    
+pybind11::class_<g3::ifaceLogWorker::NetSinkIface_t>(m, "NetSinkHndlAccess")
+    .def("new_Sink", 
+         &g3::ifaceLogWorker::NetSinkIface_t::new_Sink<const std::string&>,
+         "creates a network sink, batching the lines to a collector (address: udp://host:port or tcp://host:port)",
+         pybind11::arg("name"), pybind11::arg("address"));
+    
+pybind11::class_<g3::ifaceLogWorker::FlightRecSinkIface_t>(m, "FlightRecSinkHndlAccess")
+    .def("new_Sink", 
+         &g3::ifaceLogWorker::FlightRecSinkIface_t::new_Sink<size_t, size_t>,
+         "creates a flight recorder: the last max_messages messages (truncated to slot_bytes each), kept in memory and dumped on FATAL or on demand",
+         pybind11::arg("name"), pybind11::arg("max_messages") = 4096, pybind11::arg("slot_bytes") = 512);
+    
 pybind11::class_<g3::ifaceLogWorker, std::shared_ptr<g3::ifaceLogWorker>>(m, "ifaceLogWorker")
     .def_readonly("SysLogSinks", 
                   &g3::ifaceLogWorker::SysLogSinks, 
@@ -50,14 +287,132 @@ pybind11::class_<g3::ifaceLogWorker, std::shared_ptr<g3::ifaceLogWorker>>(m, "if
     .def_readonly("ClrTermSinks", 
                   &g3::ifaceLogWorker::ClrTermSinks, 
                   "ColorTerm handle manager", 
-                  pybind11::return_value_policy::reference_internal);
+                  pybind11::return_value_policy::reference_internal)
+    .def_readonly("BinSinks", 
+                  &g3::ifaceLogWorker::BinSinks, 
+                  "binary record sink handle manager", 
+                  pybind11::return_value_policy::reference_internal)
+    .def_readonly("JournaldSinks", 
+                  &g3::ifaceLogWorker::JournaldSinks, 
+                  "native journald sink handle manager", 
+                  pybind11::return_value_policy::reference_internal)
+    .def_readonly("NetSinks", 
+                  &g3::ifaceLogWorker::NetSinks, 
+                  "network sink handle manager", 
+                  pybind11::return_value_policy::reference_internal)
+    .def_readonly("FlightRecSinks", 
+                  &g3::ifaceLogWorker::FlightRecSinks, 
+                  "flight recorder handle manager", 
+                  pybind11::return_value_policy::reference_internal)
+    .def("startStaging", 
+         &g3::ifaceLogWorker::startStaging, 
+         "capture messages asynchronously, through a bounded ring", 
+         pybind11::arg("capacity") = 4096, pybind11::arg("max_bytes") = 16*1024*1024)
+    .def("stopStaging", 
+         &g3::ifaceLogWorker::stopStaging, 
+         "back to synchronous capture, once the staged messages are sent", 
+         pybind11::call_guard<pybind11::gil_scoped_release>())
+    .def("setCaptureLimit", 
+         &g3::ifaceLogWorker::setCaptureLimit, 
+         "bound the messages captured and not yet processed by every sink (0: no limit). overflow: g3OVERFLOW_BLOCK (for up to block_timeout_ms, < 0: no limit), g3OVERFLOW_DROP_NEWEST or g3OVERFLOW_DROP_OLDEST", 
+         pybind11::arg("capacity"), pybind11::arg("overflow") = (int)g3::Overflow::BLOCK, pybind11::arg("block_timeout_ms") = 100)
+    .def("startSharedRing", 
+         &g3::ifaceLogWorker::startSharedRing, 
+         "multi-process: the children forked afterwards send their messages to this process's sinks, through a shared-memory ring", 
+         pybind11::arg("capacity") = 16*1024*1024, pybind11::arg("full_wait_ms") = 100)
+    .def("stopSharedRing", 
+         &g3::ifaceLogWorker::stopSharedRing, 
+         "stop reading the children's messages (once those already written are sent)", 
+         pybind11::call_guard<pybind11::gil_scoped_release>())
+    .def("flush", 
+         &g3::ifaceLogWorker::flush, 
+         "returns once all the messages logged so far are written and the sinks flushed (False on timeout, in seconds)", 
+         pybind11::arg("timeout") = -1.0, 
+         pybind11::call_guard<pybind11::gil_scoped_release>())
+    .def("stats", 
+         [](g3::ifaceLogWorker &worker){ return statsDict(worker.stats()); }, 
+         "runtime metrics: captured messages per level, filtered and dropped messages, queue depths, per-sink latencies, store size");
     
 m.def("get_ifaceLogWorker", 
-      &g3::ifaceLogWorker::get_ifaceLogWorker, 
-      "access the log worker instance", 
-      pybind11::arg("scope_lifetime") = false);
+      [](bool scope_lifetime, size_t capacity, int overflow, int block_timeout_ms, int clock) {
+          if(clock >= 0) g3::setClockSource(clock);
+          std::shared_ptr<g3::ifaceLogWorker> worker = g3::ifaceLogWorker::get_ifaceLogWorker(scope_lifetime);
+          if(capacity > 0) worker -> setCaptureLimit(capacity, overflow, block_timeout_ms);
+          return worker;
+          }, 
+      "access the log worker instance. capacity > 0: also sets the capture limit (see setCaptureLimit). clock >= 0: timestamp source (see set_clock_source)", 
+      pybind11::arg("scope_lifetime") = false, pybind11::arg("capacity") = 0, 
+      pybind11::arg("overflow") = (int)g3::Overflow::BLOCK, pybind11::arg("block_timeout_ms") = 100, pybind11::arg("clock") = -1);
+
+m.def("receivelog", [](pybind11::handle file, int line, pybind11::handle function, int level, pybind11::handle message, pybind11::kwargs fields){ 
+          g3::receivelog_obj(file, line, function, level, message, fields); }, 
+      "send log message to g3log (message: str, bytes or buffer). Keyword arguments are structured fields.",
+      pybind11::arg("file"), pybind11::arg("line"), pybind11::arg("function"), pybind11::arg("level"), pybind11::arg("message"));
+
+m.def("register_callsite", &g3::registerCallSite, "register a call-site, returns its id for receivelog_id()",
+      pybind11::arg("file"), pybind11::arg("line"), pybind11::arg("function"));
+m.def("callsite", &g3::registerCallerSite, "register the call-site of the caller, returns its id for receivelog_id()");
+m.def("receivelog_id", &g3::receivelog_id_obj, "send log message to g3log, from a registered call-site",
+      pybind11::arg("site_id"), pybind11::arg("level"), pybind11::arg("message"));
+
+m.def("set_level", &g3::setMinLevel, "set the minimum level logged (g3DEBUG ... g3FATAL)", pybind11::arg("level"));
+m.def("get_level", &g3::getMinLevel, "get the minimum level logged");
+m.def("set_clock_source", &g3::setClockSource, "timestamp source of the log calls: g3CLOCK_REALTIME, g3CLOCK_REALTIME_COARSE or g3CLOCK_TSC (calibrated, converted to wall time when the message is built)", 
+      pybind11::arg("source"), pybind11::call_guard<pybind11::gil_scoped_release>());
+m.def("get_clock_source", &g3::getClockSource);
+m.def("tsc_available", &g3::tscAvailable, "g3CLOCK_TSC can be used (invariant TSC)");
+m.def("level_enabled", &g3::levelEnabled, "true if messages of this level are currently logged", pybind11::arg("level"));
+
+// per call-site rate limiting and sampling (see ratelimit.h)
+pybind11::class_<g3::RateLimitStats>(m, "RateLimitStats")
+    .def_readonly("file", &g3::RateLimitStats::file)
+    .def_readonly("line", &g3::RateLimitStats::line)
+    .def_readonly("function", &g3::RateLimitStats::function)
+    .def_readonly("level", &g3::RateLimitStats::level)
+    .def_readonly("logged", &g3::RateLimitStats::logged, "messages let through")
+    .def_readonly("sampled", &g3::RateLimitStats::sampled, "messages dropped by the sampling")
+    .def_readonly("limited", &g3::RateLimitStats::limited, "messages dropped by the rate limit");
+
+m.def("set_rate_limit", [](double per_second, double burst, int sample_every, int level){ g3::rateLimiter().setLimit(level, per_second, burst, sample_every); }, 
+      "limit the messages of each call-site: per_second (token bucket of size burst), and/or keep 1 message in sample_every. "
+      "level: g3DEBUG ... g3WARNING, or -1 for the levels without a limit of their own. No rate and no sampling: removes the limit.",
+      pybind11::arg("per_second") = 0.0, pybind11::arg("burst") = 0.0, pybind11::arg("sample_every") = 1, pybind11::arg("level") = -1);
+m.def("clear_rate_limits", [](){ g3::rateLimiter().clear(); }, "remove all the rate limits, and reset the counters");
+m.def("set_suppressed_summary_interval", [](double seconds){ g3::rateLimiter().setSummaryInterval(seconds); }, 
+      "minimum delay between two \"suppressed N messages\" summaries of a call-site, in seconds", pybind11::arg("seconds"));
+m.def("rate_limit_stats", [](){ return g3::rateLimiter().stats(); }, "counters of the rate limited call-sites");
+m.def("dropped_count", [](){ return g3::rateLimiter().dropped(); }, "messages dropped by the rate limits and sampling");
+
+// the call-site is taken from the python frame calling these functions:
+// they must be called directly from the code doing the log, not through a python wrapper.
+m.def("g3log", [](int level, pybind11::handle message, pybind11::args args, pybind11::kwargs fields){ g3::receivelog_caller(level, message, args, fields); }, 
+      "send log message to g3log, from the caller's call-site. Optional arguments for a printf-style message are formatted later, "
+      "keyword arguments are structured fields, rendered by each sink.", 
+      pybind11::arg("level"), pybind11::arg("message"));
+m.def("debug",   [](pybind11::handle message, pybind11::args args, pybind11::kwargs fields){ g3::receivelog_caller((int)g3::pyLEVEL::pyDEBUG,   message, args, fields); }, "log a DEBUG message",   pybind11::arg("message"));
+m.def("info",    [](pybind11::handle message, pybind11::args args, pybind11::kwargs fields){ g3::receivelog_caller((int)g3::pyLEVEL::pyINFO,    message, args, fields); }, "log an INFO message",   pybind11::arg("message"));
+m.def("warning", [](pybind11::handle message, pybind11::args args, pybind11::kwargs fields){ g3::receivelog_caller((int)g3::pyLEVEL::pyWARNING, message, args, fields); }, "log a WARNING message", pybind11::arg("message"));
+m.def("fatal",   [](pybind11::handle message, pybind11::args args, pybind11::kwargs fields){ g3::receivelog_caller((int)g3::pyLEVEL::pyFATAL,   message, args, fields); }, "log a FATAL message",   pybind11::arg("message"));
+m.def("receivelog_batch", &g3::receivelog_batch, "send a sequence of (level, message) or (file, line, function, level, message) tuples to g3log", pybind11::arg("records"));
+m.def("batch",            &g3::receivelog_batch, "send a sequence of (level, message) or (file, line, function, level, message) tuples to g3log", pybind11::arg("records"));
+
+// logging context (see context.h): "with log.context(request_id=rid):", per thread and per asyncio task
+pybind11::class_<g3::LogContext>(m, "LogContext")
+    .def("__enter__", &g3::LogContext::enter, pybind11::return_value_policy::reference)
+    .def("__exit__", &g3::LogContext::exit);
+m.def("context", &g3::context_obj, "context manager: the keyword arguments are structured fields added to every message logged within it, "
+      "by the calling thread or asyncio task (the fields of the messages take precedence)");
+m.def("get_context", &g3::currentContextDict, "the fields of the current logging context, as a dict");
 
-m.def("receivelog", &g3::receivelog, "send log message to g3log");
+// stdlib logging bridge: the Handler class is defined in __init__.py (a logging.Handler),
+// its handle() and emit() are these functions, bound as methods: no python code runs per record.
+m.def("_bind_logging_handler", [](pybind11::handle cls){
+          pybind11::setattr(cls, "handle", pybind11::cpp_function(&g3::handleLogRecord, pybind11::name("handle"), pybind11::is_method(cls), 
+                            "applies the handler's filters, then logs the record with g3log"));
+          pybind11::setattr(cls, "emit", pybind11::cpp_function(&g3::receivelog_record, pybind11::name("emit"), pybind11::is_method(cls), 
+                            "logs the record with g3log"));
+          }, 
+      "installs handle() and emit() on the logging.Handler subclass", pybind11::arg("cls"));
 
 }
 
@@ -18,14 +18,25 @@ On fedora 32:
 #include <g3sinks/syslogsink.hpp>
 #include <g3sinks/LogRotate.h>
 #include "ColorTermSink.h"
+#include "BinarySink.h"
+#include "JournaldSink.h"
+#include "NetSink.h"
+#include "PluginSink.h"
+#include "FlightRecorderSink.h"
+#include "RotatingLogFile.h"
+#include "dispatch.h"
+#include "metrics.h"
+#include "overflow.h"
 
 #include <climits>
 #include <cstring>
 
 #include <iostream>
+#include <list>
 #include <map>
 #include <memory>
 #include <set>
+#include <shared_mutex>
 
 namespace g3 {
     
@@ -35,13 +46,23 @@ class ifaceLogWorker;
 class SysLogSnkHndl;
 class LogRotateSnkHndl;
 class ClrTermSnkHndl;
+class BinSnkHndl;
+class JournaldSnkHndl;
+class NetSnkHndl;
+class PluginSnkHndl;
+class FlightRecSnkHndl;
 
 // singleton interface to g3log:
 std::shared_ptr<ifaceLogWorker> getifaceLogWorker();
 
-// for the sink std::maps :
+// g3log level of a pyLEVEL value (WARNING for invalid values)
+const LEVELS &pyLevelToG3(int level_val);
+
+// sink keys: (generation << SinkKeyIndexBits) | (slot index + 1), never 0.
+// the generation is part of the key, checked by access(): a removal of sinks would bump it (g3log has none here).
 typedef unsigned int sinkkey_t;
 #define InvalidSinkKey (0)
+#define SinkKeyIndexBits (16)
 
 enum SINK_HNDL_OPTIONS
 {
@@ -50,18 +71,19 @@ MULT_INSTANCES_ALLOWED = 1,
 
 class ThdStore;
 
-// manages an RAII mutex-protected raw pointer to g3log's handle
+// manages an RAII lock-protected raw pointer to g3log's handle
+// (by default a shared lock: many threads can access the handles concurrently)
 // note: std::scoped_lock is not moveable
-template<typename Protected_t>
+template<typename Protected_t, typename Lock_t = std::shared_lock<std::shared_timed_mutex>>
 class LockedObj {
   public:
     LockedObj() = delete;
     LockedObj(const LockedObj&) = delete;
     LockedObj(LockedObj &&to_move) noexcept: p_hndl(to_move.p_hndl), raiiLock(std::move(to_move.raiiLock)){};
-    LockedObj(std::mutex &to_lock): raiiLock(to_lock) {p_hndl = nullptr;};
+    LockedObj(typename Lock_t::mutex_type &to_lock): raiiLock(to_lock) {p_hndl = nullptr;};
     Protected_t p_hndl;
   private:
-    std::unique_lock<std::mutex> raiiLock;
+    Lock_t raiiLock;
 };
 
 
@@ -108,23 +130,36 @@ public:
       class Ptr_Mnger
         {
         public:
+          // a sink handle, with the strings passed to the sink constructor (that must live as long as the sink),
+          // and the options shared with the sink's dispatcher.
+          struct Entry {
+              std::unique_ptr<g3::SinkHandle<g3logSinkCls>> hndl;
+              std::list<std::string> ctorStrings;
+              std::shared_ptr<SinkOptions> options;
+            };
+          
           Ptr_Mnger(const Ptr_Mnger &) = delete;
-          sinkkey_t insert(std::unique_ptr<g3::SinkHandle<g3logSinkCls>>); // lock + unlock of mutex
+          sinkkey_t insert(std::unique_ptr<g3::SinkHandle<g3logSinkCls>>, std::list<std::string> &&ctorStrings, std::shared_ptr<SinkOptions> options); // exclusive lock + unlock
           
-          //g3::SinkHandle<g3logSinkCls> *accessTOREPLACE(sinkkey_t key); // locks the mutex. call done() once finished to release it. 
-          //void done(sinkkey_t key); // unlocks the mutex locked by access().
+          // shared lock + unlock. The options of every sink, with its key.
+          std::vector<std::pair<sinkkey_t, std::shared_ptr<SinkOptions>>> options();
           
+          // shared lock, released when the returned object is destroyed. Throws for unknown or stale keys.
           class g3::LockedObj<g3::SinkHandle<g3logSinkCls> *> access(sinkkey_t key);
           
-          void remove(sinkkey_t); // lock + unlock of mutex
-          
         private:
           friend class ifaceLogWorker::SinkHndlAccess<g3logSinkCls, ClbkType, g3logMsgMvr, pySinkCls>;
           Ptr_Mnger(){};
-          std::mutex _lock; // protects all the datastructures herein
-          std::set<sinkkey_t> _in_use; // keys in use
-          std::set<sinkkey_t> _free; // deleted keys for reuse
-          std::map<sinkkey_t, std::unique_ptr<g3::SinkHandle<g3logSinkCls>>> _key_to_uniquePtr;
+          
+          struct Slot {
+              Entry entry;
+              sinkkey_t generation = 0;
+            };
+          // returns the slot of a valid key, or nullptr. _lock must be held.
+          Slot *find(sinkkey_t key);
+          
+          std::shared_timed_mutex _lock; // protects all the datastructures herein. Exclusive for insert only.
+          std::vector<Slot> _slots; // indexed by the key's index
         };
       
       class Name_Mnger
@@ -134,6 +169,7 @@ public:
           bool reserve(const std::string& name); // lock + unlock of mutex. returns "true" when successfully reserved (if name already exists: returns false)
           void set_key(const std::string& name, sinkkey_t key); // lock + unlock of mutex
           sinkkey_t get_key(const std::string& name); // lock + unlock of mutex
+          std::map<sinkkey_t, std::string> names(); // lock + unlock of mutex
           void remove(const std::string& name); // lock + unlock of mutex
           size_t get_size(); // lock + unlock of mutex
         private:
@@ -151,9 +187,17 @@ public:
       
       uint32_t _options; // bitmask (MULT_INSTANCES_ALLOWED...)
       
+      // appends the metrics of the sinks of this type (for ifaceLogWorker::stats() )
+      void collectStats(const char *type, std::vector<SinkStats> &out);
+      
       friend class SysLogSnkHndl;
       friend class LogRotateSnkHndl; 
       friend class ClrTermSnkHndl; 
+      friend class BinSnkHndl; 
+      friend class JournaldSnkHndl; 
+      friend class NetSnkHndl; 
+      friend class PluginSnkHndl; 
+      friend class FlightRecSnkHndl; 
       
       Ptr_Mnger _g3logPtrs;
       Name_Mnger _userNames;
@@ -165,35 +209,49 @@ public:
       //U store(T&& dat) {return std::forward<T>(dat);};
           
       // simply copy the data
-      std::string store(std::string content) {
-          //std::cerr << "string  STORE CALLED" << std::endl;
+      std::string store(std::list<std::string> &, std::string content) {
           return std::string(content);
           };
           
-      // copy the data manually, and keep ownership until the end of the program.
-      // not that bad, because you usually don't add a huge number of sinks, and these are
-      // stored only on sink creation.
-      // TODO: remove memory leak
-      const char * store(const char *content) {
-          //std::cerr << "const char * STORE CALLED" << content << std::endl;
-          size_t len = strlen(content);
-          char* persist = new char[len + 1];
-          memcpy(persist, content, len+1);
-          return persist;
+      // copy the data into "keep", stored by Ptr_Mnger with the sink handle.
+      // (std::list: the existing elements don't move when inserting)
+      const char * store(std::list<std::string> &keep, const char *content) {
+          keep.emplace_back(content);
+          return keep.back().c_str();
          }
          
+      // the sink of a plugin (see plugin.h): owned by the PluginSink
+      std::shared_ptr<plugin::Sink> store(std::list<std::string> &, std::shared_ptr<plugin::Sink> sink) {
+          return sink;
+          }
+         
+      // sizes (flight recorder)
+      size_t store(std::list<std::string> &, size_t value) {
+          return value;
+          }
+         
       
     }; // class SinkHndlAccess
     
   // typedefs of message mover functions:
   typedef void (g3::SyslogSink::* SyslogMvr_t)(g3::LogMessageMover) ;
-  typedef void (LogRotate::* LogRotateMvr_t)(std::string) ;
+  typedef void (g3::RotatingLogFile::* LogRotateMvr_t)(std::string) ;
   typedef void (g3::ColorTermSink::* ClrTermMvr_t)(g3::LogMessageMover) ;
+  typedef void (g3::BinarySink::* BinMvr_t)(g3::LogMessageMover) ;
+  typedef void (g3::JournaldSink::* JournaldMvr_t)(g3::LogMessageMover) ;
+  typedef void (g3::NetSink::* NetMvr_t)(std::string) ;
+  typedef void (g3::PluginSink::* PluginMvr_t)(g3::LogMessageMover) ;
+  typedef void (g3::FlightRecorderSink::* FlightRecMvr_t)(g3::LogMessageMover) ;
   
   // types for the specialized sink interfaces of ifaceLogWorker:
   using SysLogSinkIface_t = ifaceLogWorker::SinkHndlAccess<g3::SyslogSink, SyslogMvr_t, &g3::SyslogSink::syslog, g3::SysLogSnkHndl>;
-  using LogRotateSinkIface_t = ifaceLogWorker::SinkHndlAccess<LogRotate, LogRotateMvr_t, &LogRotate::save, g3::LogRotateSnkHndl>;
+  using LogRotateSinkIface_t = ifaceLogWorker::SinkHndlAccess<g3::RotatingLogFile, LogRotateMvr_t, &g3::RotatingLogFile::save, g3::LogRotateSnkHndl>;
   using ClrTermSinkIface_t = ifaceLogWorker::SinkHndlAccess<g3::ColorTermSink, ClrTermMvr_t, &g3::ColorTermSink::ReceiveLogMessage, g3::ClrTermSnkHndl>;
+  using BinSinkIface_t = ifaceLogWorker::SinkHndlAccess<g3::BinarySink, BinMvr_t, &g3::BinarySink::ReceiveLogMessage, g3::BinSnkHndl>;
+  using JournaldSinkIface_t = ifaceLogWorker::SinkHndlAccess<g3::JournaldSink, JournaldMvr_t, &g3::JournaldSink::ReceiveLogMessage, g3::JournaldSnkHndl>;
+  using NetSinkIface_t = ifaceLogWorker::SinkHndlAccess<g3::NetSink, NetMvr_t, &g3::NetSink::ReceiveLine, g3::NetSnkHndl>;
+  using PluginSinkIface_t = ifaceLogWorker::SinkHndlAccess<g3::PluginSink, PluginMvr_t, &g3::PluginSink::ReceiveLogMessage, g3::PluginSnkHndl>;
+  using FlightRecSinkIface_t = ifaceLogWorker::SinkHndlAccess<g3::FlightRecorderSink, FlightRecMvr_t, &g3::FlightRecorderSink::ReceiveLogMessage, g3::FlightRecSnkHndl>;
   
 public:
 
@@ -203,6 +261,11 @@ public:
   SysLogSinkIface_t SysLogSinks; // TODO VERY URGENT : don't allow creation of more than one syslog sink TODO
   LogRotateSinkIface_t LogRotateSinks;
   ClrTermSinkIface_t ClrTermSinks;
+  BinSinkIface_t BinSinks;
+  JournaldSinkIface_t JournaldSinks; // native journald (sd_journal_sendv), with the structured fields
+  NetSinkIface_t NetSinks; // UDP / TCP collectors, batched
+  PluginSinkIface_t PluginSinks; // added by other compiled modules (see plugin.h), not from python
+  FlightRecSinkIface_t FlightRecSinks; // the last messages in memory, dumped on FATAL or on demand
   
   // scope_lifetime on first call:
   //  - when set to false (default), the interface remains alive until the program exits. 
@@ -210,18 +273,44 @@ public:
   // That parameter is only used on the first call, any subsequent call will ignore this argument.
   static std::shared_ptr<ifaceLogWorker> get_ifaceLogWorker(bool scope_lifetime = false);
 
+  // asynchronous capture: the callers only copy their messages into a bounded ring,
+  // emptied in a drainer thread. See staging.h for the memory bound.
+  void startStaging(size_t capacity = 4096, size_t max_bytes = 16*1024*1024);
+  void stopStaging(); // also done when the interface is destroyed
+  
+  // bounded capture queue: at most "capacity" messages captured and not yet processed by every sink (0: no limit),
+  // "overflow" (an Overflow) decides the fate of the next ones. See overflow.h
+  void setCaptureLimit(size_t capacity, int overflow = (int)Overflow::BLOCK, int block_timeout_ms = 100);
+  
+  // multi-process deployments: the children forked after this call send their records to this process,
+  // through a shared-memory ring, instead of logging on their own. See shmring.h.
+  void startSharedRing(size_t capacity = 16*1024*1024, int full_wait_ms = 100);
+  void stopSharedRing(); // also done when the interface is destroyed
+  
+  // durability point: returns once every message logged before the call has been written
+  // and every sink flushed (LogRotate files...). Sends a barrier behind the pending messages (see dispatch.h)
+  // timeout in seconds (< 0: none). Returns false on timeout.
+  bool flush(double timeout = -1);
+  
+  // before a FATAL message of python: the messages logged so far reach the flight recorders,
+  // which write their dump while the other sinks still run (see FlightRecorderSink.h). Waits for 1 s at most.
+  static void dumpFlightRecorders();
+
+  // runtime metrics: captured messages, queue depths, sink latencies... (see metrics.h)
+  LoggerStats stats();
+
   // may be useful for debug purposes:
   void print_addr(){ {std::cout << singleton._instance.lock().get() << std::endl;} }  
     
 public: 
   ifaceLogWorker(const ifaceLogWorker &) = delete;
   ifaceLogWorker &operator=(const ifaceLogWorker &) = delete;
-  //~ifaceLogWorker() {std::cerr << "ifaceLogWorker deleted" << std::endl;};
+  ~ifaceLogWorker(); // stops the staging before the LogWorker is destroyed
         
     ThdStore Store; // TODO : make it private : proxy it somehow
   
 private:
-  ifaceLogWorker(): SysLogSinks(0), LogRotateSinks(MULT_INSTANCES_ALLOWED), ClrTermSinks(MULT_INSTANCES_ALLOWED) {};
+  ifaceLogWorker(): SysLogSinks(0), LogRotateSinks(MULT_INSTANCES_ALLOWED), ClrTermSinks(MULT_INSTANCES_ALLOWED), BinSinks(MULT_INSTANCES_ALLOWED), JournaldSinks(MULT_INSTANCES_ALLOWED), NetSinks(MULT_INSTANCES_ALLOWED), PluginSinks(MULT_INSTANCES_ALLOWED), FlightRecSinks(MULT_INSTANCES_ALLOWED) {};
   static struct  sglt_t{
       static std::once_flag initInstanceFlag;
       static std::once_flag killKeepaliveFlag;
@@ -233,7 +322,9 @@ private:
       // the user is released. If the keepalive pointer is not nullified, the singleton is only deleted at the end of the process.
       static void kill_keepalive(){ _keepalive = nullptr; }
     } singleton;
+  static void atforkChild(); // attaches the child to the shared ring (see shmring.h)
     
+  std::atomic<int> _sinkCount{0}; // sinks added to the worker, each one arrives at the flush barriers
   std::unique_ptr<LogWorker> worker;
   
 
@@ -249,15 +340,31 @@ public:
   //cmmnSinkHndl(const cmmnSinkHndl &) = delete;
   cmmnSinkHndl &operator=(const cmmnSinkHndl &) = delete;
   
+  // rendering of the structured fields by this sink (a FieldFormat, see fields.h), from the next messages on
+  void setFieldFormat(int format);
+  int getFieldFormat();
+  // filters, checked by the dispatcher before the sink gets the message (see dispatch.h). Can be changed while logging.
+  void setMinLevel(int level_val); // a pyLEVEL: the messages below it are skipped (FATAL messages always reach the sinks)
+  int getMinLevel();
+  void setFilePrefixes(const std::vector<std::string> &prefixes); // only the messages of files starting with one of them (empty: all)
+  std::vector<std::string> getFilePrefixes();
+  
 private:
   friend class SysLogSnkHndl;    // gives access to the private constructor
   friend class LogRotateSnkHndl; 
   friend class ClrTermSnkHndl;
+  friend class BinSnkHndl;
+  friend class JournaldSnkHndl;
+  friend class NetSnkHndl;
+  friend class PluginSnkHndl;
+  friend class FlightRecSnkHndl;
   
-  cmmnSinkHndl(std::shared_ptr<ifaceLogWorker> pworker, sinkkey_t key) : _p_wrkrKeepalive(pworker), _key(key) {};
+  cmmnSinkHndl(std::shared_ptr<ifaceLogWorker> pworker, sinkkey_t key, std::shared_ptr<SinkOptions> options) : 
+      _p_wrkrKeepalive(pworker), _key(key), _options(options) {};
   
   std::shared_ptr<ifaceLogWorker> _p_wrkrKeepalive; // as long as all handles aren't destroyed we can't destroy the logworker
   sinkkey_t _key; // for the map: _key -> unique_ptr
+  std::shared_ptr<SinkOptions> _options; // shared with the sink's dispatcher
 };
     
 // ------------------------------------------------------------------------------
@@ -274,13 +381,20 @@ private:
 class SysLogSnkHndl: private cmmnSinkHndl
 {
 public:
+  using cmmnSinkHndl::setFieldFormat;
+  using cmmnSinkHndl::getFieldFormat;
+  using cmmnSinkHndl::setMinLevel;
+  using cmmnSinkHndl::getMinLevel;
+  using cmmnSinkHndl::setFilePrefixes;
+  using cmmnSinkHndl::getFilePrefixes;
     
-  void setLogHeader(const char* change);
-  void echoToStderr(); // enables the Linux extension LOG_PERROR
+  // the sink methods return a SinkCallResult, resolved when the sink's thread has executed the call.
+  SinkCallResult<void> setLogHeader(const char* change);
+  SinkCallResult<void> echoToStderr(); // enables the Linux extension LOG_PERROR
   
 // from syslog(3) : The argument ident in the call of openlog() is probably stored as-is. Thus, if the string it points to is changed, syslog() may start prepending the changed string, and if the string it points to ceases to exist, the results are undefined. 
 // --> we have to store the string in a long-term storage
-  void setIdentity(std::string& id);
+  SinkCallResult<void> setIdentity(std::string& id);
   void setFacility(int facility);
   void setOption(int option);
   void setLevelMap(std::map<int, int> const& m);
@@ -294,24 +408,36 @@ public:
   
 private:
   friend ifaceLogWorker::SysLogSinkIface_t;
-  SysLogSnkHndl(std::shared_ptr<ifaceLogWorker> pworker, sinkkey_t key) : cmmnSinkHndl(pworker, key) {};
+  SysLogSnkHndl(std::shared_ptr<ifaceLogWorker> pworker, sinkkey_t key, std::shared_ptr<SinkOptions> options) : cmmnSinkHndl(pworker, key, options) {};
   
 }; // SysLogSnkHndl
     
     
 class LogRotateSnkHndl: private cmmnSinkHndl
 {
-public:  
+public:
+  using cmmnSinkHndl::setFieldFormat;
+  using cmmnSinkHndl::getFieldFormat;
+  using cmmnSinkHndl::setMinLevel;
+  using cmmnSinkHndl::getMinLevel;
+  using cmmnSinkHndl::setFilePrefixes;
+  using cmmnSinkHndl::getFilePrefixes;
   
   void save(std::string& logEnty);
-  std::string changeLogFile(const std::string& log_directory, const std::string& new_name="");
-  std::string logFileName();
-  void setMaxArchiveLogCount(int max_size);
-  int getMaxArchiveLogCount();
-  void setFlushPolicy(size_t flush_policy); // 0: never (system auto flush), 1 ... N: every n times
-  void flush();
-  void setMaxLogSize(int max_file_size_in_bytes);
-  int getMaxLogSize();
+  // non-blocking: the results are available from the returned SinkCallResult
+  SinkCallResult<std::string> changeLogFile(const std::string& log_directory, const std::string& new_name="");
+  SinkCallResult<std::string> logFileName();
+  SinkCallResult<void> setMaxArchiveLogCount(int max_size);
+  SinkCallResult<int> getMaxArchiveLogCount();
+  SinkCallResult<void> setFlushPolicy(size_t flush_policy); // 0: never (system auto flush), 1 ... N: every n times
+  SinkCallResult<void> flush(); // note: ifaceLogWorker::flush() also flushes the messages pending in the worker
+  // rotation (see RotatingLogFile.h): the file is archived when it reaches max_file_size_in_bytes,
+  // the archives are gzipped in the background unless the compression is switched off
+  SinkCallResult<void> setMaxLogSize(int max_file_size_in_bytes);
+  SinkCallResult<int> getMaxLogSize();
+  SinkCallResult<void> setCompression(bool compress);
+  SinkCallResult<bool> getCompression();
+  SinkCallResult<std::string> rotate(); // now, returns the archive's name
   
 public:
   LogRotateSnkHndl() = delete;
@@ -320,7 +446,8 @@ public:
   
 private:
   friend ifaceLogWorker::LogRotateSinkIface_t;
-  LogRotateSnkHndl(std::shared_ptr<ifaceLogWorker> pworker, sinkkey_t key) : cmmnSinkHndl(pworker, key)  {};
+  friend class FlightRecSnkHndl; // dumps to a LogRotate sink
+  LogRotateSnkHndl(std::shared_ptr<ifaceLogWorker> pworker, sinkkey_t key, std::shared_ptr<SinkOptions> options) : cmmnSinkHndl(pworker, key, options) {};
   
 }; // LogRotateSnkHndl  
 
@@ -329,14 +456,147 @@ private:
 class ClrTermSnkHndl: private cmmnSinkHndl
 {
 public:
-  // Sink methods go here...
+  using cmmnSinkHndl::setFieldFormat;
+  using cmmnSinkHndl::getFieldFormat;
+  using cmmnSinkHndl::setMinLevel;
+  using cmmnSinkHndl::getMinLevel;
+  using cmmnSinkHndl::setFilePrefixes;
+  using cmmnSinkHndl::getFilePrefixes;
+  // max_bytes == 0: one write per line (default), otherwise see ColorTermSink.h
+  SinkCallResult<void> setBufferPolicy(size_t max_bytes, int max_delay_ms);
+  SinkCallResult<void> flush();
+  
 public:
   ClrTermSnkHndl() = delete;
   ClrTermSnkHndl &operator=(const ClrTermSnkHndl &) = delete;
   
 private:
   friend ifaceLogWorker::ClrTermSinkIface_t;
-  ClrTermSnkHndl(std::shared_ptr<ifaceLogWorker> pworker, sinkkey_t key) : cmmnSinkHndl(pworker, key) {};
+  ClrTermSnkHndl(std::shared_ptr<ifaceLogWorker> pworker, sinkkey_t key, std::shared_ptr<SinkOptions> options) : cmmnSinkHndl(pworker, key, options) {};
 }; // ClrTermSnkHndl   
     
+    
+class BinSnkHndl: private cmmnSinkHndl
+{
+public:
+  using cmmnSinkHndl::setFieldFormat;
+  using cmmnSinkHndl::getFieldFormat;
+  using cmmnSinkHndl::setMinLevel;
+  using cmmnSinkHndl::getMinLevel;
+  using cmmnSinkHndl::setFilePrefixes;
+  using cmmnSinkHndl::getFilePrefixes;
+  SinkCallResult<void> setSegmentSize(size_t bytes); // from the next segment on
+  SinkCallResult<std::string> segmentName(); // file of the current segment
+  SinkCallResult<void> flush();
+  
+public:
+  BinSnkHndl() = delete;
+  BinSnkHndl &operator=(const BinSnkHndl &) = delete;
+  
+private:
+  friend ifaceLogWorker::BinSinkIface_t;
+  BinSnkHndl(std::shared_ptr<ifaceLogWorker> pworker, sinkkey_t key, std::shared_ptr<SinkOptions> options) : cmmnSinkHndl(pworker, key, options) {};
+}; // BinSnkHndl
+    
+    
+// note: the structured fields are sent as journal fields, and not rendered in MESSAGE (no field format)
+class JournaldSnkHndl: private cmmnSinkHndl
+{
+public:
+  using cmmnSinkHndl::setMinLevel;
+  using cmmnSinkHndl::getMinLevel;
+  using cmmnSinkHndl::setFilePrefixes;
+  using cmmnSinkHndl::getFilePrefixes;
+  SinkCallResult<void> setIdentifier(const std::string &identifier); // SYSLOG_IDENTIFIER of the next messages
+  SinkCallResult<std::string> identifier();
+  
+public:
+  JournaldSnkHndl() = delete;
+  JournaldSnkHndl &operator=(const JournaldSnkHndl &) = delete;
+  
+private:
+  friend ifaceLogWorker::JournaldSinkIface_t;
+  JournaldSnkHndl(std::shared_ptr<ifaceLogWorker> pworker, sinkkey_t key, std::shared_ptr<SinkOptions> options) : cmmnSinkHndl(pworker, key, options) {};
+}; // JournaldSnkHndl
+    
+    
+class NetSnkHndl: private cmmnSinkHndl
+{
+public:
+  using cmmnSinkHndl::setFieldFormat;
+  using cmmnSinkHndl::getFieldFormat;
+  using cmmnSinkHndl::setMinLevel;
+  using cmmnSinkHndl::getMinLevel;
+  using cmmnSinkHndl::setFilePrefixes;
+  using cmmnSinkHndl::getFilePrefixes;
+  SinkCallResult<void> setBatchPolicy(size_t max_bytes, int max_delay_ms);
+  // lines queued for the network, at most max_spill_bytes: the next ones are dropped, or written to a LogRotate file
+  SinkCallResult<void> setSpillPolicy(size_t max_spill_bytes, const std::string &overflow_prefix, const std::string &overflow_directory);
+  SinkCallResult<void> flush(); // hands the open batch to the I/O thread
+  SinkCallResult<std::string> address();
+  SinkCallResult<std::map<std::string, uint64_t>> counters();
+  
+public:
+  NetSnkHndl() = delete;
+  NetSnkHndl &operator=(const NetSnkHndl &) = delete;
+  
+private:
+  friend ifaceLogWorker::NetSinkIface_t;
+  NetSnkHndl(std::shared_ptr<ifaceLogWorker> pworker, sinkkey_t key, std::shared_ptr<SinkOptions> options) : cmmnSinkHndl(pworker, key, options) {};
+}; // NetSnkHndl
+    
+    
+// handle of a sink added through the plugin API (see plugin.h)
+class PluginSnkHndl: private cmmnSinkHndl
+{
+public:
+  using cmmnSinkHndl::setFieldFormat;
+  using cmmnSinkHndl::getFieldFormat;
+  using cmmnSinkHndl::setMinLevel;
+  using cmmnSinkHndl::getMinLevel;
+  using cmmnSinkHndl::setFilePrefixes;
+  using cmmnSinkHndl::getFilePrefixes;
+  SinkCallResult<std::string> control(const std::string &command); // plugin::Sink::control(), on the sink's thread
+  SinkCallResult<void> flush();
+  
+public:
+  PluginSnkHndl() = delete;
+  PluginSnkHndl &operator=(const PluginSnkHndl &) = delete;
+  
+private:
+  friend ifaceLogWorker::PluginSinkIface_t;
+  PluginSnkHndl(std::shared_ptr<ifaceLogWorker> pworker, sinkkey_t key, std::shared_ptr<SinkOptions> options) : cmmnSinkHndl(pworker, key, options) {};
+}; // PluginSnkHndl
+    
+    
+// handle of a flight recorder (see FlightRecorderSink.h)
+class FlightRecSnkHndl: private cmmnSinkHndl
+{
+public:
+  using cmmnSinkHndl::setFieldFormat;
+  using cmmnSinkHndl::getFieldFormat;
+  using cmmnSinkHndl::setMinLevel;
+  using cmmnSinkHndl::getMinLevel;
+  using cmmnSinkHndl::setFilePrefixes;
+  using cmmnSinkHndl::getFilePrefixes;
+  SinkCallResult<std::string> dump(); // the recorded lines
+  SinkCallResult<std::string> dumpToFile(const std::string &path); // appended, the result is the path
+  SinkCallResult<void> dumpToSink(const LogRotateSnkHndl &target); // the dump is written by the LogRotate sink
+  // dumps on FATAL: to a file ("": none) and / or to a LogRotate sink (nullptr: none)
+  SinkCallResult<void> setDumpFile(const std::string &path);
+  SinkCallResult<void> setDumpSink(const LogRotateSnkHndl *target);
+  SinkCallResult<void> clear();
+  SinkCallResult<std::map<std::string, uint64_t>> counters();
+  
+public:
+  FlightRecSnkHndl() = delete;
+  FlightRecSnkHndl &operator=(const FlightRecSnkHndl &) = delete;
+  
+private:
+  friend ifaceLogWorker::FlightRecSinkIface_t;
+  FlightRecSnkHndl(std::shared_ptr<ifaceLogWorker> pworker, sinkkey_t key, std::shared_ptr<SinkOptions> options) : cmmnSinkHndl(pworker, key, options) {};
+  
+  FlightRecorderSink::Output logRotateOutput(const LogRotateSnkHndl &target); // posts the dump to the target's thread
+}; // FlightRecSnkHndl
+    
 } // g3
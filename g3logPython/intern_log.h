@@ -3,14 +3,34 @@
 #include <cstring>
 
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <future>
 #include <list>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
 
 namespace g3 {
     
 void receivelog(const char *file, int line, const char* functionname, int level_val, const char *message);
 
+// same as receivelog(), but takes ownership of the message: it is moved into the g3log message, without any copy.
+void receivelog_str(const char *file, int line, const char* functionname, int level_val, std::string &&message);
+
+struct LogValue;
+// deferred formatting: the template and its arguments are only formatted when the g3log message is built (see format.h):
+// by the drainer thread with staging, by this call (the caller's thread) without
+void receivelog_fmt(const char *file, int line, const char* functionname, int level_val, std::string &&fmt, std::vector<LogValue> &&args);
+
+struct LogField;
+// structured message: the fields are rendered by each sink, on the worker thread (see fields.h). args may be empty.
+void receivelog_kv(const char *file, int line, const char* functionname, int level_val, std::string &&fmt, std::vector<LogValue> &&args, std::vector<LogField> &&fields);
+
 enum class pyLEVEL : int
 {
     pyDEBUG,
@@ -19,10 +39,122 @@ enum class pyLEVEL : int
     pyFATAL
 };
 
+// ------------------------------------------------------------------------------
+// call-sites registry:
+// a call-site (file, line, function) is registered once, and gets a small integer id.
+// The fast path receivelog_id() only carries that id: when the staging is started,
+// the strings are only resolved by the drainer thread, when the g3log message is built.
+
+// returns the id of the call-site (the same id if it was already registered)
+int registerCallSite(const char *file, int line, const char *function);
+
+void receivelog_id(int site_id, int level_val, std::string &&message);
+
+struct CallSite
+{
+    std::string file;
+    int line;
+    std::string function;
+};
+
+class CallSiteRegistry
+{
+public:
+    CallSiteRegistry();
+    CallSiteRegistry(const CallSiteRegistry&) = delete;
+    CallSiteRegistry &operator=(const CallSiteRegistry&) = delete;
+    
+    int add(const char *file, int line, const char *function); // lock + unlock of mutex
+    const CallSite &get(int id) const; // lock-free. throws if id was not returned by add()
+    
+    // held across fork() (see shmring.h): the child gets an unlocked registry
+    void lockAll() {_regLck.lock();};
+    void unlockAll() {_regLck.unlock();};
+    
+private:
+    static const int ChunkSize = 256;
+    static const int MaxChunks = 1024;
+    std::atomic<CallSite*> _chunks[MaxChunks];
+    std::atomic<int> _count; // number of call-sites published
+    
+    std::mutex _regLck; // for add()
+    std::map<std::tuple<std::string, int, std::string>, int> _ids;
+};
+
+CallSiteRegistry &callSites();
 
 // ------------------------------------------------------------------------------
 
+// Minimum level logged (a pyLEVEL value), shared by the python and C++ callers.
+// Messages below it are rejected before their arguments are converted, after a single atomic load.
+// It can be changed at runtime, from any thread.
+extern std::atomic<int> minLogLevel;
+
+void setMinLevel(int level_val); // throws if level_val is not a pyLEVEL
+int getMinLevel();
+
+// note: unknown levels are never rejected here (the unsigned comparison lets negative values through),
+// so that receivelog() can report them.
+inline bool levelEnabled(int level_val) 
+{
+return (unsigned)level_val >= (unsigned)minLogLevel.load(std::memory_order_relaxed);
+}
+
+
+// ------------------------------------------------------------------------------
+
+
+
+//
+// Fixed-size block pool for the data stored in ThdStore (entries, list nodes, strings).
+// The blocks are recycled through a free-list, and the pool never returns its memory:
+// it grows up to the peak usage, and then stays flat, without any allocator traffic.
+// Allocations bigger than a block are forwarded to the global operator new.
+//
+class FixedBlockPool
+{
+public:
+    static const size_t BlockSize = 256; // multiple of alignof(std::max_align_t)
+    static const size_t BlocksPerChunk = 64;
+    
+    FixedBlockPool() = default;
+    FixedBlockPool(const FixedBlockPool&) = delete;
+    FixedBlockPool &operator=(const FixedBlockPool&) = delete;
+    
+    void *allocate(size_t size); // lock + unlock of mutex
+    void deallocate(void *p, size_t size) noexcept; // lock + unlock of mutex
+    
+private:
+    struct FreeBlock {FreeBlock *next;};
+    std::mutex _lock;
+    FreeBlock *_free = nullptr;
+    std::vector<void*> _chunks;
+};
+
+// the pool used by the store. Never destroyed: the stored data may be released after the ThdStore.
+FixedBlockPool &storePool();
 
+// stateless allocator on storePool() (all instances are equal, as required by list::splice() )
+template<typename T>
+struct PoolAllocator
+{
+    typedef T value_type;
+    PoolAllocator() noexcept {};
+    template<typename U> PoolAllocator(const PoolAllocator<U>&) noexcept {};
+    T *allocate(size_t n) {return static_cast<T*>(storePool().allocate(n * sizeof(T)));};
+    void deallocate(T *p, size_t n) noexcept {storePool().deallocate(p, n * sizeof(T));};
+};
+template<typename T, typename U> bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) {return true;}
+template<typename T, typename U> bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) {return false;}
+
+typedef std::basic_string<char, std::char_traits<char>, PoolAllocator<char>> PoolString;
+
+// creates the data to store (object + shared_ptr control block in one pool block)
+template<typename T, typename... Args>
+std::shared_ptr<T> make_stored(Args&&... args)
+{
+return std::allocate_shared<T>(PoolAllocator<T>(), std::forward<Args>(args)...);
+}
 
 class StoredIface;
 //
@@ -33,30 +165,33 @@ class StoredIface;
 class ThdStore
 {
 public:
-   void store(std::shared_ptr<StoredIface>&& p_newData) {
-        std::lock_guard<std::mutex> lock(_ShdLstLck);
-        // TODO: check if memory barrier is inserted automatically
-        _SharedList.push_back(p_newData);
-      }
+   // the entry is freed once its sink call has completed (see StoredIface::finished()).
+   // The caller still holds the entry during store().
+   void store(std::shared_ptr<StoredIface>&& p_newData);
     
     ThdStore(): terminate_thd(false) {start_thread();};
     ~ThdStore() {sendTerm_n_join();};
     
+    size_t pending() const {return _pending.load(std::memory_order_relaxed);}; // stored, not freed yet
+    
 private:    
+  friend class StoredIface;
+  // called by the entry whose sink call has completed (on the sink's thread), wakes the cleanup-thread up
+  void completed(std::shared_ptr<StoredIface>&& p_entry);
       
-  // we make two lists: 
-  // - one list shared between threads, protected by a mutex.
-  // - one list that can only be accessed by the cleanup-thread
-  // taking elements from the shared list and inserting them in the cleanup-list is fast ( list::splice() )
-  // loops on the cleanup-list is slow (test of all the futures wait_for() )
-  std::mutex _ShdLstLck; // for _SharedList
-  std::list<std::shared_ptr<StoredIface>> _SharedList;
-  std::list<std::shared_ptr<StoredIface>> _CleanupList;
+  // the stored entries keep themselves alive until their sink call has completed:
+  // then they are pushed to the completed list, and the cleanup-thread frees them (out of the sink's thread).
+  // The cleanup-thread only sleeps on the condition variable, it never looks at the pending entries.
+  std::mutex _ShdLstLck; // for _CompletedList and terminate_thd
+  std::condition_variable _ShdLstCv; // signaled on completion and on termination
+  typedef std::list<std::shared_ptr<StoredIface>, PoolAllocator<std::shared_ptr<StoredIface>>> StoredList_t;
+  StoredList_t _CompletedList;
+  std::atomic<size_t> _pending{0};
  
   // for the cleanup-thread:
   void start_thread();
   void sendTerm_n_join(); // ask the cleanup thread to terminate and wait until he has finished.
-  std::atomic<bool> terminate_thd; // flag to pass the termination order to the thread
+  bool terminate_thd; // flag to pass the termination order to the thread (protected by _ShdLstLck)
   void ThdWorker();
   std::thread cleanupThd;
 };
@@ -69,9 +204,38 @@ class StoredIface
 {
 public:
    StoredIface() = default;
+   StoredIface(const StoredIface&) = delete;
+   virtual ~StoredIface(); // closes the completion eventfd
     
    // checks if the future is available
    virtual std::future_status has_finished() = 0;
+   
+   // blocks until the future is available
+   virtual void wait_finished() = 0;
+   
+   // completion signal, for event loops (asyncio):
+   // an eventfd, readable once the sink call has completed (created on first use).
+   // It is signaled by finished(), from the sink's thread: the future's value is set right after.
+   int completion_fd();
+   
+   // completion of the sink call: on the sink's thread (see CompletingCall),
+   // or by ThdStore::store() when the call will never run (removed sink). Only the first call counts.
+   void finished();
+   
+private:
+   friend class ThdStore;
+   void stored(ThdStore *store, std::shared_ptr<StoredIface>&& self);
+   void notify_done(); // signals the eventfd
+   
+   std::mutex _notifyLck;
+   bool _notified = false;
+   int _completionFd = -1;
+   
+   // stored() and finished() may come in any order: the second one hands the entry to the cleanup-thread
+   enum {Stored = 1, Finished = 2};
+   std::atomic<int> _state{0};
+   ThdStore *_store = nullptr;
+   std::shared_ptr<StoredIface> _self; // keeps the entry alive while its call is pending
 };
 
 // see the comment of "class ThdStore" for a description of the problematic.
@@ -84,7 +248,12 @@ class StoredForThd: public StoredIface
 {
 public:
     
-    std::future_status has_finished() { return _ThdFut.wait_for(std::chrono::seconds(0)); };
+    std::future_status has_finished() { return _ThdFut.valid() ? _ThdFut.wait_for(std::chrono::seconds(0)) : std::future_status::ready; }; // no future: the sink was removed
+    
+    void wait_finished() { if(_ThdFut.valid()) _ThdFut.wait(); };
+    
+    template<typename Rep, typename Period>
+    std::future_status wait_for(const std::chrono::duration<Rep, Period> &timeout) { return _ThdFut.wait_for(timeout); };
     
     delayed_t get() {return _ThdFut.get();}
     
@@ -95,17 +264,85 @@ private:
     std::shared_future<delayed_t> _ThdFut;
 };
 
+//
+// Wraps the sink method of a stored call. g3log runs it on the sink's thread:
+// once the method has returned (or thrown), the stored entry is finished().
+// usage: p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &Sink::method), args...));
+//
+template <typename Method>
+class CompletingCall
+{
+public:
+    CompletingCall(std::weak_ptr<StoredIface> stored, Method method): _stored(std::move(stored)), _method(method) {};
+    
+    // called by g3log with the pointer to the sink
+    template<typename Sink, typename... Args>
+    auto operator()(Sink *sink, Args&&... args) const -> decltype((sink ->* std::declval<Method>())(std::forward<Args>(args)...)) {
+        Completion done{_stored};
+        return (sink ->* _method)(std::forward<Args>(args)...);
+        };
+    
+    // only declared: g3log deduces the result type with std::result_of<Call(Sink, Args...)>
+    template<typename Sink, typename... Args>
+    auto operator()(Sink &&sink, Args&&... args) const -> decltype((sink .* std::declval<Method>())(std::forward<Args>(args)...));
+    
+private:
+    struct Completion {
+        const std::weak_ptr<StoredIface> &stored;
+        ~Completion() {if(auto p_entry = stored.lock()) p_entry -> finished();};
+    };
+    
+    // weak: the entry holds the future, which holds this call
+    std::weak_ptr<StoredIface> _stored;
+    Method _method;
+};
+
+template <typename Stored, typename Method>
+CompletingCall<Method> completing(const std::shared_ptr<Stored> &stored, Method method)
+{
+return CompletingCall<Method>(stored, method);
+}
+
+//
+// Result of a sink method call, returned to python.
+// It shares the stored data with the ThdStore, and resolves when the sink's thread has executed the call.
+//
+template <typename delayed_t>
+class SinkCallResult
+{
+public:
+    SinkCallResult(std::shared_ptr<StoredForThd<delayed_t>> stored): _stored(std::move(stored)) {};
+    
+    bool done() {return _stored -> has_finished() == std::future_status::ready;};
+    // timeout in seconds, < 0 : no timeout. Returns done().
+    bool wait(double timeout) {
+        if(timeout < 0) {
+            _stored -> wait_finished();
+            return true;
+            }
+        return _stored -> wait_for(std::chrono::duration<double>(timeout)) == std::future_status::ready;
+        };
+    // the value returned by the sink method (blocks until available). Rethrows the sink's exception.
+    delayed_t result() {return _stored -> get();};
+    int fileno() {return _stored -> completion_fd();};
+    
+private:
+    std::shared_ptr<StoredForThd<delayed_t>> _stored;
+};
+
 //
 // Helper class for the frequent case where 1 string must be stored
+// (the string storage also comes from the pool)
 //
 class Helper1StrStore: public StoredForThd<void>
 {
   public:
     Helper1StrStore() = delete;
-    Helper1StrStore(std::string init): Str(init) {};
+    Helper1StrStore(const char *init): Str(init) {};
+    Helper1StrStore(const std::string &init): Str(init.data(), init.size()) {};
     const char *c_str() {return Str.c_str();};
   private:
-    std::string Str;
+    PoolString Str;
 };
 
 } // g3
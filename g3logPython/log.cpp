@@ -1,29 +1,87 @@
 
 #include "intern_log.h"
 #include "g3logPython.h"
+#include "metrics.h"
+#include "pylog.h"
+#include "ratelimit.h"
+#include "shmring.h"
+#include "staging.h"
+
+#include <frameobject.h>
+
+#include <cstring>
+#include <vector>
+
+std::atomic<int> g3::minLogLevel{(int)g3::pyLEVEL::pyDEBUG};
+
+void g3::setMinLevel(int level_val)
+{
+if(level_val < (int)g3::pyLEVEL::pyDEBUG || level_val > (int)g3::pyLEVEL::pyFATAL) throw std::logic_error("setMinLevel: invalid level");
+minLogLevel.store(level_val, std::memory_order_relaxed);
+}
+
+int g3::getMinLevel()
+{
+return minLogLevel.load(std::memory_order_relaxed);
+}
+
+const LEVELS &g3::pyLevelToG3(int level_val)
+{
+switch(level_val) {
+    case (int)g3::pyLEVEL::pyDEBUG: return DEBUG;
+    case (int)g3::pyLEVEL::pyINFO: return INFO;
+    case (int)g3::pyLEVEL::pyWARNING: return WARNING;
+    case (int)g3::pyLEVEL::pyFATAL: return FATAL;
+    default: return WARNING;
+    }
+}
+
+// for the levels that can be staged (not FATAL, nor invalid)
+static inline bool regularLevel(int level_val)
+{
+return level_val >= (int)g3::pyLEVEL::pyDEBUG && level_val < (int)g3::pyLEVEL::pyFATAL;
+}
+
+// levelEnabled(), counting the rejected messages (see metrics.h)
+static inline bool levelAccepted(int level_val)
+{
+if(g3::levelEnabled(level_val)) return true;
+g3::captureMetrics().filtered.add();
+return false;
+}
 
 // level_val : enum pyLEVEL
 void g3::receivelog(const char *file, int line, const char* functionname, int level_val, const char *message)
 {
-    
+if(!levelAccepted(level_val)) return;
+if(!rateLimitAdmit(file, line, functionname, level_val)) return;
+
+if(regularLevel(level_val)) {
+    receivelog_str(file, line, functionname, level_val, std::string(message));
+    return;
+    }
+
 switch(level_val) {
-    case (int)g3::pyLEVEL::pyDEBUG: {
-        const LEVELS &level = DEBUG;
-        LogCapture(file, line, functionname, level).stream() << message;
-        break; }
-    case (int)g3::pyLEVEL::pyINFO: {
-        const LEVELS &level = INFO;
-        LogCapture(file, line, functionname, level).stream() << message;
-        break; }
-    case (int)g3::pyLEVEL::pyWARNING: {
-        const LEVELS &level = WARNING;
-        LogCapture(file, line, functionname, level).stream() << message;
-        break; }
     case (int)g3::pyLEVEL::pyFATAL: {
+        captureMetrics().captured[level_val].add();
+        if(sharedRing().attached()) { // no LogWorker in this child: its parent logs the message, and the child aborts
+            sharedRing().push(StagedLog(file, functionname, std::string(message), line, level_val));
+            std::abort();
+            }
+        stagingRing().drain(); // don't lose the messages preceding the crash
+        ifaceLogWorker::dumpFlightRecorders(); // while the sinks they dump to are still running
+        captureMetrics().sent.add();
         const LEVELS &level = FATAL;
         LogCapture(file, line, functionname, level).stream() << message;
         break; }
     default: {
+        captureMetrics().captured[CaptureMetrics::NumLevels].add();
+        if(sharedRing().attached()) {
+            sharedRing().push(StagedLog(file, functionname, "invalid level " + std::to_string(level_val), line, (int)g3::pyLEVEL::pyWARNING));
+            sharedRing().push(StagedLog(file, functionname, std::string(message), line, (int)g3::pyLEVEL::pyWARNING));
+            break;
+            }
+        captureMetrics().sent.add(2);
         const LEVELS &level = WARNING;
         LogCapture(file, line, functionname, level).stream() << "invalid level " << level_val;
         LogCapture(file, line, functionname, level).stream() << message;
@@ -31,3 +89,629 @@ switch(level_val) {
     }
 }
 
+// the message is moved into the LogMessage (directly, or through the staging ring):
+// it is not copied again, whatever its size.
+void g3::receivelog_str(const char *file, int line, const char* functionname, int level_val, std::string &&message)
+{
+if(!levelAccepted(level_val)) return;
+
+if(!regularLevel(level_val)) {
+    receivelog(file, line, functionname, level_val, message.c_str());
+    return;
+    }
+
+stageOrPush(StagedLog(file, functionname, std::move(message), line, level_val));
+}
+
+void g3::receivelog_fmt(const char *file, int line, const char* functionname, int level_val, std::string &&fmt, std::vector<LogValue> &&args)
+{
+if(!levelAccepted(level_val)) return; // nothing gets formatted
+
+if(!regularLevel(level_val)) {
+    receivelog(file, line, functionname, level_val, formatDeferred(fmt, args).c_str());
+    return;
+    }
+
+StagedLog rec(file, functionname, std::move(fmt), line, level_val);
+rec.args = std::move(args);
+stageOrPush(std::move(rec));
+}
+
+void g3::receivelog_kv(const char *file, int line, const char* functionname, int level_val, std::string &&fmt, std::vector<LogValue> &&args, std::vector<LogField> &&fields)
+{
+if(!levelAccepted(level_val)) return;
+
+if(!regularLevel(level_val)) { // not staged: rendered now, as text
+    std::string text = args.empty() ? std::move(fmt) : formatDeferred(fmt, args);
+    receivelog(file, line, functionname, level_val, renderMessage(text, fields, FieldFormat::TEXT).c_str());
+    return;
+    }
+
+StagedLog rec(file, functionname, std::move(fmt), line, level_val);
+rec.args = std::move(args);
+rec.fields = std::move(fields);
+stageOrPush(std::move(rec));
+}
+
+void g3::receivelog_id(int site_id, int level_val, std::string &&message)
+{
+if(!levelAccepted(level_val)) return;
+
+const CallSite &site = callSites().get(site_id); // also validates the id
+if(!regularLevel(level_val)) {
+    receivelog(site.file.c_str(), site.line, site.function.c_str(), level_val, message.c_str());
+    return;
+    }
+
+StagedLog rec(std::string(), std::string(), std::move(message), 0, level_val);
+rec.site_id = site_id;
+stageOrPush(std::move(rec));
+}
+
+namespace {
+
+// keeps a python object alive, together with its UTF-8 representation
+// (the UTF-8 buffer of a str is cached by CPython, so no copy is made here)
+class Utf8View
+{
+public:
+    Utf8View(PyObject *obj) {
+        if(!PyUnicode_Check(obj)) {
+            _owned = PyObject_Str(obj); // new reference
+            obj = _owned;
+            }
+        if(obj != NULL) _utf8 = PyUnicode_AsUTF8AndSize(obj, &_size);
+        if(_utf8 == NULL) {
+            PyErr_Clear();
+            _utf8 = "<g3logPython: unprintable message>";
+            _size = strlen(_utf8);
+            }
+        };
+    ~Utf8View() { Py_XDECREF(_owned); };
+    Utf8View(const Utf8View&) = delete;
+    Utf8View &operator=(const Utf8View&) = delete;
+    const char *c_str() const {return _utf8;};
+    size_t size() const {return (size_t)_size;};
+private:
+    PyObject *_owned = NULL;
+    const char *_utf8 = NULL;
+    Py_ssize_t _size = 0;
+};
+
+// view on the bytes of a message, without copy:
+//  - str: its UTF-8 representation (cached by CPython in the str object)
+//  - bytes, bytearray, and other objects providing a contiguous buffer: the raw bytes
+//  - other objects: the UTF-8 of str(obj)
+class MessageView
+{
+public:
+    MessageView(PyObject *obj) {
+        if(PyUnicode_Check(obj)) {
+            _data = PyUnicode_AsUTF8AndSize(obj, &_size);
+        } else if(PyBytes_Check(obj)) {
+            _data = PyBytes_AS_STRING(obj);
+            _size = PyBytes_GET_SIZE(obj);
+        } else if(PyObject_CheckBuffer(obj)) {
+            if(PyObject_GetBuffer(obj, &_buf, PyBUF_SIMPLE) == 0) {
+                _hasBuf = true;
+                _data = (const char *)_buf.buf;
+                _size = _buf.len;
+                }
+        } else {
+            _owned = PyObject_Str(obj); // new reference
+            if(_owned != NULL) _data = PyUnicode_AsUTF8AndSize(_owned, &_size);
+        }
+        if(_data == NULL) {
+            PyErr_Clear();
+            _data = "<g3logPython: unprintable message>";
+            _size = strlen(_data);
+            }
+        };
+    ~MessageView() {
+        if(_hasBuf) PyBuffer_Release(&_buf);
+        Py_XDECREF(_owned);
+        };
+    MessageView(const MessageView&) = delete;
+    MessageView &operator=(const MessageView&) = delete;
+    
+    // the only copy of the message
+    std::string str() const {return std::string(_data, (size_t)_size);};
+private:
+    PyObject *_owned = NULL;
+    Py_buffer _buf;
+    bool _hasBuf = false;
+    const char *_data = NULL;
+    Py_ssize_t _size = 0;
+};
+
+// UTF-8 of a str attribute of a code object (co_filename, co_name)
+const char *codeStr(PyObject *str)
+{
+const char *utf8 = (str != NULL) ? PyUnicode_AsUTF8(str) : NULL;
+if(utf8 == NULL) {
+    PyErr_Clear();
+    return "?";
+    }
+return utf8;
+}
+
+// call-site of the python code calling the extension.
+// only the top frame is read: no frame list is built, and no source file is opened.
+class CallerSite
+{
+public:
+    CallerSite() {
+        PyFrameObject *frame = PyEval_GetFrame(); // borrowed reference
+        if(frame == NULL) return; // called from C, without any python frame
+#if PY_VERSION_HEX >= 0x030900B1
+        _code = PyFrame_GetCode(frame); // new reference
+#else
+        _code = frame -> f_code;
+        Py_INCREF(_code);
+#endif
+        file = codeStr(_code -> co_filename);
+        function = codeStr(_code -> co_name);
+        line = PyFrame_GetLineNumber(frame);
+        };
+    ~CallerSite() { Py_XDECREF(_code); }; // the strings above belong to the code object
+    CallerSite(const CallerSite&) = delete;
+    CallerSite &operator=(const CallerSite&) = delete;
+    
+    const char *file = "<python>";
+    const char *function = "<unknown>";
+    int line = 0;
+private:
+    PyCodeObject *_code = NULL;
+};
+
+long toLong(PyObject *obj, const char *what)
+{
+long val = PyLong_AsLong(obj);
+if(val == -1 && PyErr_Occurred()) {
+    PyErr_Clear();
+    throw pybind11::type_error(std::string("receivelog_batch: ") + what + " must be an int");
+    }
+return val;
+}
+
+// captures the arguments of a deferred message, by value.
+// str, int, float and bool are copied as such. The other objects are converted on the caller's thread,
+// as this needs the GIL: with str() or repr() as requested by their directive, or to a number for the numeric directives.
+// returns false if the template uses mapping keys ( %(name)s ): it must then be formatted by python.
+bool captureArgs(const std::string &fmt, PyObject *args, std::vector<g3::LogValue> &out)
+{
+std::string convs = g3::fmtConversions(fmt);
+if(convs.find_first_of("(*") != std::string::npos) return false; // formatted now, by python
+
+Py_ssize_t count = PyTuple_GET_SIZE(args);
+out.reserve(count);
+for(Py_ssize_t i = 0; i < count; i++) {
+    PyObject *arg = PyTuple_GET_ITEM(args, i);
+    char conv = ((size_t)i < convs.size()) ? convs[i] : 's';
+    bool wantRepr = (conv == 'r' || conv == 'a');
+    
+    if(PyBool_Check(arg)) {
+        out.push_back(g3::LogValue::from_bool(arg == Py_True));
+        continue;
+        }
+    if(PyLong_Check(arg)) {
+        int overflow = 0;
+        long long val = PyLong_AsLongLongAndOverflow(arg, &overflow);
+        if(overflow == 0 && !(val == -1 && PyErr_Occurred())) {
+            out.push_back(g3::LogValue::from_int(val));
+            continue;
+            }
+        PyErr_Clear(); // too big: kept as text
+        }
+    else if(PyFloat_Check(arg)) {
+        out.push_back(g3::LogValue::from_double(PyFloat_AS_DOUBLE(arg)));
+        continue;
+        }
+    else if(PyUnicode_Check(arg) && !wantRepr) {
+        out.push_back(g3::LogValue::from_str(MessageView(arg).str()));
+        continue;
+        }
+    else if(std::string("diuoxXc").find(conv) != std::string::npos && conv != 'c') {
+        PyObject *num = PyNumber_Long(arg); // new reference
+        if(num != NULL) {
+            long long val = PyLong_AsLongLong(num);
+            Py_DECREF(num);
+            if(!(val == -1 && PyErr_Occurred())) {
+                out.push_back(g3::LogValue::from_int(val));
+                continue;
+                }
+            }
+        PyErr_Clear();
+        }
+    else if(std::string("eEfFgG").find(conv) != std::string::npos) {
+        double val = PyFloat_AsDouble(arg);
+        if(!(val == -1.0 && PyErr_Occurred())) {
+            out.push_back(g3::LogValue::from_double(val));
+            continue;
+            }
+        PyErr_Clear();
+        }
+    
+    PyObject *text = wantRepr ? PyObject_Repr(arg) : PyObject_Str(arg); // new reference
+    if(text == NULL) {
+        PyErr_Clear();
+        out.push_back(g3::LogValue::from_str("<g3logPython: unprintable argument>"));
+        continue;
+        }
+    out.push_back(g3::LogValue::from_str(MessageView(text).str()));
+    Py_DECREF(text);
+  }
+return true;
+}
+
+// captures the structured fields ( **kwargs ), by value: as captureArgs() for the %s directive
+void captureFields(PyObject *kwargs, std::vector<g3::LogField> &out)
+{
+out.reserve(PyDict_Size(kwargs));
+PyObject *key, *val;
+Py_ssize_t pos = 0;
+while(PyDict_Next(kwargs, &pos, &key, &val)) {
+    g3::LogField field;
+    field.key = MessageView(key).str();
+    if(PyBool_Check(val)) {
+        field.value = g3::LogValue::from_bool(val == Py_True);
+    } else if(PyLong_Check(val)) {
+        int overflow = 0;
+        long long num = PyLong_AsLongLongAndOverflow(val, &overflow);
+        if(overflow == 0 && !(num == -1 && PyErr_Occurred())) field.value = g3::LogValue::from_int(num);
+        else {
+            PyErr_Clear(); // too big: kept as text
+            field.value = g3::LogValue::from_str(MessageView(val).str());
+        }
+    } else if(PyFloat_Check(val)) {
+        field.value = g3::LogValue::from_double(PyFloat_AS_DOUBLE(val));
+    } else {
+        field.value = g3::LogValue::from_str(MessageView(val).str());
+    }
+    out.push_back(std::move(field));
+  }
+}
+
+// python's "fmt % args" (as in python's logging: a single mapping argument is used directly)
+std::string formatNow(PyObject *fmt, PyObject *args)
+{
+PyObject *fmtStr = PyUnicode_Check(fmt) ? (Py_INCREF(fmt), fmt) : PyObject_Str(fmt); // new reference
+if(fmtStr == NULL) {
+    PyErr_Clear();
+    return "<g3logPython: unprintable message>";
+    }
+PyObject *values = args;
+if(PyTuple_GET_SIZE(args) == 1 && PyMapping_Check(PyTuple_GET_ITEM(args, 0)) && !PyUnicode_Check(PyTuple_GET_ITEM(args, 0))) 
+    values = PyTuple_GET_ITEM(args, 0);
+
+PyObject *formatted = PyUnicode_Format(fmtStr, values); // new reference
+std::string out;
+if(formatted == NULL) {
+    PyErr_Clear();
+    out = MessageView(fmtStr).str() + " [g3logPython format error]";
+} else {
+    out = MessageView(formatted).str();
+    Py_DECREF(formatted);
+}
+Py_DECREF(fmtStr);
+return out;
+}
+
+} // anonymous namespace
+
+void g3::receivelog_caller(int level_val, pybind11::handle message, pybind11::handle args, pybind11::handle kwargs)
+{
+if(!levelAccepted(level_val)) return; // before any conversion of the message, or of the arguments
+
+CallerSite site;
+if(!rateLimitAdmit(site.file, site.line, site.function, level_val)) return;
+MessageView msg(message.ptr());
+
+std::vector<LogField> fields;
+if(kwargs && PyDict_Check(kwargs.ptr()) && PyDict_Size(kwargs.ptr()) > 0) captureFields(kwargs.ptr(), fields);
+
+if(!args || !PyTuple_Check(args.ptr()) || PyTuple_GET_SIZE(args.ptr()) == 0) {
+    if(fields.empty()) receivelog_str(site.file, site.line, site.function, level_val, msg.str());
+    else receivelog_kv(site.file, site.line, site.function, level_val, msg.str(), std::vector<LogValue>(), std::move(fields));
+    return;
+    }
+
+std::string fmt = msg.str();
+std::vector<LogValue> values;
+if(captureArgs(fmt, args.ptr(), values)) receivelog_kv(site.file, site.line, site.function, level_val, std::move(fmt), std::move(values), std::move(fields));
+else receivelog_kv(site.file, site.line, site.function, level_val, formatNow(message.ptr(), args.ptr()), std::vector<LogValue>(), std::move(fields));
+}
+
+void g3::receivelog_obj(pybind11::handle file, int line, pybind11::handle functionname, int level_val, pybind11::handle message, pybind11::handle kwargs)
+{
+if(!levelAccepted(level_val)) return;
+
+Utf8View fileStr(file.ptr()), funcStr(functionname.ptr());
+if(!rateLimitAdmit(fileStr.c_str(), line, funcStr.c_str(), level_val)) return;
+MessageView msg(message.ptr());
+if(kwargs && PyDict_Check(kwargs.ptr()) && PyDict_Size(kwargs.ptr()) > 0) {
+    std::vector<LogField> fields;
+    captureFields(kwargs.ptr(), fields);
+    receivelog_kv(fileStr.c_str(), line, funcStr.c_str(), level_val, msg.str(), std::vector<LogValue>(), std::move(fields));
+    return;
+    }
+receivelog_str(fileStr.c_str(), line, funcStr.c_str(), level_val, msg.str());
+}
+
+g3::LogContext g3::context_obj(pybind11::kwargs kwargs)
+{
+std::vector<LogField> fields;
+if(kwargs && PyDict_Size(kwargs.ptr()) > 0) captureFields(kwargs.ptr(), fields);
+return LogContext(std::move(fields));
+}
+
+// the records are converted in one pass with the GIL held, then sent to g3log with the GIL released.
+// A malformed record raises TypeError, once the records preceding it are sent.
+void g3::receivelog_batch(pybind11::handle records)
+{
+PyObject *seq = PySequence_Fast(records.ptr(), "receivelog_batch: a sequence of tuples is expected"); // new reference
+if(seq == NULL) throw pybind11::error_already_set();
+pybind11::object seqRef = pybind11::reinterpret_steal<pybind11::object>(seq);
+
+Py_ssize_t count = PySequence_Fast_GET_SIZE(seq);
+PyObject **items = PySequence_Fast_ITEMS(seq);
+
+std::unique_ptr<CallerSite> site; // read once, only if a (level, message) tuple is found
+CaptureTime now = captureNow(); // one clock read for the batch
+std::thread::id thd = std::this_thread::get_id();
+std::shared_ptr<const ContextBlock> context = currentContext(); // with the GIL: the python context is visible
+
+std::vector<StagedLog> batch;
+batch.reserve(count);
+
+try {
+    for(Py_ssize_t i = 0; i < count; i++) {
+        PyObject *item = items[i];
+        if(!PyTuple_Check(item) || (PyTuple_GET_SIZE(item) != 2 && PyTuple_GET_SIZE(item) != 5)) 
+            throw pybind11::type_error("receivelog_batch: (level, message) or (file, line, function, level, message) tuples expected");
+        
+        bool full = (PyTuple_GET_SIZE(item) == 5);
+        int level_val = (int)toLong(PyTuple_GET_ITEM(item, full ? 3 : 0), "level");
+        if(!levelAccepted(level_val)) continue;
+        
+        MessageView msg(PyTuple_GET_ITEM(item, full ? 4 : 1));
+        
+        if(level_val < (int)g3::pyLEVEL::pyDEBUG || level_val >= (int)g3::pyLEVEL::pyFATAL) {
+            // FATAL or invalid level: send what precedes, then use the regular path
+            for(auto &rec: batch) stageOrPush(std::move(rec));
+            batch.clear();
+            if(full) {
+                Utf8View file(PyTuple_GET_ITEM(item, 0)), function(PyTuple_GET_ITEM(item, 2));
+                receivelog(file.c_str(), (int)toLong(PyTuple_GET_ITEM(item, 1), "line"), function.c_str(), level_val, msg.str().c_str());
+            } else {
+                if(!site) site.reset(new CallerSite());
+                receivelog(site -> file, site -> line, site -> function, level_val, msg.str().c_str());
+            }
+            continue;
+            }
+        
+        if(full) {
+            Utf8View file(PyTuple_GET_ITEM(item, 0)), function(PyTuple_GET_ITEM(item, 2));
+            int line = (int)toLong(PyTuple_GET_ITEM(item, 1), "line");
+            if(!rateLimitAdmit(file.c_str(), line, function.c_str(), level_val)) continue;
+            batch.emplace_back(std::string(file.c_str(), file.size()), std::string(function.c_str(), function.size()), 
+                               msg.str(), line, level_val, now, thd);
+            batch.back().context = context;
+        } else {
+            if(!site) site.reset(new CallerSite());
+            if(!rateLimitAdmit(site -> file, site -> line, site -> function, level_val)) continue;
+            batch.emplace_back(site -> file, site -> function, msg.str(), site -> line, level_val, now, thd);
+            batch.back().context = context;
+        }
+      }
+  } catch(...) { // the records converted before the error are logged, then the error is raised
+    pybind11::gil_scoped_release nogil;
+    for(auto &rec: batch) stageOrPush(std::move(rec));
+    throw;
+  }
+
+pybind11::gil_scoped_release nogil;
+for(auto &rec: batch) stageOrPush(std::move(rec));
+}
+
+void g3::receivelog_id_obj(int site_id, int level_val, pybind11::handle message)
+{
+if(!levelAccepted(level_val)) return;
+
+if(rateLimiter().active()) {
+    const CallSite &site = callSites().get(site_id);
+    if(!rateLimitAdmit(site.file.c_str(), site.line, site.function.c_str(), level_val)) return;
+    }
+MessageView msg(message.ptr());
+receivelog_id(site_id, level_val, msg.str());
+}
+
+int g3::registerCallerSite()
+{
+CallerSite site;
+return registerCallSite(site.file, site.line, site.function);
+}
+
+namespace {
+
+// attribute names of the LogRecords and of the handler, interned once
+struct RecordNames
+{
+    PyObject *levelno = PyUnicode_InternFromString("levelno");
+    PyObject *levelname = PyUnicode_InternFromString("levelname");
+    PyObject *pathname = PyUnicode_InternFromString("pathname");
+    PyObject *lineno = PyUnicode_InternFromString("lineno");
+    PyObject *funcName = PyUnicode_InternFromString("funcName");
+    PyObject *name = PyUnicode_InternFromString("name");
+    PyObject *msg = PyUnicode_InternFromString("msg");
+    PyObject *args = PyUnicode_InternFromString("args");
+    PyObject *created = PyUnicode_InternFromString("created");
+    PyObject *exc_info = PyUnicode_InternFromString("exc_info");
+    PyObject *exc_text = PyUnicode_InternFromString("exc_text");
+    PyObject *stack_info = PyUnicode_InternFromString("stack_info");
+    PyObject *formatter = PyUnicode_InternFromString("formatter");
+    PyObject *filters = PyUnicode_InternFromString("filters");
+    PyObject *logger_field = PyUnicode_InternFromString("logger_field");
+};
+
+const RecordNames &recordNames()
+{
+static RecordNames *names = new RecordNames(); // never destroyed, as the interned strings
+return *names;
+}
+
+// obj.name, or a null object (no exception) if it is missing
+pybind11::object attrOf(PyObject *obj, PyObject *name)
+{
+PyObject *val = PyObject_GetAttr(obj, name); // new reference
+if(val == NULL) PyErr_Clear();
+return pybind11::reinterpret_steal<pybind11::object>(val);
+}
+
+long longAttr(PyObject *obj, PyObject *name, long def)
+{
+pybind11::object val = attrOf(obj, name);
+if(!val) return def;
+long num = PyLong_AsLong(val.ptr());
+if(num == -1 && PyErr_Occurred()) {
+    PyErr_Clear();
+    return def;
+    }
+return num;
+}
+
+bool trueAttr(PyObject *obj, PyObject *name)
+{
+pybind11::object val = attrOf(obj, name);
+if(!val) return false;
+int res = PyObject_IsTrue(val.ptr());
+if(res < 0) PyErr_Clear();
+return res > 0;
+}
+
+int loggingLevel(long levelno)
+{
+if(levelno < 20) return (int)g3::pyLEVEL::pyDEBUG; // logging.INFO
+if(levelno < 30) return (int)g3::pyLEVEL::pyINFO; // logging.WARNING
+return (int)g3::pyLEVEL::pyWARNING;
+}
+
+// "\n" + traceback of the record (as logging.Formatter.format() appends it), or an empty string.
+// The text of exc_info is cached in record.exc_text, for the other handlers.
+std::string recordTraceback(PyObject *rec)
+{
+const RecordNames &names = recordNames();
+std::string out;
+if(trueAttr(rec, names.exc_info)) {
+    if(!trueAttr(rec, names.exc_text)) {
+        pybind11::object logging = pybind11::reinterpret_steal<pybind11::object>(PyImport_ImportModule("logging"));
+        if(!logging) throw pybind11::error_already_set();
+        pybind11::object formatter = logging.attr("_defaultFormatter");
+        pybind11::object text = formatter.attr("formatException")(attrOf(rec, names.exc_info));
+        if(PyObject_SetAttr(rec, names.exc_text, text.ptr()) != 0) throw pybind11::error_already_set();
+        }
+    out += "\n";
+    out += MessageView(attrOf(rec, names.exc_text).ptr()).str();
+    }
+if(trueAttr(rec, names.stack_info)) {
+    out += "\n";
+    out += MessageView(attrOf(rec, names.stack_info).ptr()).str();
+    }
+return out;
+}
+
+} // anonymous namespace
+
+void g3::receivelog_record(pybind11::handle handler, pybind11::handle record)
+{
+const RecordNames &names = recordNames();
+PyObject *rec = record.ptr();
+long levelno = longAttr(rec, names.levelno, 0);
+int level_val = loggingLevel(levelno);
+if(!levelAccepted(level_val)) return; // before any conversion
+
+pybind11::object pathname = attrOf(rec, names.pathname), funcName = attrOf(rec, names.funcName);
+Utf8View file(pathname ? pathname.ptr() : Py_None), function(funcName ? funcName.ptr() : Py_None);
+int line = (int)longAttr(rec, names.lineno, 0);
+if(!rateLimitAdmit(file.c_str(), line, function.c_str(), level_val)) return;
+
+std::string message;
+std::vector<LogValue> values;
+pybind11::object formatter = attrOf(handler.ptr(), names.formatter);
+if(formatter && !formatter.is_none()) {
+    // the handler's formatter gives the whole message (traceback included)
+    message = MessageView(handler.attr("format")(record).ptr()).str();
+} else {
+    pybind11::object msg = attrOf(rec, names.msg), args = attrOf(rec, names.args);
+    if(!msg) msg = pybind11::reinterpret_borrow<pybind11::object>(Py_None);
+    std::string traceback = recordTraceback(rec);
+    bool hasArgs = args && PyObject_IsTrue(args.ptr()) > 0;
+    if(!hasArgs) {
+        message = MessageView(msg.ptr()).str();
+    } else if(PyTuple_Check(args.ptr())) {
+        message = MessageView(msg.ptr()).str();
+        // with a traceback, the message must be formatted now: the traceback is not part of the template
+        if(!traceback.empty() || !captureArgs(message, args.ptr(), values)) {
+            values.clear();
+            message = formatNow(msg.ptr(), args.ptr());
+            }
+    } else { // a single mapping argument (logging unpacks it from the tuple)
+        pybind11::object single = pybind11::reinterpret_steal<pybind11::object>(PyTuple_Pack(1, args.ptr()));
+        if(!single) throw pybind11::error_already_set();
+        message = formatNow(msg.ptr(), single.ptr());
+    }
+    message += traceback;
+}
+
+std::vector<LogField> fields;
+pybind11::object loggerField = attrOf(handler.ptr(), names.logger_field);
+if(!loggerField || PyObject_IsTrue(loggerField.ptr()) > 0) {
+    pybind11::object name = attrOf(rec, names.name);
+    if(name) fields.push_back(LogField{"logger", LogValue::from_str(MessageView(name.ptr()).str())});
+    }
+if(levelno != 10 && levelno != 20 && levelno != 30) { // not a level of g3log
+    pybind11::object levelname = attrOf(rec, names.levelname);
+    if(levelname) fields.push_back(LogField{"levelname", LogValue::from_str(MessageView(levelname.ptr()).str())});
+    }
+
+// the time of the record (it may have waited in a logging.handlers.QueueHandler)
+pybind11::object created = attrOf(rec, names.created);
+CaptureTime stamp = (created && PyFloat_Check(created.ptr())) ? 
+    CaptureTime(stamp_t(std::chrono::duration_cast<stamp_t::duration>(std::chrono::duration<double>(PyFloat_AS_DOUBLE(created.ptr()))))) : captureNow();
+
+StagedLog staged(std::string(file.c_str(), file.size()), std::string(function.c_str(), function.size()), std::move(message), line, level_val, 
+                 stamp, std::this_thread::get_id());
+staged.args = std::move(values);
+staged.fields = std::move(fields);
+stageOrPush(std::move(staged));
+}
+
+pybind11::object g3::handleLogRecord(pybind11::handle handler, pybind11::handle record)
+{
+pybind11::object rv = pybind11::reinterpret_borrow<pybind11::object>(Py_True);
+pybind11::object filters = attrOf(handler.ptr(), recordNames().filters);
+if(filters && PyList_Check(filters.ptr()) && PyList_GET_SIZE(filters.ptr()) > 0) {
+    rv = handler.attr("filter")(record);
+    int keep = PyObject_IsTrue(rv.ptr());
+    if(keep < 0) throw pybind11::error_already_set();
+    if(keep == 0) return rv;
+    if(!PyBool_Check(rv.ptr())) record = rv; // python >= 3.12: a filter may return a replacement record
+    }
+
+try {
+    receivelog_record(handler, record);
+} catch(pybind11::error_already_set &err) {
+    // as logging.Handler.emit(): handleError() reports the error being handled (sys.exc_info() ), and the program goes on
+    err.restore();
+    PyObject *type, *value, *tb, *prevType, *prevValue, *prevTb;
+    PyErr_Fetch(&type, &value, &tb);
+    PyErr_NormalizeException(&type, &value, &tb);
+    PyErr_GetExcInfo(&prevType, &prevValue, &prevTb);
+    PyErr_SetExcInfo(type, value, tb); // steals the references
+    PyObject *res = PyObject_CallMethod(handler.ptr(), "handleError", "O", record.ptr());
+    Py_XDECREF(res);
+    PyErr_Clear();
+    PyErr_SetExcInfo(prevType, prevValue, prevTb);
+}
+return rv;
+}
@@ -0,0 +1,75 @@
+//
+//  runtime metrics: see metrics.h
+//
+
+#include "metrics.h"
+
+namespace g3 {
+
+CaptureMetrics &captureMetrics()
+{
+static CaptureMetrics *metrics = new CaptureMetrics();
+return *metrics;
+}
+
+int ShardedCounter::shardIndex()
+{
+static std::atomic<int> nextIndex{0};
+thread_local int index = nextIndex.fetch_add(1, std::memory_order_relaxed) % NumShards;
+return index;
+}
+
+uint64_t ShardedCounter::sum() const
+{
+uint64_t total = 0;
+for(auto &shard: _shards) total += shard.val.load(std::memory_order_relaxed);
+return total;
+}
+
+uint64_t LatencyHistogram::boundNs(int bucket)
+{
+return (bucket >= NumBuckets - 1) ? UINT64_MAX : (1000ULL << bucket);
+}
+
+void LatencyHistogram::record(uint64_t ns)
+{
+int bucket = 0;
+while(bucket < NumBuckets - 1 && ns > boundNs(bucket)) bucket++;
+// single writer: no read-modify-write needed
+_buckets[bucket].store(_buckets[bucket].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+_sumNs.store(_sumNs.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+_count.store(_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+std::vector<uint64_t> LatencyHistogram::cumulative() const
+{
+std::vector<uint64_t> out(NumBuckets);
+uint64_t total = 0;
+for(int i = 0; i < NumBuckets; i++) {
+    total += _buckets[i].load(std::memory_order_relaxed);
+    out[i] = total;
+    }
+return out;
+}
+
+void SinkMetrics::delivered(std::chrono::steady_clock::time_point start)
+{
+auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+latency.record(ns > 0 ? ns : 0);
+uint64_t count = messages.load(std::memory_order_relaxed) + 1;
+messages.store(count, std::memory_order_relaxed);
+
+if((count & 63) == 1) { // the depth costs a sum of the shards: sampled
+    uint64_t depth = queueDepth();
+    if(depth > queueHighWater.load(std::memory_order_relaxed)) queueHighWater.store(depth, std::memory_order_relaxed);
+    }
+}
+
+uint64_t SinkMetrics::queueDepth() const
+{
+uint64_t sent = captureMetrics().sent.sum() - sentAtStart;
+uint64_t done = messages.load(std::memory_order_relaxed) + filtered.load(std::memory_order_relaxed);
+return (sent > done) ? sent - done : 0;
+}
+
+} // g3
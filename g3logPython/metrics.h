@@ -0,0 +1,135 @@
+/*
+
+  Runtime metrics of the logger, read with ifaceLogWorker::stats().
+
+  Capture side (any thread): sharded counters, each thread increments its own cache line,
+  the shards are only summed when the stats are read.
+  Sink side: each sink's dispatcher (see dispatch.h) counts and times the messages it delivers,
+  on the sink's thread (single writer, no contention).
+
+  The depth of a sink's queue is estimated as: messages sent to the LogWorker since the sink was added,
+  minus the messages the sink has processed. Its high-water mark is sampled every few messages.
+
+*/
+
+#pragma once
+
+#include "overflow.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace g3 {
+
+class ShardedCounter
+{
+public:
+    static const int NumShards = 16;
+    
+    ShardedCounter() = default;
+    ShardedCounter(const ShardedCounter&) = delete;
+    ShardedCounter &operator=(const ShardedCounter&) = delete;
+    
+    void add(uint64_t n = 1) {_shards[shardIndex()].val.fetch_add(n, std::memory_order_relaxed);};
+    uint64_t sum() const;
+    
+private:
+    static int shardIndex(); // index of the calling thread, given on its first call
+    struct Shard {
+        std::atomic<uint64_t> val{0};
+        char pad[64 - sizeof(std::atomic<uint64_t>)];
+    };
+    Shard _shards[NumShards];
+};
+
+// counters of the capture path
+struct CaptureMetrics
+{
+    static const int NumLevels = 4; // pyLEVEL values
+    ShardedCounter captured[NumLevels + 1]; // messages accepted, per pyLEVEL. [NumLevels]: invalid levels
+    ShardedCounter filtered; // below the minimum level
+    ShardedCounter sent; // LogMessages sent to the LogWorker
+};
+
+// never destroyed: used until the very end of the process
+CaptureMetrics &captureMetrics();
+
+// processing time of the messages by a sink, in log2 buckets: 1 us, 2 us, ... and +Inf
+class LatencyHistogram
+{
+public:
+    static const int NumBuckets = 24;
+    static uint64_t boundNs(int bucket); // upper bound of a bucket (UINT64_MAX for the last one)
+    
+    void record(uint64_t ns); // single writer
+    
+    uint64_t count() const {return _count.load(std::memory_order_relaxed);};
+    uint64_t sumNs() const {return _sumNs.load(std::memory_order_relaxed);};
+    std::vector<uint64_t> cumulative() const; // count of the messages <= each bound
+    
+private:
+    std::atomic<uint64_t> _buckets[NumBuckets] = {};
+    std::atomic<uint64_t> _count{0};
+    std::atomic<uint64_t> _sumNs{0};
+};
+
+// metrics of one sink, written by its dispatcher
+struct SinkMetrics
+{
+    void delivered(std::chrono::steady_clock::time_point start); // after each regular message
+    void skipped() {filtered.store(filtered.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);}; // rejected by the sink's filters
+    void sharedLine() {sharedLines.store(sharedLines.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);}; // rendered by another sink
+    uint64_t queueDepth() const;
+    
+    uint64_t sentAtStart = 0; // captureMetrics().sent when the sink was added
+    std::atomic<uint64_t> messages{0};
+    std::atomic<uint64_t> filtered{0};
+    std::atomic<uint64_t> sharedLines{0};
+    std::atomic<uint64_t> queueHighWater{0};
+    LatencyHistogram latency;
+};
+
+struct SinkStats
+{
+    std::string type; // "syslog", "logrotate", "colorterm", "binary", "journald", "net", "plugin", "flightrec"
+    std::string name;
+    uint64_t messages;
+    uint64_t filtered; // rejected by the sink's filters (level, file prefixes)
+    uint64_t sharedLines; // lines rendered by another sink (see render.h)
+    uint64_t queueDepth;
+    uint64_t queueHighWater;
+    uint64_t latencyCount;
+    uint64_t latencySumNs;
+    std::vector<uint64_t> latencyBuckets; // cumulative, bounds: LatencyHistogram::boundNs()
+};
+
+// shared ring of the multi-process deployments (see shmring.h)
+struct SharedRingStats
+{
+    bool parent = false; // the ring was started by this process
+    bool attached = false; // this process is a child writing into the ring
+    uint64_t received = 0; // records read by the parent
+    uint64_t dropped = 0;  // records dropped by the children (ring full, or record larger than the ring)
+    uint64_t used = 0; // bytes in the ring
+    uint64_t capacity = 0;
+};
+
+struct LoggerStats
+{
+    std::vector<uint64_t> captured; // per pyLEVEL
+    uint64_t capturedInvalid;
+    uint64_t filtered;
+    uint64_t rateLimited; // dropped by the rate limits and sampling (see ratelimit.h)
+    uint64_t sent;
+    size_t staged; // in the staging ring
+    size_t storePending; // sink call data kept in the ThdStore
+    uint64_t queueHighWater; // max of the sinks'
+    std::vector<SinkStats> sinks;
+    SharedRingStats sharedRing; // see shmring.h
+    OverflowStats overflow; // bounded capture queue, see overflow.h
+};
+
+} // g3
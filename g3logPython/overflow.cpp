@@ -0,0 +1,157 @@
+//
+//  implementation of class CaptureLimit
+//
+// See the description in overflow.h.
+// A sink has processed: the messages sent before it was added, plus those it delivered or filtered out.
+//
+
+#include "overflow.h"
+#include "dispatch.h"
+#include "metrics.h"
+#include "staging.h"
+
+#include <Python.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+namespace g3 {
+
+namespace {
+
+const int MaxPauseUs = 1000;
+
+// the sinks are behind: waits a little (releasing the GIL if the caller holds it)
+void pause(int &wait_us, bool release_gil)
+{
+PyThreadState *state = (release_gil && Py_IsInitialized() && PyGILState_Check()) ? PyEval_SaveThread() : nullptr;
+std::this_thread::sleep_for(std::chrono::microseconds(wait_us));
+if(state != nullptr) PyEval_RestoreThread(state);
+wait_us = std::min(wait_us * 2, MaxPauseUs);
+}
+
+} // anonymous namespace
+
+CaptureLimit &captureLimit()
+{
+static CaptureLimit *limit = new CaptureLimit();
+return *limit;
+}
+
+void CaptureLimit::set(size_t capacity, int policy, int block_timeout_ms)
+{
+if(policy < (int)Overflow::BLOCK || policy > (int)Overflow::DROP_OLDEST) throw std::logic_error("setCaptureLimit: invalid overflow policy");
+std::lock_guard<std::mutex> lock(_lck);
+_policy = (Overflow)policy;
+_blockTimeout = std::chrono::milliseconds(block_timeout_ms);
+_budget.store(0, std::memory_order_relaxed); // counted again on the next message
+_workerBudget.store(0, std::memory_order_relaxed);
+_capacity.store(capacity, std::memory_order_relaxed);
+}
+
+void CaptureLimit::addSink(const std::shared_ptr<SinkOptions> &options)
+{
+std::lock_guard<std::mutex> lock(_lck);
+_sinks.emplace_back(options);
+}
+
+uint64_t CaptureLimit::inWorker()
+{
+uint64_t sent = captureMetrics().sent.sum();
+bool any = false;
+uint64_t slowest = 0;
+for(auto it = _sinks.begin(); it != _sinks.end(); ) {
+    std::shared_ptr<SinkOptions> options = it -> lock();
+    if(!options) {
+        it = _sinks.erase(it);
+        continue;
+        }
+    const SinkMetrics &metrics = options -> metrics;
+    uint64_t done = metrics.sentAtStart + metrics.messages.load(std::memory_order_relaxed) + metrics.filtered.load(std::memory_order_relaxed);
+    if(!any || done < slowest) slowest = done;
+    any = true;
+    ++it;
+  }
+if(!any) return 0; // no sink: the LogWorker discards the messages
+return (sent > slowest) ? sent - slowest : 0;
+}
+
+bool CaptureLimit::admitSlow()
+{
+bool blocked = false;
+std::chrono::steady_clock::time_point deadline;
+int wait_us = 50;
+for(;;) {
+      {
+        std::lock_guard<std::mutex> lock(_lck);
+        size_t capacity = _capacity.load(std::memory_order_relaxed);
+        if(capacity == 0) return true; // the limit was removed meanwhile
+        uint64_t used = (stagingRing().active() ? stagingRing().staged() : 0) + inWorker();
+        if(used < capacity) {
+            _budget.store((int64_t)(capacity - used) - 1, std::memory_order_relaxed);
+            return true;
+            }
+        _budget.store(0, std::memory_order_relaxed);
+
+        if(_policy == Overflow::DROP_OLDEST && stagingRing().active()) {
+            // the sinks may be full with nothing staged yet: the new record is staged anyway, and waits as the oldest
+            if(stagingRing().dropOldest()) _droppedOldest.fetch_add(1, std::memory_order_relaxed);
+            return true;
+            }
+        if(_policy != Overflow::BLOCK) { // DROP_NEWEST, or DROP_OLDEST without staging
+            _droppedNewest.fetch_add(1, std::memory_order_relaxed);
+            return false;
+            }
+
+        auto now = std::chrono::steady_clock::now();
+        if(!blocked) {
+            blocked = true;
+            _blocked.fetch_add(1, std::memory_order_relaxed);
+            deadline = (_blockTimeout.count() < 0) ? std::chrono::steady_clock::time_point::max() : now + _blockTimeout;
+            }
+        if(now >= deadline) {
+            _timeouts.fetch_add(1, std::memory_order_relaxed);
+            return false;
+            }
+      }
+    pause(wait_us, true);
+  }
+}
+
+void CaptureLimit::waitWorkerRoomSlow(const std::atomic<bool> &stop)
+{
+int wait_us = 50;
+for(;;) {
+      {
+        std::lock_guard<std::mutex> lock(_lck);
+        size_t capacity = _capacity.load(std::memory_order_relaxed);
+        if(capacity == 0) return;
+        uint64_t used = inWorker();
+        if(used < capacity) {
+            _workerBudget.store((int64_t)(capacity - used) - 1, std::memory_order_relaxed);
+            return;
+            }
+        _workerBudget.store(0, std::memory_order_relaxed);
+      }
+    if(stop.load()) return; // the ring is being stopped: its records are all sent
+    pause(wait_us, false);
+  }
+}
+
+OverflowStats CaptureLimit::stats()
+{
+std::lock_guard<std::mutex> lock(_lck);
+OverflowStats out;
+out.capacity = _capacity.load(std::memory_order_relaxed);
+out.policy = (int)_policy;
+out.blockTimeoutMs = (int)_blockTimeout.count();
+out.inFlight = (stagingRing().active() ? stagingRing().staged() : 0) + inWorker();
+out.blocked = _blocked.load(std::memory_order_relaxed);
+out.timeouts = _timeouts.load(std::memory_order_relaxed);
+out.droppedNewest = _droppedNewest.load(std::memory_order_relaxed);
+out.droppedOldest = _droppedOldest.load(std::memory_order_relaxed);
+return out;
+}
+
+} // g3
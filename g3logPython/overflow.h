@@ -0,0 +1,103 @@
+/*
+
+  Bounded capture queue: a limit on the messages captured and not yet processed by every sink,
+  and what to do with a message once the limit is reached.
+
+  g3log's queues (the LogWorker's, and each sink's) are unbounded: when a sink stalls (journald, a full disk,
+  an unreachable collector...), the queued LogMessages grow until the process runs out of memory.
+  With a capacity set, the messages in flight are counted as:
+      the records in the staging ring (see staging.h)
+    + the messages sent to the LogWorker and not processed yet by the slowest sink (see metrics.h)
+  and the LogWorker's part is kept below the capacity: the drainer thread and the shared ring's reader
+  hold the records back in their rings while the sinks are behind.
+
+  Overflow policies, when a new message would exceed the capacity:
+    - BLOCK: the caller waits for room (the GIL released) for up to block_timeout_ms (< 0: no limit).
+      The message is dropped once the timeout is reached (counted).
+    - DROP_NEWEST: the new message is dropped (counted).
+    - DROP_OLDEST: the oldest staged record is dropped to make room (counted), and the new one is staged.
+      Without staging, nothing waits in the staging ring: the new message is dropped instead.
+  FATAL messages and the flush barriers are never limited. The children attached to the shared ring
+  are limited by the parent: their records wait in the shared ring (and are dropped there when it is full).
+
+  Cost: the room left is computed once, then used up by the next messages with one atomic decrement each.
+  It is only computed again (summing the sinks' counters) when it runs out.
+
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace g3 {
+
+struct SinkOptions;
+
+enum class Overflow {BLOCK = 0, DROP_NEWEST = 1, DROP_OLDEST = 2};
+
+struct OverflowStats
+{
+    uint64_t capacity = 0; // 0: no limit
+    int policy = (int)Overflow::BLOCK;
+    int blockTimeoutMs = 0;
+    uint64_t inFlight = 0; // staged + not processed by the slowest sink
+    uint64_t blocked = 0; // callers that had to wait (BLOCK)
+    uint64_t timeouts = 0; // dropped after block_timeout_ms (BLOCK)
+    uint64_t droppedNewest = 0;
+    uint64_t droppedOldest = 0;
+};
+
+class CaptureLimit
+{
+public:
+    CaptureLimit() = default;
+    CaptureLimit(const CaptureLimit&) = delete;
+    CaptureLimit &operator=(const CaptureLimit&) = delete;
+
+    // capacity 0: no limit. Throws on an invalid policy
+    void set(size_t capacity, int policy, int block_timeout_ms);
+    void addSink(const std::shared_ptr<SinkOptions> &options); // counted in the slowest sink
+
+    // before a regular message is captured: false if it is dropped (may block, see BLOCK)
+    bool admit() {
+        if(_capacity.load(std::memory_order_relaxed) == 0) return true;
+        if(_budget.fetch_sub(1, std::memory_order_relaxed) > 0) return true;
+        return admitSlow();
+        };
+
+    // before a staged record (or a child's record) is sent to the LogWorker:
+    // waits until the sinks have room for it, or until "stop" is set
+    void waitWorkerRoom(const std::atomic<bool> &stop) {
+        if(_capacity.load(std::memory_order_relaxed) == 0) return;
+        if(_workerBudget.fetch_sub(1, std::memory_order_relaxed) > 0) return;
+        waitWorkerRoomSlow(stop);
+        };
+
+    OverflowStats stats();
+
+private:
+    bool admitSlow();
+    void waitWorkerRoomSlow(const std::atomic<bool> &stop);
+    uint64_t inWorker(); // sent to the LogWorker, and not processed by the slowest sink. _lck held
+
+    std::atomic<size_t> _capacity{0};
+    std::atomic<int64_t> _budget{0}; // messages admitted before the next count
+    std::atomic<int64_t> _workerBudget{0}; // records sent to the LogWorker before the next count
+
+    std::mutex _lck;
+    Overflow _policy = Overflow::BLOCK;
+    std::chrono::milliseconds _blockTimeout{0};
+    std::vector<std::weak_ptr<SinkOptions>> _sinks; // expired with the ifaceLogWorker
+
+    std::atomic<uint64_t> _blocked{0}, _timeouts{0}, _droppedNewest{0}, _droppedOldest{0};
+};
+
+// never destroyed (as the staging ring)
+CaptureLimit &captureLimit();
+
+} // g3
@@ -0,0 +1,37 @@
+//
+//  sink plugin API: see plugin.h
+//
+
+#include "intern_log.h"
+#include "g3logPython.h"
+
+#include <pybind11/pybind11.h>
+
+namespace g3 {
+
+namespace {
+
+PyObject *addSink(const char *name, plugin::Sink *sink)
+{
+std::shared_ptr<plugin::Sink> owned(sink); // deleted on error
+try {
+    std::shared_ptr<ifaceLogWorker> worker = ifaceLogWorker::get_ifaceLogWorker();
+    PluginSnkHndl hndl = worker -> PluginSinks.new_Sink(std::string(name), std::move(owned));
+    return pybind11::cast(std::move(hndl)).release().ptr();
+} catch(pybind11::error_already_set &err) {
+    err.restore();
+} catch(std::exception &err) {
+    PyErr_SetString(PyExc_RuntimeError, err.what());
+}
+return nullptr;
+}
+
+} // anonymous namespace
+
+const plugin::Api *pluginApi()
+{
+static const plugin::Api api = {G3LOGPYTHON_PLUGIN_API_VERSION, sizeof(plugin::Api), &addSink};
+return &api;
+}
+
+} // g3
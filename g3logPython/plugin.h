@@ -0,0 +1,77 @@
+/*
+
+  Sink plugin API: C++ sinks attached at runtime by other compiled modules, without modifying g3logPython.
+
+  A plugin is a python extension module, built against the same g3log headers and C++ standard library
+  as g3logPython (the messages cross the module boundary as g3::LogMessageMover). It includes this header only,
+  implements a g3::plugin::Sink, and adds it to the logger through the API exported by _g3logPython as a capsule:
+
+      #include <g3logPython/plugin.h>   // include path: g3logPython.get_include()
+
+      class KafkaSink: public g3::plugin::Sink {
+          void receive(g3::LogMessageMover msg) override {...}   // on the sink's thread
+        };
+
+      const g3::plugin::Api *api = g3::plugin::importApi(); // GIL held; nullptr and a python exception on error
+      PyObject *handle = api -> addSink("kafka", new KafkaSink(...));
+
+  The sink gets the messages directly on its own g3log thread, with no python call per message, behind the
+  same dispatcher as the built-in sinks: filters, field format, flush barriers, metrics ( stats() , type "plugin").
+  addSink() returns the python handle of the sink (a PluginSnkHndl, with the usual name management: a name is used once).
+
+  Compatibility: the Api struct only grows. Check "version" for the functions added after version 1,
+  "size" tells which members exist.
+
+*/
+
+#pragma once
+
+#include <Python.h>
+#include <g3log/logmessage.hpp>
+
+#include <cstdint>
+#include <string>
+
+#define G3LOGPYTHON_PLUGIN_API_VERSION 1
+#define G3LOGPYTHON_PLUGIN_CAPSULE "_g3logPython._sink_plugin_api"
+
+namespace g3 {
+namespace plugin {
+
+class Sink
+{
+public:
+    virtual ~Sink() = default; // when the logger ends
+
+    // each regular message (FATAL included), on the sink's thread. The sink owns the message.
+    virtual void receive(LogMessageMover msg) = 0;
+    // flush barriers and ifaceLogWorker::flush() : write what is buffered
+    virtual void flush() {}
+    // PluginSnkHndl.control(command), on the sink's thread: configuration specific to the sink
+    virtual std::string control(const std::string &/*command*/) {return std::string();}
+};
+
+struct Api
+{
+    uint32_t version; // G3LOGPYTHON_PLUGIN_API_VERSION of g3logPython
+    uint32_t size; // sizeof(Api) of g3logPython
+
+    // adds "sink" to the logger (the logger is created if needed), and takes ownership of it, even on error.
+    // GIL held. Returns a new reference to the sink's python handle, or nullptr with a python exception set.
+    PyObject *(*addSink)(const char *name, Sink *sink);
+};
+
+// the API of the loaded g3logPython module (imported if needed). GIL held.
+// nullptr with a python exception set if the module is not found, or if its API is older than this header's.
+inline const Api *importApi()
+{
+const Api *api = static_cast<const Api*>(PyCapsule_Import(G3LOGPYTHON_PLUGIN_CAPSULE, 0));
+if(api != nullptr && api -> version < G3LOGPYTHON_PLUGIN_API_VERSION) {
+    PyErr_SetString(PyExc_ImportError, "g3logPython: the sink plugin API of the loaded module is too old");
+    return nullptr;
+    }
+return api;
+}
+
+} // plugin
+} // g3
@@ -0,0 +1,83 @@
+/*
+
+  python-facing entry points of the capture path.
+  
+  These functions are called directly by the python interpreter (through pybind11)
+  and may use the CPython API: they must be called with the GIL held.
+
+*/
+
+#pragma once
+
+#include <pybind11/pybind11.h>
+
+#include "fields.h"
+
+#include <vector>
+
+namespace g3 {
+
+// same as receivelog(), but the call-site (file, line, function) is read from 
+// the python frame calling us, directly from the interpreter (no inspect.stack() ).
+// level_val : enum pyLEVEL
+// message: any python object, converted with str() if it is not already a string (or bytes).
+// args: optional tuple of arguments, for a printf-style message template (formatted later: see format.h).
+//       Templates with mapping keys ( %(name)s ) are formatted immediately.
+// kwargs: optional dict of structured fields (see fields.h). int, float, bool and str values are copied as such,
+//         the other objects are converted with str().
+void receivelog_caller(int level_val, pybind11::handle message, pybind11::handle args = pybind11::handle(), pybind11::handle kwargs = pybind11::handle());
+
+// receivelog() for python: the message can be a str (its UTF-8 representation cached by CPython is used), 
+// bytes, or any object providing a contiguous buffer. It is copied once, and then moved into the g3log message.
+// kwargs: structured fields, as in receivelog_caller()
+void receivelog_obj(pybind11::handle file, int line, pybind11::handle functionname, int level_val, pybind11::handle message, pybind11::handle kwargs = pybind11::handle());
+
+// receivelog_id() for python: the message is handled like in receivelog_obj()
+void receivelog_id_obj(int site_id, int level_val, pybind11::handle message);
+
+// registers the call-site of the python caller, returns its id (see registerCallSite() )
+int registerCallerSite();
+
+// logs a sequence of records in one call.
+// records: sequence of (level, message) tuples, logged with the caller's call-site,
+//          or of (file, line, function, level, message) tuples.
+// The whole batch is converted first, then sent to g3log (or to the staging ring) without the GIL.
+void receivelog_batch(pybind11::handle records);
+
+// stdlib logging bridge (the Handler class of __init__.py).
+// logs a logging.LogRecord, reading its attributes directly: call-site (pathname, lineno, funcName), levelno, created,
+// msg and args (captured as in receivelog_caller(), and formatted later), and the logger name as a structured field "logger"
+// (unless handler.logger_field is false). No python code runs per record, unless the handler has a formatter
+// (it then formats the whole message), or the record carries a traceback (exc_info, stack_info: formatted by logging).
+// levels: below INFO: DEBUG, below WARNING: INFO, WARNING and above: WARNING, with a "levelname" field
+// for the levels other than DEBUG, INFO and WARNING (CRITICAL never aborts the process).
+void receivelog_record(pybind11::handle handler, pybind11::handle record);
+
+// logging.Handler.handle() of the bridge: the handler's filters, then receivelog_record().
+// Exceptions are reported by handler.handleError(), as logging.Handler.emit() does.
+pybind11::object handleLogRecord(pybind11::handle handler, pybind11::handle record);
+
+// log.context(**fields): python's logging context (see context.h), a context manager.
+// The fields are captured when it is created, the context is made when it is entered,
+// from the python context in effect at that point. It can be entered again (on the same thread or task).
+class LogContext
+{
+public:
+    explicit LogContext(std::vector<LogField> &&fields): _fields(std::move(fields)) {};
+    LogContext(LogContext &&) = default;
+    ~LogContext(); // releases the tokens of the contexts left open
+    LogContext &enter();
+    void exit(pybind11::args); // back to the context in effect when it was entered
+
+private:
+    std::vector<LogField> _fields;
+    std::vector<PyObject *> _tokens; // ContextVar tokens, one per enter() not exited yet
+};
+
+// log.context(): the fields are captured as in receivelog_caller()
+LogContext context_obj(pybind11::kwargs fields);
+
+// the fields of the current context (see currentContext() ), as a dict
+pybind11::dict currentContextDict();
+
+} // g3
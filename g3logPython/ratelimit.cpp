@@ -0,0 +1,207 @@
+//
+//  implementation of class RateLimiter
+//
+// The call-sites are kept in sharded hash tables (one mutex per shard), keyed by a 64 bits hash
+// of the call-site strings and level: the strings are only copied when a call-site is first seen.
+//
+
+#include "intern_log.h"
+#include "ratelimit.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace g3 {
+
+RateLimiter &rateLimiter()
+{
+static RateLimiter *limiter = new RateLimiter(); // never destroyed: may be used until the very end of the process
+return *limiter;
+}
+
+namespace {
+
+// FNV-1a
+uint64_t hashBytes(uint64_t h, const char *str)
+{
+for(; *str != '\0'; str++) {
+    h ^= (unsigned char)*str;
+    h *= 1099511628211ULL;
+    }
+return h;
+}
+
+const int64_t MinSweepNs = 100000000; // 100 ms: with a summary interval of 0, the sweeps stay rare
+
+uint64_t siteHash(const char *file, int line, const char *function, int level_val)
+{
+uint64_t h = hashBytes(14695981039346656037ULL, file);
+h = hashBytes(h ^ 0xff, function);
+h ^= ((uint64_t)(unsigned)line << 8) | (unsigned)level_val;
+return h * 1099511628211ULL;
+}
+
+} // anonymous namespace
+
+RateLimiter::RateLimiter(): _active(false), _summaryIntervalNs(5000000000LL), _nextSweepNs(0), _siteCount(0), _dropped(0)
+{
+}
+
+void RateLimiter::setLimit(int level_val, double per_second, double burst, int sample_every)
+{
+if(level_val < -1 || level_val >= NumLevels) throw std::logic_error("setRateLimit: invalid level");
+
+Limit &limit = _limits[level_val + 1];
+bool set = per_second > 0 || sample_every > 1;
+limit.perSecond.store(per_second, std::memory_order_relaxed);
+limit.burst.store((burst >= 1) ? burst : ((per_second > 1) ? per_second : 1), std::memory_order_relaxed);
+limit.sampleEvery.store((sample_every > 1) ? sample_every : 1, std::memory_order_relaxed);
+limit.set.store(set, std::memory_order_release);
+
+bool active = false;
+for(auto &lim: _limits) active = active || lim.set.load(std::memory_order_relaxed);
+_active.store(active, std::memory_order_release);
+}
+
+void RateLimiter::clear()
+{
+flushSummaries(true);
+for(auto &lim: _limits) lim.set.store(false, std::memory_order_relaxed);
+_active.store(false, std::memory_order_release);
+for(auto &shard: _shards) {
+    std::lock_guard<std::mutex> lock(shard.lck);
+    shard.sites.clear();
+    }
+_siteCount.store(0, std::memory_order_relaxed);
+_dropped.store(0, std::memory_order_relaxed);
+}
+
+void RateLimiter::setSummaryInterval(double seconds)
+{
+_summaryIntervalNs.store((seconds > 0) ? (int64_t)(seconds * 1e9) : 0, std::memory_order_relaxed);
+}
+
+const RateLimiter::Limit *RateLimiter::limitOf(int level_val) const
+{
+const Limit &own = _limits[level_val + 1];
+if(own.set.load(std::memory_order_acquire)) return &own;
+if(_limits[0].set.load(std::memory_order_acquire)) return &_limits[0];
+return nullptr;
+}
+
+bool RateLimiter::admit(const char *file, int line, const char *function, int level_val)
+{
+if(level_val < 0 || level_val >= NumLevels) return true; // FATAL, or invalid level: reported by receivelog()
+const Limit *limit = limitOf(level_val);
+if(limit == nullptr) return true;
+
+uint64_t key = siteHash(file, line, function, level_val);
+Shard &shard = _shards[key % NumShards];
+auto now = std::chrono::steady_clock::now();
+double perSecond = limit -> perSecond.load(std::memory_order_relaxed);
+double burst = limit -> burst.load(std::memory_order_relaxed);
+int sampleEvery = limit -> sampleEvery.load(std::memory_order_relaxed);
+
+uint64_t summary = 0;
+  {
+    std::lock_guard<std::mutex> lock(shard.lck);
+    auto search = shard.sites.find(key);
+    if(search == shard.sites.end()) {
+        if(_siteCount.load(std::memory_order_relaxed) >= MaxSites) return true;
+        _siteCount.fetch_add(1, std::memory_order_relaxed);
+        Site site;
+        site.counters = RateLimitStats{file, line, function, level_val, 0, 0, 0};
+        site.tokens = burst;
+        site.refilled = now;
+        site.lastSummary = now;
+        search = shard.sites.emplace(key, std::move(site)).first;
+        }
+    Site &site = search -> second;
+    
+    if(sampleEvery > 1 && (site.seen++ % (uint64_t)sampleEvery) != 0) {
+        site.counters.sampled++;
+        site.suppressed++;
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+        }
+    if(perSecond > 0) {
+        double elapsed = std::chrono::duration<double>(now - site.refilled).count();
+        site.refilled = now;
+        site.tokens += elapsed * perSecond;
+        if(site.tokens > burst) site.tokens = burst;
+        if(site.tokens < 1) {
+            site.counters.limited++;
+            site.suppressed++;
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+            }
+        site.tokens -= 1;
+        }
+    site.counters.logged++;
+    if(site.suppressed > 0 && now - site.lastSummary >= std::chrono::nanoseconds(_summaryIntervalNs.load(std::memory_order_relaxed))) {
+        summary = site.suppressed;
+        site.suppressed = 0;
+        site.lastSummary = now;
+        }
+  }
+
+// logged without the shard's lock, just before the message admitted
+if(summary > 0) receivelog_str(file, line, function, level_val, "suppressed " + std::to_string(summary) + " messages from this call-site");
+
+// the call-sites gone quiet: swept by one of the callers, once per summary interval
+int64_t nowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+int64_t nextSweep = _nextSweepNs.load(std::memory_order_relaxed);
+if(nowNs >= nextSweep && _nextSweepNs.compare_exchange_strong(nextSweep, nowNs + std::max<int64_t>(_summaryIntervalNs.load(std::memory_order_relaxed), MinSweepNs)))
+    flushSummaries(false);
+return true;
+}
+
+void RateLimiter::flushSummaries(bool all)
+{
+struct Summary {
+    std::string file;
+    int line;
+    std::string function;
+    int level;
+    uint64_t count;
+};
+std::vector<Summary> summaries;
+auto now = std::chrono::steady_clock::now();
+std::chrono::nanoseconds interval(_summaryIntervalNs.load(std::memory_order_relaxed));
+for(auto &shard: _shards) {
+    std::lock_guard<std::mutex> lock(shard.lck);
+    for(auto &entry: shard.sites) {
+        Site &site = entry.second;
+        if(site.suppressed == 0 || (!all && now - site.lastSummary < interval)) continue;
+        summaries.push_back(Summary{site.counters.file, site.counters.line, site.counters.function, site.counters.level, site.suppressed});
+        site.suppressed = 0;
+        site.lastSummary = now;
+        }
+    }
+// without the shards' locks, as in admit()
+for(auto &summary: summaries)
+    receivelog_str(summary.file.c_str(), summary.line, summary.function.c_str(), summary.level,
+                   "suppressed " + std::to_string(summary.count) + " messages from this call-site");
+}
+
+std::vector<RateLimitStats> RateLimiter::stats()
+{
+std::vector<RateLimitStats> out;
+for(auto &shard: _shards) {
+    std::lock_guard<std::mutex> lock(shard.lck);
+    for(auto &entry: shard.sites) out.push_back(entry.second.counters);
+    }
+return out;
+}
+
+void RateLimiter::lockAll()
+{
+for(auto &shard: _shards) shard.lck.lock();
+}
+
+void RateLimiter::unlockAll()
+{
+for(auto &shard: _shards) shard.lck.unlock();
+}
+
+} // g3
@@ -0,0 +1,117 @@
+/*
+
+  Rate limiting and sampling of the log calls, per call-site.
+
+  Each call-site (file, line, function, level) has its own token bucket: at most "per_second"
+  messages per second, with bursts of "burst" messages. With "sample_every" N > 1, only
+  1 message in N is kept (before the rate limit). The limits are set per level, or for all
+  the levels without a limit of their own.
+
+  The decision is taken on the caller's thread, before the message (or its arguments) is converted.
+  When no limit is set, it costs a single atomic load.
+  The dropped messages are counted per call-site: the next message logged from that call-site
+  is preceded by a "suppressed N messages" summary (at most once per summary interval).
+  The summaries of the call-sites gone quiet are logged by the log calls of the other limited call-sites
+  (once per summary interval), by ifaceLogWorker::flush(), by clear() and when the worker is destroyed.
+
+  FATAL messages are never dropped.
+
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace g3 {
+
+struct RateLimitStats
+{
+    std::string file;
+    int line;
+    std::string function;
+    int level; // pyLEVEL
+    uint64_t logged;  // messages let through
+    uint64_t sampled; // dropped by the sampling
+    uint64_t limited; // dropped by the rate limit
+};
+
+class RateLimiter
+{
+public:
+    RateLimiter();
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter &operator=(const RateLimiter&) = delete;
+    
+    // level_val: a pyLEVEL (not FATAL), or -1 for the levels without a limit of their own.
+    // per_second <= 0: no rate limit. burst < 1: max(1, per_second). sample_every <= 1: no sampling.
+    // Without rate limit nor sampling, the limit of the level is removed. Throws on an invalid level.
+    void setLimit(int level_val, double per_second, double burst, int sample_every);
+    void clear(); // logs the pending summaries, removes all the limits, and forgets the call-sites and their counters
+    void setSummaryInterval(double seconds);
+    
+    bool active() const {return _active.load(std::memory_order_relaxed);};
+    // false if the message must be dropped. May log the summary of the call-site first.
+    bool admit(const char *file, int line, const char *function, int level_val);
+    
+    // logs the summary of each call-site with suppressed messages (all: even within its summary interval)
+    void flushSummaries(bool all);
+    
+    std::vector<RateLimitStats> stats();
+    uint64_t dropped() const {return _dropped.load(std::memory_order_relaxed);};
+    
+    // held across fork() (see shmring.h): the child gets unlocked shards
+    void lockAll();
+    void unlockAll();
+    
+private:
+    static const int NumLevels = 3; // pyDEBUG ... pyWARNING: the levels which can be limited
+    static const size_t MaxSites = 65536; // beyond, new call-sites are not limited
+    static const int NumShards = 16;
+    
+    struct Limit {
+        std::atomic<bool> set{false};
+        std::atomic<double> perSecond{0};
+        std::atomic<double> burst{1};
+        std::atomic<int> sampleEvery{1};
+    };
+    struct Site {
+        RateLimitStats counters;
+        double tokens;
+        std::chrono::steady_clock::time_point refilled;
+        uint64_t seen = 0; // for the sampling
+        uint64_t suppressed = 0; // since the last summary
+        std::chrono::steady_clock::time_point lastSummary;
+    };
+    struct Shard {
+        std::mutex lck;
+        std::unordered_map<uint64_t, Site> sites; // key: hash of the call-site and level
+        char pad[64]; // the shards' mutexes are kept on separate cache lines
+    };
+    
+    const Limit *limitOf(int level_val) const;
+    
+    std::atomic<bool> _active;
+    Limit _limits[NumLevels + 1]; // [0]: all levels
+    std::atomic<int64_t> _summaryIntervalNs;
+    std::atomic<int64_t> _nextSweepNs; // steady_clock: admit() calls flushSummaries(false) after it
+    std::atomic<size_t> _siteCount;
+    std::atomic<uint64_t> _dropped;
+    Shard _shards[NumShards];
+};
+
+// the unique limiter, used by receivelog(). Never destroyed, as the call-site registry.
+RateLimiter &rateLimiter();
+
+inline bool rateLimitAdmit(const char *file, int line, const char *function, int level_val)
+{
+RateLimiter &limiter = rateLimiter();
+return !limiter.active() || limiter.admit(file, line, function, level_val);
+}
+
+} // g3
@@ -0,0 +1,122 @@
+//
+//  implementation of class RenderCache
+//
+// See the description in render.h.
+// render tag layout: G3LOGPYTHON_RENDER_TAG, u64 message id, u32 readers (native byte order)
+//
+
+#include "render.h"
+#include "fields.h"
+
+#include <cstring>
+#include <thread>
+
+namespace g3 {
+
+namespace {
+
+const size_t TagSize = 1 + sizeof(uint64_t) + sizeof(uint32_t);
+
+} // anonymous namespace
+
+struct RenderCache::SlotLock
+{
+    explicit SlotLock(Slot &slot_): slot(slot_) {while(slot.busy.test_and_set(std::memory_order_acquire)) std::this_thread::yield();};
+    ~SlotLock() {slot.busy.clear(std::memory_order_release);};
+    Slot &slot;
+};
+
+RenderCache &renderCache()
+{
+static RenderCache *cache = new RenderCache();
+return *cache;
+}
+
+RenderTag untagRender(LogMessage &msg)
+{
+RenderTag tag;
+if(msg._expression.size() < TagSize || msg._expression[0] != G3LOGPYTHON_RENDER_TAG) return tag;
+memcpy(&tag.id, msg._expression.data() + 1, sizeof(tag.id));
+memcpy(&tag.readers, msg._expression.data() + 1 + sizeof(tag.id), sizeof(tag.readers));
+msg._expression.erase(0, TagSize);
+return tag;
+}
+
+std::string renderDefaultLine(LogMessage &msg)
+{
+if(hasFields(msg)) {
+    msg._message = renderMessage(msg._message, decodeFields(msg._expression), FieldFormat::TEXT);
+    msg._expression.clear();
+    }
+return msg.toString();
+}
+
+void RenderCache::tag(LogMessage &msg)
+{
+uint32_t readers = _readers.load(std::memory_order_relaxed);
+if(readers < 2) return; // nothing to share
+uint64_t id = _nextId.fetch_add(1, std::memory_order_relaxed);
+char buf[TagSize];
+buf[0] = G3LOGPYTHON_RENDER_TAG;
+memcpy(buf + 1, &id, sizeof(id));
+memcpy(buf + 1 + sizeof(id), &readers, sizeof(readers));
+msg._expression.insert(0, buf, TagSize);
+}
+
+RenderCache::Slot *RenderCache::visit(Slot &slot, const RenderTag &tag)
+{
+if(slot.id > tag.id) return nullptr;
+if(slot.id < tag.id) take(slot, tag);
+if(++slot.visited >= tag.readers) slot.text.reset(); // the last reader
+return &slot;
+}
+
+void RenderCache::take(Slot &slot, const RenderTag &tag)
+{
+slot.id = tag.id;
+slot.visited = 0;
+slot.rendering = false;
+slot.text.reset();
+}
+
+std::shared_ptr<const std::string> RenderCache::line(const RenderTag &tag, LogMessage &msg, bool &shared)
+{
+Slot &slot = _slots[tag.id & (Slots - 1)];
+shared = false;
+bool owner = false;
+for(;;) {
+      {
+        SlotLock lock(slot);
+        if(slot.id == tag.id && slot.text) {
+            std::shared_ptr<const std::string> text = slot.text;
+            visit(slot, tag);
+            shared = true;
+            return text;
+            }
+        if(slot.id > tag.id) break; // a newer message took the slot
+        if(slot.id < tag.id) take(slot, tag);
+        if(!slot.rendering) { // first reader, or the line was not kept
+            slot.rendering = true;
+            owner = true;
+            break;
+            }
+      }
+    std::this_thread::yield(); // rendered by another sink right now: a few microseconds
+  }
+auto text = std::make_shared<const std::string>(renderDefaultLine(msg)); // without the lock
+SlotLock lock(slot);
+if(visit(slot, tag) != nullptr && owner) {
+    slot.rendering = false;
+    if(slot.visited < tag.readers && text -> size() <= MaxLineSize) slot.text = text;
+    }
+return text;
+}
+
+void RenderCache::skip(const RenderTag &tag)
+{
+Slot &slot = _slots[tag.id & (Slots - 1)];
+SlotLock lock(slot);
+visit(slot, tag);
+}
+
+} // g3
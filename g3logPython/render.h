@@ -0,0 +1,102 @@
+/*
+
+  Shared rendering of the log lines ("format once").
+
+  The LogWorker gives each sink its own copy of a LogMessage: with several sinks writing the default layout
+  (LogMessage::toString() : LogRotate, color terminal, network), each of them would format the same line on its own thread.
+  When at least 2 such sinks are added, the messages sent to g3log carry a render tag (message id, number of readers)
+  at the start of their _expression. The first sink rendering the line publishes it in a small cache,
+  as an immutable reference-counted string: the other sinks take it from there instead of formatting again
+  (a sink arriving while the line is being rendered waits for it).
+
+  The cache is opportunistic, the sinks render the line themselves when it is not there:
+    - the slots are indexed by message id: a sink lagging more than Slots messages behind finds its slot reused.
+    - the lines larger than MaxLineSize are not kept.
+  A line is released once all its readers have visited its slot (delivered, or skipped by their filters),
+  or when a newer message takes the slot.
+
+  The sinks needing another layout don't share: the sinks formatting the LogMessage themselves (syslog, binary, journald),
+  and the sinks writing the messages with fields as LOGFMT / JSON lines (see fields.h).
+
+*/
+
+#pragma once
+
+#include <g3log/logmessage.hpp>
+#include "RotatingLogFile.h"
+#include "ColorTermSink.h"
+#include "NetSink.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace g3 {
+
+// the sinks writing LogMessage::toString() (with the fields rendered as TEXT)
+template<class g3logSinkCls> inline bool sinkSharesLine() {return false;}
+template<> inline bool sinkSharesLine<RotatingLogFile>() {return true;}
+template<> inline bool sinkSharesLine<ColorTermSink>() {return true;}
+template<> inline bool sinkSharesLine<NetSink>() {return true;}
+
+// the render tag starts with this byte (control messages: '\x01', fields: '\x02'), the fields follow it
+#define G3LOGPYTHON_RENDER_TAG '\x03'
+
+struct RenderTag
+{
+    uint64_t id = 0; // 0: not tagged
+    uint32_t readers = 0;
+};
+
+// removes the render tag of the sink's copy of a message (before anything else reads its _expression)
+RenderTag untagRender(LogMessage &msg);
+
+// the default layout of a message, its fields rendered as TEXT (the message is modified)
+std::string renderDefaultLine(LogMessage &msg);
+
+class RenderCache
+{
+public:
+    static const size_t Slots = 8192; // power of 2
+    static const size_t MaxLineSize = 4096;
+
+    RenderCache() = default;
+    RenderCache(const RenderCache&) = delete;
+    RenderCache &operator=(const RenderCache&) = delete;
+
+    void addReader() {_readers.fetch_add(1, std::memory_order_relaxed);}; // a sink sharing the lines is added
+
+    // tags a message before it is sent to g3log, when it has 2 readers or more
+    void tag(LogMessage &msg);
+
+    // the line of a tagged message: taken from the cache ("shared" is set), or rendered and published
+    std::shared_ptr<const std::string> line(const RenderTag &tag, LogMessage &msg, bool &shared);
+    // a reader does not use the line (filtered out, or another layout)
+    void skip(const RenderTag &tag);
+
+private:
+    struct Slot {
+        std::atomic_flag busy = ATOMIC_FLAG_INIT; // spin lock: held for a few instructions
+        uint64_t id = 0;
+        uint32_t visited = 0;
+        bool rendering = false; // by the first reader: the others wait for its line
+        std::shared_ptr<const std::string> text;
+        char pad[64 - 3 * sizeof(uint64_t) - sizeof(std::shared_ptr<const std::string>)]; // one slot per cache line
+    };
+    struct SlotLock;
+
+    // the slot of "tag", after the visit of one more reader (under the slot's lock).
+    // nullptr if a newer message took the slot
+    Slot *visit(Slot &slot, const RenderTag &tag);
+    static void take(Slot &slot, const RenderTag &tag); // the slot is reused for the message "tag"
+
+    std::atomic<uint32_t> _readers{0};
+    std::atomic<uint64_t> _nextId{1};
+    Slot _slots[Slots];
+};
+
+// never destroyed (as the staging ring)
+RenderCache &renderCache();
+
+} // g3
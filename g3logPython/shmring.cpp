@@ -0,0 +1,320 @@
+//
+//  implementation of class SharedRing
+//
+// See the description in shmring.h.
+// The records are written under the ring's mutex (head: bytes written), and read without it by the
+// parent's reader thread (tail: bytes read), which only takes the mutex to wait for new records.
+// The records are not aligned: they are copied out of the ring, splitting the copy where the ring wraps.
+//
+// record layout (native byte order, offsets in bytes):
+//   0 u32 record size, 4 i32 level (pyLEVEL), 8 i32 line, 12 u32 file length, 16 u32 function length,
+//   20 u32 message length, 24 u32 fields length, 28 u32 (0), 32 i64 timestamp (g3log's clock ticks),
+//   40 file, function, message, fields (encoded as in fields.h)
+//
+
+#include "intern_log.h"
+#include "g3logPython.h"
+#include "metrics.h"
+#include "overflow.h"
+#include "render.h"
+#include "shmring.h"
+
+#include <g3log/g3log.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace g3 {
+
+struct SharedRing::Header
+{
+    pthread_mutex_t lck; // robust, process-shared
+    pthread_cond_t readable; // the reader waits on it (with lck), when the ring is empty
+    std::atomic<uint64_t> head; // bytes written since start (written under lck)
+    std::atomic<uint64_t> tail; // bytes read since start (by the reader only)
+    int readerSleeping; // under lck
+    std::atomic<int> readerPid; // the parent, while its reader runs. 0: stopped
+    std::atomic<uint64_t> dropped;
+};
+
+namespace {
+
+const size_t RecHeaderSize = 40;
+
+template<typename T> void put(char *p, T val) {memcpy(p, &val, sizeof(T));}
+template<typename T> T get(const char *p) {T val; memcpy(&val, p, sizeof(T)); return val;}
+
+// builds the LogMessage of a record read from the ring, and sends it to g3log
+void sendRecord(const std::string &rec)
+{
+const char *p = rec.data();
+uint32_t fileLen = get<uint32_t>(p + 12), funcLen = get<uint32_t>(p + 16), msgLen = get<uint32_t>(p + 20), fieldsLen = get<uint32_t>(p + 24);
+if(RecHeaderSize + (uint64_t)fileLen + funcLen + msgLen + fieldsLen != rec.size()) return; // not a record
+
+const char *str = p + RecHeaderSize;
+std::unique_ptr<LogMessage> msg(new LogMessage(std::string(str, fileLen), get<int32_t>(p + 8), std::string(str + fileLen, funcLen),
+                                               pyLevelToG3(get<int32_t>(p + 4))));
+str += fileLen + funcLen;
+msg -> _timestamp = stamp_t(stamp_t::duration(get<int64_t>(p + 32)));
+msg -> write().assign(str, msgLen);
+if(fieldsLen > 0) msg -> _expression.assign(str + msgLen, fieldsLen);
+renderCache().tag(*msg);
+g3::internal::pushMessageToLogger(LogMessagePtr(std::move(msg)));
+captureMetrics().sent.add();
+}
+
+} // anonymous namespace
+
+SharedRing &sharedRing()
+{
+static SharedRing *ring = new SharedRing();
+return *ring;
+}
+
+void checkNotRingChild(const char *what)
+{
+if(sharedRing().attached())
+    throw std::logic_error(std::string(what) + ": not available in a child process attached to the shared ring (the sinks live in the parent)");
+}
+
+// the owner of the mutex died: it had not moved head yet, and its record is simply not published
+void SharedRing::lockRing()
+{
+if(pthread_mutex_lock(&_hdr -> lck) == EOWNERDEAD) pthread_mutex_consistent(&_hdr -> lck);
+}
+
+void SharedRing::unlockRing()
+{
+pthread_mutex_unlock(&_hdr -> lck);
+}
+
+void SharedRing::start(size_t capacity, int full_wait_ms)
+{
+checkNotRingChild("startSharedRing");
+std::lock_guard<std::mutex> lock(_startLck);
+if(active()) throw std::logic_error("startSharedRing: the shared ring is already started");
+
+// restarted: the children forked so far still use the first mapping
+if(_hdr == nullptr) {
+    capacity = std::max(capacity, MinCapacity);
+    size_t hdrSize = (sizeof(Header) + 63) & ~(size_t)63;
+    void *map = mmap(nullptr, hdrSize + capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(map == MAP_FAILED) throw std::logic_error(std::string("startSharedRing: cannot map the ring: ") + strerror(errno));
+
+    Header *hdr = new(map) Header();
+    pthread_mutexattr_t mattr;
+    pthread_mutexattr_init(&mattr);
+    pthread_mutexattr_setpshared(&mattr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&mattr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&hdr -> lck, &mattr);
+    pthread_mutexattr_destroy(&mattr);
+    pthread_condattr_t cattr;
+    pthread_condattr_init(&cattr);
+    pthread_condattr_setpshared(&cattr, PTHREAD_PROCESS_SHARED);
+    pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+    pthread_cond_init(&hdr -> readable, &cattr);
+    pthread_condattr_destroy(&cattr);
+    hdr -> head.store(0, std::memory_order_relaxed);
+    hdr -> tail.store(0, std::memory_order_relaxed);
+    hdr -> readerSleeping = 0;
+    hdr -> readerPid.store(0, std::memory_order_relaxed);
+    hdr -> dropped.store(0, std::memory_order_relaxed);
+
+    _hdr = hdr;
+    _data = static_cast<char*>(map) + hdrSize;
+    _capacity = capacity;
+    }
+_fullWaitMs = std::max(0, full_wait_ms);
+_terminate.store(false);
+_readerThd = std::thread(&g3::SharedRing::ReaderWorker, this);
+_reading.store(true, std::memory_order_release);
+_hdr -> readerPid.store(getpid(), std::memory_order_release);
+}
+
+void SharedRing::stop()
+{
+if(attached()) return; // the reader is the parent's
+std::lock_guard<std::mutex> lock(_startLck);
+if(!active()) return;
+
+_hdr -> readerPid.store(0, std::memory_order_release); // the children drop their records from now on
+lockRing();
+_terminate.store(true);
+pthread_cond_signal(&_hdr -> readable);
+unlockRing();
+_readerThd.join();
+_reading.store(false, std::memory_order_release);
+}
+
+void SharedRing::attachChild()
+{
+if(_hdr == nullptr) return; // no ring: the child keeps the state of the parent, as without the ring
+_attached.store(true);
+_reading.store(false); // the reader thread is the parent's
+_pid = getpid();
+}
+
+// child: the parent has stopped its reader (stopSharedRing()), or has exited
+bool SharedRing::readerGone() const
+{
+int pid = _hdr -> readerPid.load(std::memory_order_acquire);
+return pid == 0 || (kill(pid, 0) != 0 && errno == ESRCH);
+}
+
+bool SharedRing::push(StagedLog &&rec)
+{
+static thread_local std::string buf; // one copy of the record, then into the ring (where it may wrap)
+
+if(_hdr -> readerPid.load(std::memory_order_acquire) == 0) { // stopped: nobody would read it
+    _hdr -> dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+    }
+
+const std::string *file = &rec.file, *function = &rec.function;
+int line = rec.line;
+if(rec.site_id >= 0) { // the site may be unknown to the parent: always sent in full
+    const CallSite &site = callSites().get(rec.site_id);
+    file = &site.file;
+    function = &site.function;
+    line = site.line;
+    }
+std::string message = rec.args.empty() ? std::move(rec.message) : formatDeferred(rec.message, rec.args);
+rec.fields.push_back(LogField{"pid", LogValue::from_int(_pid)});
+std::string fields = encodeFields(rec.fields, rec.context.get());
+
+uint64_t size = RecHeaderSize + file -> size() + function -> size() + message.size() + fields.size();
+if(size > _capacity || size > UINT32_MAX) {
+    _hdr -> dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+    }
+buf.resize(size);
+char *p = &buf[0];
+put<uint32_t>(p, size);
+put<int32_t>(p + 4, rec.level_val);
+put<int32_t>(p + 8, line);
+put<uint32_t>(p + 12, file -> size());
+put<uint32_t>(p + 16, function -> size());
+put<uint32_t>(p + 20, message.size());
+put<uint32_t>(p + 24, fields.size());
+put<uint32_t>(p + 28, 0);
+put<int64_t>(p + 32, wallTime(rec.timestamp).time_since_epoch().count());
+char *str = p + RecHeaderSize;
+memcpy(str, file -> data(), file -> size());
+str += file -> size();
+memcpy(str, function -> data(), function -> size());
+str += function -> size();
+memcpy(str, message.data(), message.size());
+str += message.size();
+memcpy(str, fields.data(), fields.size());
+
+auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(_fullWaitMs);
+lockRing();
+uint64_t head = _hdr -> head.load(std::memory_order_relaxed);
+while(_capacity - (head - _hdr -> tail.load(std::memory_order_acquire)) < size) {
+    // full: the parent reads without the mutex
+    unlockRing();
+    if(std::chrono::steady_clock::now() >= deadline || readerGone()) { // full for good when nobody reads
+
+        _hdr -> dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+        }
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+    lockRing();
+    head = _hdr -> head.load(std::memory_order_relaxed);
+  }
+size_t offset = head % _capacity;
+size_t first = std::min<size_t>(size, _capacity - offset);
+memcpy(_data + offset, p, first);
+memcpy(_data, p + first, size - first);
+_hdr -> head.store(head + size, std::memory_order_release);
+if(_hdr -> readerSleeping) pthread_cond_signal(&_hdr -> readable);
+unlockRing();
+
+captureMetrics().sent.add();
+return true;
+}
+
+bool SharedRing::flush(std::chrono::steady_clock::time_point deadline)
+{
+if(_hdr == nullptr) return true;
+uint64_t target = _hdr -> head.load(std::memory_order_acquire);
+while(_hdr -> tail.load(std::memory_order_acquire) < target) {
+    if(attached() ? readerGone() : !active()) return false; // nobody reads
+    if(std::chrono::steady_clock::now() >= deadline) return false;
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+return true;
+}
+
+SharedRingStats SharedRing::stats() const
+{
+SharedRingStats out;
+if(_hdr == nullptr) return out;
+out.attached = attached();
+out.parent = !out.attached;
+out.received = _received.load(std::memory_order_relaxed);
+out.dropped = _hdr -> dropped.load(std::memory_order_relaxed);
+uint64_t tail = _hdr -> tail.load(std::memory_order_acquire);
+uint64_t head = _hdr -> head.load(std::memory_order_acquire);
+out.used = (head > tail) ? head - tail : 0;
+out.capacity = _capacity;
+return out;
+}
+
+// reader thread worker function (parent): the tail is moved once the record is sent to g3log,
+// so flush() can send its barrier behind the records
+void SharedRing::ReaderWorker()
+{
+std::string rec;
+for(;;) {
+    lockRing();
+    while(_hdr -> head.load(std::memory_order_relaxed) == _hdr -> tail.load(std::memory_order_relaxed) && !_terminate.load()) {
+        _hdr -> readerSleeping = 1;
+        struct timespec wake;
+        clock_gettime(CLOCK_MONOTONIC, &wake);
+        wake.tv_nsec += 100 * 1000 * 1000; // wakes up now and then: a child may die between its write and its signal
+        if(wake.tv_nsec >= 1000 * 1000 * 1000) {
+            wake.tv_sec++;
+            wake.tv_nsec -= 1000 * 1000 * 1000;
+            }
+        if(pthread_cond_timedwait(&_hdr -> readable, &_hdr -> lck, &wake) == EOWNERDEAD) pthread_mutex_consistent(&_hdr -> lck);
+        _hdr -> readerSleeping = 0;
+      }
+    bool last = _terminate.load(); // set under the mutex: head includes every record written before stop()
+    uint64_t head = _hdr -> head.load(std::memory_order_relaxed);
+    unlockRing();
+
+    uint64_t tail = _hdr -> tail.load(std::memory_order_relaxed);
+    while(tail < head) {
+        char sizeBuf[4];
+        for(size_t i = 0; i < sizeof(sizeBuf); i++) sizeBuf[i] = _data[(tail + i) % _capacity];
+        uint32_t size = get<uint32_t>(sizeBuf);
+        if(size < RecHeaderSize || size > head - tail) { // not a record: what remains is skipped
+            tail = head;
+            _hdr -> tail.store(tail, std::memory_order_release);
+            break;
+            }
+        rec.resize(size);
+        size_t offset = tail % _capacity;
+        size_t first = std::min<size_t>(size, _capacity - offset);
+        memcpy(&rec[0], _data + offset, first);
+        memcpy(&rec[0] + first, _data, size - first);
+        captureLimit().waitWorkerRoom(_terminate); // with a capture limit: the record waits in the ring (see overflow.h)
+        sendRecord(rec);
+        tail += size;
+        _hdr -> tail.store(tail, std::memory_order_release);
+        _received.fetch_add(1, std::memory_order_relaxed);
+      }
+    if(last) break;
+  }
+}
+
+} // g3
@@ -0,0 +1,101 @@
+/*
+
+  Shared-memory ring, for the multi-process deployments (prefork servers, multiprocessing with the "fork" start method).
+
+  The parent process starts the ring ( startSharedRing() ) once its sinks are added, before forking its workers.
+  The ring is an anonymous shared mapping, inherited by the children. A reader thread of the parent
+  sends the children's records to the parent's LogWorker: one writer per file, and no sink nor g3log thread
+  in the children.
+
+  In a child (marked "attached" by an at-fork handler), the capture functions write their records into the ring
+  instead of g3log, whose threads don't exist after fork():
+    - get_ifaceLogWorker() returns the inherited interface. Its flush() returns once the parent has read
+      the records written so far, the sink handles and new_Sink() throw (the sinks live in the parent).
+    - the records are complete: call-site, level, timestamp, message (formatted in the child), structured fields,
+      and the child's pid, as a structured field "pid".
+    - a FATAL message is written to the ring, then the child aborts. The parent logs it, without crashing.
+
+  The ring is a byte ring, protected by a robust process-shared mutex: a child dying while it writes
+  does not block the others (its record is not published). When the ring is full, the child waits
+  up to "full_wait_ms" for the parent to read, then drops the message (counted in stats()).
+  Once the parent has stopped reading (stopSharedRing(), or the parent is gone), the children drop
+  their messages at once (counted), without waiting for room in the ring.
+
+  Processes started from scratch ("spawn", "forkserver") don't inherit the ring: they log on their own.
+
+*/
+
+#pragma once
+
+#include "metrics.h"
+#include "staging.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <pthread.h>
+
+namespace g3 {
+
+class SharedRing
+{
+public:
+    static const size_t MinCapacity = 64 * 1024;
+
+    SharedRing() = default;
+    SharedRing(const SharedRing&) = delete;
+    SharedRing &operator=(const SharedRing&) = delete;
+
+    // parent: maps the ring and starts the reader thread. Throws if already started, or in a child.
+    void start(size_t capacity, int full_wait_ms);
+    // parent: reads the records already written, and joins the reader thread. The children's next records are dropped (at once).
+    void stop();
+
+    bool active() const {return _reading.load(std::memory_order_acquire);}; // parent, reader running
+    bool attached() const {return _attached.load(std::memory_order_relaxed);}; // child
+
+    // child: false if the record was dropped
+    bool push(StagedLog &&rec);
+
+    // returns once every record written before the call has been read by the parent and sent to its LogWorker,
+    // or false if the deadline is reached first.
+    bool flush(std::chrono::steady_clock::time_point deadline);
+
+    SharedRingStats stats() const;
+
+    // at-fork handler of the child: the ring becomes the destination of the capture functions
+    void attachChild();
+
+private:
+    struct Header; // at the start of the shared mapping
+
+    bool readerGone() const; // child
+    void lockRing();
+    void unlockRing();
+    void ReaderWorker();
+
+    Header *_hdr = nullptr; // never unmapped: the children may still write
+    char *_data = nullptr;
+    size_t _capacity = 0;
+    int _fullWaitMs = 0;
+    int _pid = 0; // of the child
+
+    std::mutex _startLck;
+    std::atomic<bool> _attached{false};
+    std::atomic<bool> _reading{false};
+    std::atomic<bool> _terminate{false};
+    std::atomic<uint64_t> _received{0};
+    std::thread _readerThd;
+};
+
+// the unique ring. Never destroyed (as the staging ring)
+SharedRing &sharedRing();
+
+// throws in a child attached to the shared ring: "what" needs the g3log threads, or the sinks, of the parent
+void checkNotRingChild(const char *what);
+
+} // g3
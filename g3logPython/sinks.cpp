@@ -1,6 +1,9 @@
 
 #include "intern_log.h"
 #include "g3logPython.h"
+#include "overflow.h"
+#include "render.h"
+#include "shmring.h"
 
 namespace g3 {
     
@@ -13,6 +16,7 @@ pySinkCls
 ifaceLogWorker::SinkHndlAccess<g3logSinkCls, ClbkType, g3logMsgMvr, pySinkCls>::
 new_Sink(const std::string& name, Args... args)
 {
+checkNotRingChild("new_Sink");
 if( (_options & MULT_INSTANCES_ALLOWED) == 0) {
     // some sinks may not allow to be instantiated multiple times, for example syslog.
     if(_userNames.get_size() > 0) throw std::logic_error("new_Sink: this sink can only be instantiated once.");
@@ -21,25 +25,81 @@ if( (_options & MULT_INSTANCES_ALLOWED) == 0) {
 if(!_userNames.reserve(name)) { throw std::logic_error("new_Sink: name already reserved."); }
         
 // Problem: args are destroyed by python whenever it pleases it...
-// so we have to copy the args and store them until the program finishes.
+// so we have to copy the args and store them as long as the sink exists.
 //auto sink = std::make_unique<g3logSinkCls>(std::forward<Args>(args)...); <-- we cannot simply forward the args
 // https://stackoverflow.com/questions/47848910/apply-function-on-each-element-in-parameter-pack
 // NOTE: in practice, after PR
-auto sink = std::make_unique<g3logSinkCls>(store(std::forward<Args>(args))...);
+std::list<std::string> ctorStrings; // kept with the handle: freed together with the sink
+auto sink = std::make_unique<g3logSinkCls>(store(ctorStrings, std::forward<Args>(args))...);
 
-std::unique_ptr<g3::SinkHandle<g3logSinkCls>> g3logHndl(singleton._instance.lock() -> worker.get() -> addSink( std::move(sink), g3logMsgMvr));
+std::shared_ptr<ifaceLogWorker> pworker = singleton._instance.lock();
+// the messages go through the dispatcher before reaching the mover (see dispatch.h)
+auto options = std::make_shared<SinkOptions>();
+options -> metrics.sentAtStart = captureMetrics().sent.sum();
+std::unique_ptr<g3::SinkHandle<g3logSinkCls>> g3logHndl(pworker -> worker.get() -> addSink( std::move(sink), SinkDispatch<g3logSinkCls, ClbkType, g3logMsgMvr>(options)));
+pworker -> _sinkCount.fetch_add(1);
+captureLimit().addSink(options);
+if(sinkSharesLine<g3logSinkCls>()) renderCache().addReader();
     
-sinkkey_t key = _g3logPtrs.insert(std::move(g3logHndl));
+sinkkey_t key = _g3logPtrs.insert(std::move(g3logHndl), std::move(ctorStrings), options);
 _userNames.set_key( name, key);
     
-return pySinkCls(singleton._instance.lock(), key);
+return pySinkCls(pworker, key, options);
 }
       
 // explicit instantiations: (see also worker.cpp)
 template ClrTermSnkHndl ifaceLogWorker::ClrTermSinkIface_t::new_Sink<>(const std::string&);
 template SysLogSnkHndl ifaceLogWorker::SysLogSinkIface_t::new_Sink<const char*>(const std::string&, const char*);
-template LogRotateSnkHndl ifaceLogWorker::LogRotateSinkIface_t::new_Sink<const std::string&, const std::string&>(const std::string&, const std::string&, const std::string&);    
+template LogRotateSnkHndl ifaceLogWorker::LogRotateSinkIface_t::new_Sink<const std::string&, const std::string&>(const std::string&, const std::string&, const std::string&);
+template BinSnkHndl ifaceLogWorker::BinSinkIface_t::new_Sink<const std::string&, const std::string&>(const std::string&, const std::string&, const std::string&);    
+template JournaldSnkHndl ifaceLogWorker::JournaldSinkIface_t::new_Sink<const std::string&>(const std::string&, const std::string&);
+template NetSnkHndl ifaceLogWorker::NetSinkIface_t::new_Sink<const std::string&>(const std::string&, const std::string&);
+template PluginSnkHndl ifaceLogWorker::PluginSinkIface_t::new_Sink<std::shared_ptr<plugin::Sink>>(const std::string&, std::shared_ptr<plugin::Sink>);
+template FlightRecSnkHndl ifaceLogWorker::FlightRecSinkIface_t::new_Sink<size_t, size_t>(const std::string&, size_t, size_t);
 
+
+// ====================================================================
+// =========================== common  ================================
+// ====================================================================
+
+// no round-trip through the sink's thread: the dispatcher reads the option for each message
+void cmmnSinkHndl::setFieldFormat(int format)
+{
+if(format < (int)FieldFormat::TEXT || format > (int)FieldFormat::JSON) throw std::logic_error("setFieldFormat: invalid field format");
+_options -> fieldFormat.store(format, std::memory_order_relaxed);
+}
+
+int cmmnSinkHndl::getFieldFormat()
+{
+return _options -> fieldFormat.load(std::memory_order_relaxed);
+}
+
+void cmmnSinkHndl::setMinLevel(int level_val)
+{
+if(level_val < (int)pyLEVEL::pyDEBUG || level_val > (int)pyLEVEL::pyFATAL) throw std::logic_error("setMinLevel: invalid level");
+_options -> minLevel.store(pyLevelToG3(level_val).value, std::memory_order_relaxed);
+}
+
+int cmmnSinkHndl::getMinLevel()
+{
+int value = _options -> minLevel.load(std::memory_order_relaxed);
+for(int level_val = (int)pyLEVEL::pyDEBUG; level_val < (int)pyLEVEL::pyFATAL; level_val++) 
+    if(value <= pyLevelToG3(level_val).value) return level_val;
+return (int)pyLEVEL::pyFATAL;
+}
+
+// the dispatcher reloads the prefixes when it sees the new version
+void cmmnSinkHndl::setFilePrefixes(const std::vector<std::string> &prefixes)
+{
+std::atomic_store(&_options -> filePrefixes, std::shared_ptr<const std::vector<std::string>>(std::make_shared<std::vector<std::string>>(prefixes)));
+_options -> filterVersion.fetch_add(1, std::memory_order_release);
+}
+
+std::vector<std::string> cmmnSinkHndl::getFilePrefixes()
+{
+std::shared_ptr<const std::vector<std::string>> prefixes = std::atomic_load(&_options -> filePrefixes);
+return prefixes ? *prefixes : std::vector<std::string>();
+}
     
 // ====================================================================
 // =========================== Color Term  ============================
@@ -50,46 +110,49 @@ template LogRotateSnkHndl ifaceLogWorker::LogRotateSinkIface_t::new_Sink<const s
 // ====================================================================
 
 //
-void SysLogSnkHndl::setLogHeader(const char* change)
+SinkCallResult<void> SysLogSnkHndl::setLogHeader(const char* change)
 {
 if(_key == InvalidSinkKey) throw std::logic_error("SysLogSnkHndl::setLogHeader bad key");
 if(change == NULL) throw std::logic_error("SysLogSnkHndl::setLogHeader NULL header string");
 
-auto p_HdrData = std::make_shared<Helper1StrStore> (change);
+auto p_HdrData = make_stored<Helper1StrStore> (change);
 
   { // raii mutex locking with access()
     g3::LockedObj<g3::SinkHandle<g3::SyslogSink> *> MtxPtr = _p_wrkrKeepalive -> SysLogSinks._g3logPtrs.access(_key);
-    p_HdrData -> set_future(MtxPtr.p_hndl -> call(&g3::SyslogSink::setLogHeader, p_HdrData -> c_str()));
+    p_HdrData -> set_future(MtxPtr.p_hndl -> call(completing(p_HdrData, &g3::SyslogSink::setLogHeader), p_HdrData -> c_str()));
   }
 _p_wrkrKeepalive -> Store.store(p_HdrData); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<void>(p_HdrData);
 }
 
 //
-void SysLogSnkHndl::setIdentity(std::string& id)
+SinkCallResult<void> SysLogSnkHndl::setIdentity(std::string& id)
 {   
 if(_key == InvalidSinkKey) throw std::logic_error("SysLogSnkHndl::setIdentity bad key");
 
-auto p_IdData = std::make_shared<Helper1StrStore> (id);
+auto p_IdData = make_stored<Helper1StrStore> (id);
 
   { // raii mutex locking with access() 
      g3::LockedObj<g3::SinkHandle<g3::SyslogSink> *> MtxPtr = _p_wrkrKeepalive -> SysLogSinks._g3logPtrs.access(_key);
-     p_IdData -> set_future(MtxPtr.p_hndl -> call(&g3::SyslogSink::setIdentity, p_IdData -> c_str()));
+     p_IdData -> set_future(MtxPtr.p_hndl -> call(completing(p_IdData, &g3::SyslogSink::setIdentity), p_IdData -> c_str()));
   }
 _p_wrkrKeepalive -> Store.store(p_IdData); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<void>(p_IdData);
 }
 
 //
-void SysLogSnkHndl::echoToStderr()
+SinkCallResult<void> SysLogSnkHndl::echoToStderr()
 {   
 if(_key == InvalidSinkKey) throw std::logic_error("SysLogSnkHndl::setIdentity bad key");
 
-auto p_IdData = std::make_shared<StoredForThd<void>> ();
+auto p_IdData = make_stored<StoredForThd<void>> ();
 
   { // raii mutex locking with access()
     g3::LockedObj<g3::SinkHandle<g3::SyslogSink> *> MtxPtr = _p_wrkrKeepalive -> SysLogSinks._g3logPtrs.access(_key);
-    p_IdData -> set_future(MtxPtr.p_hndl -> call(&g3::SyslogSink::echoToStderr)); 
+    p_IdData -> set_future(MtxPtr.p_hndl -> call(completing(p_IdData, &g3::SyslogSink::echoToStderr))); 
   }
 _p_wrkrKeepalive -> Store.store(p_IdData); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<void>(p_IdData);
 }
 
 
@@ -99,20 +162,492 @@ _p_wrkrKeepalive -> Store.store(p_IdData); // store() locks a mutex: the _key mu
 // ========================== LogRotate ===============================
 // ====================================================================
 
+SinkCallResult<std::string> LogRotateSnkHndl::changeLogFile(const std::string& log_directory, const std::string& new_name)
+{
+if(_key == InvalidSinkKey) throw std::logic_error("LogRotateSnkHndl::changeLogFile bad key");
+
+auto p_Data = make_stored<StoredForThd<std::string>> (); // the strings are copied by call()
+
+  { // raii mutex locking with access()
+    g3::LockedObj<g3::SinkHandle<g3::RotatingLogFile> *> MtxPtr = _p_wrkrKeepalive -> LogRotateSinks._g3logPtrs.access(_key);
+    p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &g3::RotatingLogFile::changeLogFile), log_directory, new_name)); 
+  }
+_p_wrkrKeepalive -> Store.store(p_Data); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<std::string>(p_Data);
+}
 
-void LogRotateSnkHndl::setMaxArchiveLogCount(int max_size)
+SinkCallResult<std::string> LogRotateSnkHndl::logFileName()
+{
+if(_key == InvalidSinkKey) throw std::logic_error("LogRotateSnkHndl::logFileName bad key");
+
+auto p_Data = make_stored<StoredForThd<std::string>> ();
+
+  { // raii mutex locking with access()
+    g3::LockedObj<g3::SinkHandle<g3::RotatingLogFile> *> MtxPtr = _p_wrkrKeepalive -> LogRotateSinks._g3logPtrs.access(_key);
+    p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &LogRotate::logFileName))); 
+  }
+_p_wrkrKeepalive -> Store.store(p_Data); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<std::string>(p_Data);
+}
+
+SinkCallResult<int> LogRotateSnkHndl::getMaxArchiveLogCount()
+{
+if(_key == InvalidSinkKey) throw std::logic_error("LogRotateSnkHndl::getMaxArchiveLogCount bad key");
+
+auto p_Data = make_stored<StoredForThd<int>> ();
+
+  { // raii mutex locking with access()
+    g3::LockedObj<g3::SinkHandle<g3::RotatingLogFile> *> MtxPtr = _p_wrkrKeepalive -> LogRotateSinks._g3logPtrs.access(_key);
+    p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &LogRotate::getMaxArchiveLogCount))); 
+  }
+_p_wrkrKeepalive -> Store.store(p_Data); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<int>(p_Data);
+}
+
+SinkCallResult<int> LogRotateSnkHndl::getMaxLogSize()
+{
+if(_key == InvalidSinkKey) throw std::logic_error("LogRotateSnkHndl::getMaxLogSize bad key");
+
+auto p_Data = make_stored<StoredForThd<int>> ();
+
+  { // raii mutex locking with access()
+    g3::LockedObj<g3::SinkHandle<g3::RotatingLogFile> *> MtxPtr = _p_wrkrKeepalive -> LogRotateSinks._g3logPtrs.access(_key);
+    p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &g3::RotatingLogFile::getMaxLogSize))); 
+  }
+_p_wrkrKeepalive -> Store.store(p_Data); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<int>(p_Data);
+}
+
+SinkCallResult<void> LogRotateSnkHndl::flush()
+{
+if(_key == InvalidSinkKey) throw std::logic_error("LogRotateSnkHndl::flush bad key");
+
+auto p_Data = make_stored<StoredForThd<void>> ();
+
+  { // raii mutex locking with access()
+    g3::LockedObj<g3::SinkHandle<g3::RotatingLogFile> *> MtxPtr = _p_wrkrKeepalive -> LogRotateSinks._g3logPtrs.access(_key);
+    p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &LogRotate::flush))); 
+  }
+_p_wrkrKeepalive -> Store.store(p_Data); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<void>(p_Data);
+}
+
+SinkCallResult<void> LogRotateSnkHndl::setMaxArchiveLogCount(int max_size)
 {
 if(_key == InvalidSinkKey) throw std::logic_error("SysLogSnkHndl::setIdentity bad key");
 
-auto p_IdData = std::make_shared<StoredForThd<void>> (); // nothing to store, as the data (max_size) is a simple int
+auto p_IdData = make_stored<StoredForThd<void>> (); // nothing to store, as the data (max_size) is a simple int
 
   { // raii mutex locking with access()
-    g3::LockedObj<g3::SinkHandle<LogRotate> *> MtxPtr = _p_wrkrKeepalive -> LogRotateSinks._g3logPtrs.access(_key);
-    p_IdData -> set_future(MtxPtr.p_hndl -> call(&LogRotate::setMaxArchiveLogCount, max_size)); 
+    g3::LockedObj<g3::SinkHandle<g3::RotatingLogFile> *> MtxPtr = _p_wrkrKeepalive -> LogRotateSinks._g3logPtrs.access(_key);
+    p_IdData -> set_future(MtxPtr.p_hndl -> call(completing(p_IdData, &LogRotate::setMaxArchiveLogCount), max_size)); 
   }
 _p_wrkrKeepalive -> Store.store(p_IdData); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<void>(p_IdData);
+}
+
+SinkCallResult<void> LogRotateSnkHndl::setFlushPolicy(size_t flush_policy)
+{
+if(_key == InvalidSinkKey) throw std::logic_error("LogRotateSnkHndl::setFlushPolicy bad key");
+
+auto p_Data = make_stored<StoredForThd<void>> ();
+
+  { // raii mutex locking with access()
+    g3::LockedObj<g3::SinkHandle<g3::RotatingLogFile> *> MtxPtr = _p_wrkrKeepalive -> LogRotateSinks._g3logPtrs.access(_key);
+    p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &LogRotate::setFlushPolicy), flush_policy)); 
+  }
+_p_wrkrKeepalive -> Store.store(p_Data); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<void>(p_Data);
+}
+
+SinkCallResult<void> LogRotateSnkHndl::setMaxLogSize(int max_file_size_in_bytes)
+{
+if(_key == InvalidSinkKey) throw std::logic_error("LogRotateSnkHndl::setMaxLogSize bad key");
+if(max_file_size_in_bytes <= 0) throw std::logic_error("LogRotateSnkHndl::setMaxLogSize: the size must be positive");
+
+auto p_Data = make_stored<StoredForThd<void>> ();
+
+  { // raii mutex locking with access()
+    g3::LockedObj<g3::SinkHandle<g3::RotatingLogFile> *> MtxPtr = _p_wrkrKeepalive -> LogRotateSinks._g3logPtrs.access(_key);
+    p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &g3::RotatingLogFile::setMaxLogSize), max_file_size_in_bytes)); 
+  }
+_p_wrkrKeepalive -> Store.store(p_Data); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<void>(p_Data);
+}
+
+SinkCallResult<void> LogRotateSnkHndl::setCompression(bool compress)
+{
+if(_key == InvalidSinkKey) throw std::logic_error("LogRotateSnkHndl::setCompression bad key");
+
+auto p_Data = make_stored<StoredForThd<void>> ();
+
+  { // raii mutex locking with access()
+    g3::LockedObj<g3::SinkHandle<g3::RotatingLogFile> *> MtxPtr = _p_wrkrKeepalive -> LogRotateSinks._g3logPtrs.access(_key);
+    p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &g3::RotatingLogFile::setCompression), compress)); 
+  }
+_p_wrkrKeepalive -> Store.store(p_Data); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<void>(p_Data);
+}
+
+SinkCallResult<bool> LogRotateSnkHndl::getCompression()
+{
+if(_key == InvalidSinkKey) throw std::logic_error("LogRotateSnkHndl::getCompression bad key");
+
+auto p_Data = make_stored<StoredForThd<bool>> ();
+
+  { // raii mutex locking with access()
+    g3::LockedObj<g3::SinkHandle<g3::RotatingLogFile> *> MtxPtr = _p_wrkrKeepalive -> LogRotateSinks._g3logPtrs.access(_key);
+    p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &g3::RotatingLogFile::getCompression))); 
+  }
+_p_wrkrKeepalive -> Store.store(p_Data); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<bool>(p_Data);
+}
+
+SinkCallResult<std::string> LogRotateSnkHndl::rotate()
+{
+if(_key == InvalidSinkKey) throw std::logic_error("LogRotateSnkHndl::rotate bad key");
+
+auto p_Data = make_stored<StoredForThd<std::string>> ();
+
+  { // raii mutex locking with access()
+    g3::LockedObj<g3::SinkHandle<g3::RotatingLogFile> *> MtxPtr = _p_wrkrKeepalive -> LogRotateSinks._g3logPtrs.access(_key);
+    p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &g3::RotatingLogFile::rotate))); 
+  }
+_p_wrkrKeepalive -> Store.store(p_Data); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<std::string>(p_Data);
+}
+
+
+
+// ====================================================================
+// ========================= ColorTerm ================================
+// ====================================================================
+
+SinkCallResult<void> ClrTermSnkHndl::setBufferPolicy(size_t max_bytes, int max_delay_ms)
+{
+if(_key == InvalidSinkKey) throw std::logic_error("ClrTermSnkHndl::setBufferPolicy bad key");
+
+auto p_Data = make_stored<StoredForThd<void>> (); // nothing to store, simple ints
+
+  { // raii mutex locking with access()
+    g3::LockedObj<g3::SinkHandle<g3::ColorTermSink> *> MtxPtr = _p_wrkrKeepalive -> ClrTermSinks._g3logPtrs.access(_key);
+    p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &g3::ColorTermSink::setBufferPolicy), max_bytes, max_delay_ms)); 
+  }
+_p_wrkrKeepalive -> Store.store(p_Data); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<void>(p_Data);
+}
+
+SinkCallResult<void> ClrTermSnkHndl::flush()
+{
+if(_key == InvalidSinkKey) throw std::logic_error("ClrTermSnkHndl::flush bad key");
+
+auto p_Data = make_stored<StoredForThd<void>> ();
+
+  { // raii mutex locking with access()
+    g3::LockedObj<g3::SinkHandle<g3::ColorTermSink> *> MtxPtr = _p_wrkrKeepalive -> ClrTermSinks._g3logPtrs.access(_key);
+    p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &g3::ColorTermSink::flush))); 
+  }
+_p_wrkrKeepalive -> Store.store(p_Data); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<void>(p_Data);
+}
+
+// ====================================================================
+// =========================== Binary =================================
+// ====================================================================
+
+SinkCallResult<void> BinSnkHndl::setSegmentSize(size_t bytes)
+{
+if(_key == InvalidSinkKey) throw std::logic_error("BinSnkHndl::setSegmentSize bad key");
+
+auto p_Data = make_stored<StoredForThd<void>> ();
+
+  { // raii mutex locking with access()
+    g3::LockedObj<g3::SinkHandle<g3::BinarySink> *> MtxPtr = _p_wrkrKeepalive -> BinSinks._g3logPtrs.access(_key);
+    p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &g3::BinarySink::setSegmentSize), bytes)); 
+  }
+_p_wrkrKeepalive -> Store.store(p_Data); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<void>(p_Data);
+}
+
+SinkCallResult<std::string> BinSnkHndl::segmentName()
+{
+if(_key == InvalidSinkKey) throw std::logic_error("BinSnkHndl::segmentName bad key");
+
+auto p_Data = make_stored<StoredForThd<std::string>> ();
+
+  { // raii mutex locking with access()
+    g3::LockedObj<g3::SinkHandle<g3::BinarySink> *> MtxPtr = _p_wrkrKeepalive -> BinSinks._g3logPtrs.access(_key);
+    p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &g3::BinarySink::segmentName))); 
+  }
+_p_wrkrKeepalive -> Store.store(p_Data); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<std::string>(p_Data);
+}
+
+SinkCallResult<void> BinSnkHndl::flush()
+{
+if(_key == InvalidSinkKey) throw std::logic_error("BinSnkHndl::flush bad key");
+
+auto p_Data = make_stored<StoredForThd<void>> ();
+
+  { // raii mutex locking with access()
+    g3::LockedObj<g3::SinkHandle<g3::BinarySink> *> MtxPtr = _p_wrkrKeepalive -> BinSinks._g3logPtrs.access(_key);
+    p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &g3::BinarySink::flush))); 
+  }
+_p_wrkrKeepalive -> Store.store(p_Data); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<void>(p_Data);
 }
 
+// ====================================================================
+// =========================== Journald ===============================
+// ====================================================================
+
+SinkCallResult<void> JournaldSnkHndl::setIdentifier(const std::string &identifier)
+{
+if(_key == InvalidSinkKey) throw std::logic_error("JournaldSnkHndl::setIdentifier bad key");
+
+auto p_Data = make_stored<StoredForThd<void>> ();
+
+  { // raii mutex locking with access()
+    g3::LockedObj<g3::SinkHandle<g3::JournaldSink> *> MtxPtr = _p_wrkrKeepalive -> JournaldSinks._g3logPtrs.access(_key);
+    p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &g3::JournaldSink::setIdentifier), identifier)); 
+  }
+_p_wrkrKeepalive -> Store.store(p_Data); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<void>(p_Data);
+}
+
+SinkCallResult<std::string> JournaldSnkHndl::identifier()
+{
+if(_key == InvalidSinkKey) throw std::logic_error("JournaldSnkHndl::identifier bad key");
+
+auto p_Data = make_stored<StoredForThd<std::string>> ();
+
+  { // raii mutex locking with access()
+    g3::LockedObj<g3::SinkHandle<g3::JournaldSink> *> MtxPtr = _p_wrkrKeepalive -> JournaldSinks._g3logPtrs.access(_key);
+    p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &g3::JournaldSink::identifier))); 
+  }
+_p_wrkrKeepalive -> Store.store(p_Data); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<std::string>(p_Data);
+}
+
+// ====================================================================
+// ============================= Net ==================================
+// ====================================================================
+
+SinkCallResult<void> NetSnkHndl::setBatchPolicy(size_t max_bytes, int max_delay_ms)
+{
+if(_key == InvalidSinkKey) throw std::logic_error("NetSnkHndl::setBatchPolicy bad key");
+
+auto p_Data = make_stored<StoredForThd<void>> ();
+
+  { // raii mutex locking with access()
+    g3::LockedObj<g3::SinkHandle<g3::NetSink> *> MtxPtr = _p_wrkrKeepalive -> NetSinks._g3logPtrs.access(_key);
+    p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &g3::NetSink::setBatchPolicy), max_bytes, max_delay_ms)); 
+  }
+_p_wrkrKeepalive -> Store.store(p_Data); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<void>(p_Data);
+}
+
+SinkCallResult<void> NetSnkHndl::setSpillPolicy(size_t max_spill_bytes, const std::string &overflow_prefix, const std::string &overflow_directory)
+{
+if(_key == InvalidSinkKey) throw std::logic_error("NetSnkHndl::setSpillPolicy bad key");
+
+auto p_Data = make_stored<StoredForThd<void>> ();
 
+  { // raii mutex locking with access()
+    g3::LockedObj<g3::SinkHandle<g3::NetSink> *> MtxPtr = _p_wrkrKeepalive -> NetSinks._g3logPtrs.access(_key);
+    p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &g3::NetSink::setSpillPolicy), max_spill_bytes, overflow_prefix, overflow_directory)); 
+  }
+_p_wrkrKeepalive -> Store.store(p_Data); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<void>(p_Data);
+}
+
+SinkCallResult<void> NetSnkHndl::flush()
+{
+if(_key == InvalidSinkKey) throw std::logic_error("NetSnkHndl::flush bad key");
+
+auto p_Data = make_stored<StoredForThd<void>> ();
+
+  { // raii mutex locking with access()
+    g3::LockedObj<g3::SinkHandle<g3::NetSink> *> MtxPtr = _p_wrkrKeepalive -> NetSinks._g3logPtrs.access(_key);
+    p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &g3::NetSink::flush))); 
+  }
+_p_wrkrKeepalive -> Store.store(p_Data); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<void>(p_Data);
+}
+
+SinkCallResult<std::string> NetSnkHndl::address()
+{
+if(_key == InvalidSinkKey) throw std::logic_error("NetSnkHndl::address bad key");
+
+auto p_Data = make_stored<StoredForThd<std::string>> ();
+
+  { // raii mutex locking with access()
+    g3::LockedObj<g3::SinkHandle<g3::NetSink> *> MtxPtr = _p_wrkrKeepalive -> NetSinks._g3logPtrs.access(_key);
+    p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &g3::NetSink::address))); 
+  }
+_p_wrkrKeepalive -> Store.store(p_Data); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<std::string>(p_Data);
+}
+
+SinkCallResult<std::map<std::string, uint64_t>> NetSnkHndl::counters()
+{
+if(_key == InvalidSinkKey) throw std::logic_error("NetSnkHndl::counters bad key");
+
+auto p_Data = make_stored<StoredForThd<std::map<std::string, uint64_t>>> ();
+
+  { // raii mutex locking with access()
+    g3::LockedObj<g3::SinkHandle<g3::NetSink> *> MtxPtr = _p_wrkrKeepalive -> NetSinks._g3logPtrs.access(_key);
+    p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &g3::NetSink::counters))); 
+  }
+_p_wrkrKeepalive -> Store.store(p_Data); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<std::map<std::string, uint64_t>>(p_Data);
+}
+
+// ====================================================================
+// ============================ Plugin ================================
+// ====================================================================
+
+SinkCallResult<std::string> PluginSnkHndl::control(const std::string &command)
+{
+if(_key == InvalidSinkKey) throw std::logic_error("PluginSnkHndl::control bad key");
+
+auto p_Data = make_stored<StoredForThd<std::string>> ();
+
+  { // raii mutex locking with access()
+    g3::LockedObj<g3::SinkHandle<g3::PluginSink> *> MtxPtr = _p_wrkrKeepalive -> PluginSinks._g3logPtrs.access(_key);
+    p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &g3::PluginSink::control), command)); 
+  }
+_p_wrkrKeepalive -> Store.store(p_Data); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<std::string>(p_Data);
+}
+
+SinkCallResult<void> PluginSnkHndl::flush()
+{
+if(_key == InvalidSinkKey) throw std::logic_error("PluginSnkHndl::flush bad key");
+
+auto p_Data = make_stored<StoredForThd<void>> ();
+
+  { // raii mutex locking with access()
+    g3::LockedObj<g3::SinkHandle<g3::PluginSink> *> MtxPtr = _p_wrkrKeepalive -> PluginSinks._g3logPtrs.access(_key);
+    p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &g3::PluginSink::flush))); 
+  }
+_p_wrkrKeepalive -> Store.store(p_Data); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<void>(p_Data);
+}
+
+// ====================================================================
+// ======================== Flight recorder ===========================
+// ====================================================================
+
+// the LogRotate sink's handle is looked up on each dump: a removed sink fails the dump (stale key), without dangling.
+// The ifaceLogWorker outlives the sink threads (its LogWorker is destroyed first): the raw pointer is enough.
+FlightRecorderSink::Output FlightRecSnkHndl::logRotateOutput(const LogRotateSnkHndl &target)
+{
+if(target._key == InvalidSinkKey) throw std::logic_error("FlightRecSnkHndl: bad LogRotate key");
+ifaceLogWorker *worker = _p_wrkrKeepalive.get();
+sinkkey_t key = target._key;
+return [worker, key](std::string text) {
+    g3::LockedObj<g3::SinkHandle<g3::RotatingLogFile> *> MtxPtr = worker -> LogRotateSinks._g3logPtrs.access(key);
+    MtxPtr.p_hndl -> call(&g3::RotatingLogFile::save, std::move(text)); // written on the LogRotate sink's thread
+    };
+}
+
+SinkCallResult<std::string> FlightRecSnkHndl::dump()
+{
+if(_key == InvalidSinkKey) throw std::logic_error("FlightRecSnkHndl::dump bad key");
+
+auto p_Data = make_stored<StoredForThd<std::string>> ();
+
+  { // raii mutex locking with access()
+    g3::LockedObj<g3::SinkHandle<g3::FlightRecorderSink> *> MtxPtr = _p_wrkrKeepalive -> FlightRecSinks._g3logPtrs.access(_key);
+    p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &g3::FlightRecorderSink::dump))); 
+  }
+_p_wrkrKeepalive -> Store.store(p_Data); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<std::string>(p_Data);
+}
+
+SinkCallResult<std::string> FlightRecSnkHndl::dumpToFile(const std::string &path)
+{
+if(_key == InvalidSinkKey) throw std::logic_error("FlightRecSnkHndl::dumpToFile bad key");
+
+auto p_Data = make_stored<StoredForThd<std::string>> ();
+
+  { // raii mutex locking with access()
+    g3::LockedObj<g3::SinkHandle<g3::FlightRecorderSink> *> MtxPtr = _p_wrkrKeepalive -> FlightRecSinks._g3logPtrs.access(_key);
+    p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &g3::FlightRecorderSink::dumpToFile), path)); 
+  }
+_p_wrkrKeepalive -> Store.store(p_Data); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<std::string>(p_Data);
+}
+
+SinkCallResult<void> FlightRecSnkHndl::dumpToSink(const LogRotateSnkHndl &target)
+{
+if(_key == InvalidSinkKey) throw std::logic_error("FlightRecSnkHndl::dumpToSink bad key");
+
+auto p_Data = make_stored<StoredForThd<void>> ();
+
+  { // raii mutex locking with access()
+    g3::LockedObj<g3::SinkHandle<g3::FlightRecorderSink> *> MtxPtr = _p_wrkrKeepalive -> FlightRecSinks._g3logPtrs.access(_key);
+    p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &g3::FlightRecorderSink::dumpToSink), logRotateOutput(target))); 
+  }
+_p_wrkrKeepalive -> Store.store(p_Data); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<void>(p_Data);
+}
+
+SinkCallResult<void> FlightRecSnkHndl::setDumpFile(const std::string &path)
+{
+if(_key == InvalidSinkKey) throw std::logic_error("FlightRecSnkHndl::setDumpFile bad key");
+
+auto p_Data = make_stored<StoredForThd<void>> ();
+
+  { // raii mutex locking with access()
+    g3::LockedObj<g3::SinkHandle<g3::FlightRecorderSink> *> MtxPtr = _p_wrkrKeepalive -> FlightRecSinks._g3logPtrs.access(_key);
+    p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &g3::FlightRecorderSink::setDumpFile), path)); 
+  }
+_p_wrkrKeepalive -> Store.store(p_Data); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<void>(p_Data);
+}
+
+SinkCallResult<void> FlightRecSnkHndl::setDumpSink(const LogRotateSnkHndl *target)
+{
+if(_key == InvalidSinkKey) throw std::logic_error("FlightRecSnkHndl::setDumpSink bad key");
+
+auto p_Data = make_stored<StoredForThd<void>> ();
+
+  { // raii mutex locking with access()
+    g3::LockedObj<g3::SinkHandle<g3::FlightRecorderSink> *> MtxPtr = _p_wrkrKeepalive -> FlightRecSinks._g3logPtrs.access(_key);
+    p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &g3::FlightRecorderSink::setDumpSink), target ? logRotateOutput(*target) : FlightRecorderSink::Output())); 
+  }
+_p_wrkrKeepalive -> Store.store(p_Data); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<void>(p_Data);
+}
+
+SinkCallResult<void> FlightRecSnkHndl::clear()
+{
+if(_key == InvalidSinkKey) throw std::logic_error("FlightRecSnkHndl::clear bad key");
+
+auto p_Data = make_stored<StoredForThd<void>> ();
+
+  { // raii mutex locking with access()
+    g3::LockedObj<g3::SinkHandle<g3::FlightRecorderSink> *> MtxPtr = _p_wrkrKeepalive -> FlightRecSinks._g3logPtrs.access(_key);
+    p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &g3::FlightRecorderSink::clear))); 
+  }
+_p_wrkrKeepalive -> Store.store(p_Data); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<void>(p_Data);
+}
+
+SinkCallResult<std::map<std::string, uint64_t>> FlightRecSnkHndl::counters()
+{
+if(_key == InvalidSinkKey) throw std::logic_error("FlightRecSnkHndl::counters bad key");
+
+auto p_Data = make_stored<StoredForThd<std::map<std::string, uint64_t>>> ();
+
+  { // raii mutex locking with access()
+    g3::LockedObj<g3::SinkHandle<g3::FlightRecorderSink> *> MtxPtr = _p_wrkrKeepalive -> FlightRecSinks._g3logPtrs.access(_key);
+    p_Data -> set_future(MtxPtr.p_hndl -> call(completing(p_Data, &g3::FlightRecorderSink::counters))); 
+  }
+_p_wrkrKeepalive -> Store.store(p_Data); // store() locks a mutex: the _key mutex should be unlocked to avoid deadlocks
+return SinkCallResult<std::map<std::string, uint64_t>>(p_Data);
+}
 
 } // g3
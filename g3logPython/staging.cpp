@@ -0,0 +1,258 @@
+//
+//  implementation of class StagingRing
+//
+// See the description in staging.h.
+// The ring cells each carry a sequence number, telling if the cell is free for the
+// producer at position "pos" (seq == pos), or holds the record written at position "pos" (seq == pos + 1).
+// Producers and consumers reserve a position with a CAS on _enqPos / _deqPos.
+//
+
+#include "intern_log.h"
+#include "g3logPython.h"
+#include "metrics.h"
+#include "overflow.h"
+#include "render.h"
+#include "shmring.h"
+#include "staging.h"
+
+#include <stdexcept>
+
+namespace g3 {
+
+StagingRing &stagingRing()
+{
+static StagingRing *ring = new StagingRing();
+return *ring;
+}
+
+void pushStaged(StagedLog &&rec)
+{
+std::unique_ptr<LogMessage> msg;
+if(rec.site_id >= 0) {
+    const CallSite &site = callSites().get(rec.site_id);
+    msg.reset(new LogMessage(site.file, site.line, site.function, pyLevelToG3(rec.level_val)));
+} else {
+    msg.reset(new LogMessage(std::move(rec.file), rec.line, std::move(rec.function), pyLevelToG3(rec.level_val)));
+}
+msg -> _timestamp = wallTime(rec.timestamp);
+msg -> _call_thread_id = rec.thread_id;
+if(rec.args.empty()) msg -> write() = std::move(rec.message);
+else msg -> write() = formatDeferred(rec.message, rec.args);
+if(!rec.fields.empty() || rec.context) msg -> _expression = encodeFields(rec.fields, rec.context.get());
+renderCache().tag(*msg);
+g3::internal::pushMessageToLogger(LogMessagePtr(std::move(msg)));
+captureMetrics().sent.add();
+}
+
+void stageOrPush(StagedLog &&rec)
+{
+captureMetrics().captured[rec.level_val].add(); // a regular level
+if(!rec.context) rec.context = currentContext(); // set by receivelog_batch(), read with the GIL held
+SharedRing &shared = sharedRing();
+if(shared.attached()) { // a child process: its parent logs the record
+    shared.push(std::move(rec));
+    return;
+    }
+if(!captureLimit().admit()) return; // dropped by the overflow policy (counted)
+StagingRing &ring = stagingRing();
+if(ring.active() && ring.push(std::move(rec))) return;
+pushStaged(std::move(rec));
+}
+
+void StagingRing::start(size_t capacity, size_t max_bytes)
+{
+std::lock_guard<std::mutex> lock(_startLck);
+if(active()) throw std::logic_error("startStaging: staging already started");
+
+size_t size = 2;
+while(size < capacity) size <<= 1;
+
+_cells.reset(new Cell[size]);
+for(size_t i = 0; i < size; i++) _cells[i].seq.store(i, std::memory_order_relaxed);
+_mask = size - 1;
+_enqPos.store(0, std::memory_order_relaxed);
+_deqPos.store(0, std::memory_order_relaxed);
+_stagedBytes.store(0, std::memory_order_relaxed);
+_sentCount.store(0, std::memory_order_relaxed);
+_maxBytes = max_bytes;
+_terminate = false;
+
+_drainerThd = std::thread(&g3::StagingRing::DrainerWorker, this);
+_active.store(true, std::memory_order_release);
+}
+
+void StagingRing::stop()
+{
+std::lock_guard<std::mutex> lock(_startLck);
+if(!active()) return;
+
+_active.store(false, std::memory_order_seq_cst);
+// a producer may have seen _active == true just before: wait until it has pushed its record
+while(_producers.load(std::memory_order_seq_cst) > 0) std::this_thread::yield();
+
+  { // the drainer empties the ring before exiting
+    std::lock_guard<std::mutex> wakelock(_wakeLck);
+    _terminate = true;
+    _wakeCv.notify_one();
+  }
+_drainerThd.join();
+_cells.reset();
+}
+
+bool StagingRing::push(StagedLog &&rec)
+{
+_producers.fetch_add(1, std::memory_order_seq_cst);
+if(!_active.load(std::memory_order_seq_cst)) { // pairs with stop()
+    _producers.fetch_sub(1, std::memory_order_release);
+    return false;
+    }
+
+size_t bytes = rec.bytes();
+if(_stagedBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes > _maxBytes) {
+    _stagedBytes.fetch_sub(bytes, std::memory_order_relaxed);
+    _producers.fetch_sub(1, std::memory_order_release);
+    return false;
+    }
+
+Cell *cell;
+size_t pos = _enqPos.load(std::memory_order_relaxed);
+for(;;) {
+    cell = &_cells[pos & _mask];
+    size_t seq = cell -> seq.load(std::memory_order_acquire);
+    intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+    if(dif == 0) {
+        if(_enqPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+    } else if(dif < 0) {
+        // full
+        _stagedBytes.fetch_sub(bytes, std::memory_order_relaxed);
+        _producers.fetch_sub(1, std::memory_order_release);
+        return false;
+    } else {
+        pos = _enqPos.load(std::memory_order_relaxed);
+    }
+  }
+
+cell -> rec = std::move(rec);
+cell -> seq.store(pos + 1, std::memory_order_release);
+_producers.fetch_sub(1, std::memory_order_release);
+
+wake_drainer();
+return true;
+}
+
+bool StagingRing::pop(StagedLog &out)
+{
+Cell *cell;
+size_t pos = _deqPos.load(std::memory_order_relaxed);
+for(;;) {
+    cell = &_cells[pos & _mask];
+    size_t seq = cell -> seq.load(std::memory_order_acquire);
+    intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+    if(dif == 0) {
+        if(_deqPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+    } else if(dif < 0) {
+        return false; // empty
+    } else {
+        pos = _deqPos.load(std::memory_order_relaxed);
+    }
+  }
+
+out = std::move(cell -> rec);
+cell -> seq.store(pos + _mask + 1, std::memory_order_release);
+_stagedBytes.fetch_sub(out.bytes(), std::memory_order_relaxed);
+return true;
+}
+
+bool StagingRing::empty()
+{
+size_t pos = _deqPos.load(std::memory_order_relaxed);
+return _cells[pos & _mask].seq.load(std::memory_order_acquire) != pos + 1;
+}
+
+bool StagingRing::dropOldest()
+{
+_producers.fetch_add(1, std::memory_order_seq_cst); // no stop() while the cell is read, as in push()
+if(!_active.load(std::memory_order_seq_cst)) {
+    _producers.fetch_sub(1, std::memory_order_release);
+    return false;
+    }
+StagedLog rec;
+bool dropped = pop(rec);
+if(dropped) _sentCount.fetch_add(1, std::memory_order_release); // not waited for by flush()
+_producers.fetch_sub(1, std::memory_order_release);
+return dropped;
+}
+
+void StagingRing::drain()
+{
+_producers.fetch_add(1, std::memory_order_seq_cst); // no stop() while the cells are read, as in push()
+if(!_active.load(std::memory_order_seq_cst)) {
+    _producers.fetch_sub(1, std::memory_order_release);
+    return;
+    }
+StagedLog rec;
+while(pop(rec)) {
+    pushStaged(std::move(rec));
+    _sentCount.fetch_add(1, std::memory_order_release);
+    }
+_producers.fetch_sub(1, std::memory_order_release);
+}
+
+bool StagingRing::flush(std::chrono::steady_clock::time_point deadline)
+{
+std::lock_guard<std::mutex> lock(_startLck); // no stop() meanwhile
+if(!active()) return true;
+
+// every position reserved so far holds a record, or will soon
+size_t target = _enqPos.load(std::memory_order_seq_cst);
+for(;;) {
+    drain();
+    if(_sentCount.load(std::memory_order_acquire) >= target) return true;
+    // a record is being written by its producer, or sent by the drainer
+    if(std::chrono::steady_clock::now() >= deadline) return false;
+    std::this_thread::yield();
+  }
+}
+
+size_t StagingRing::staged() const
+{
+size_t deq = _deqPos.load(std::memory_order_relaxed);
+size_t enq = _enqPos.load(std::memory_order_relaxed);
+return (enq > deq) ? enq - deq : 0;
+}
+
+// the drainer sets _drainerSleeping before checking the ring a last time,
+// and the producers check it after publishing their record:
+// with the fences, at least one of them sees the other's write, so no wake-up is lost.
+void StagingRing::wake_drainer()
+{
+std::atomic_thread_fence(std::memory_order_seq_cst);
+if(_drainerSleeping.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> lock(_wakeLck);
+    _wakeCv.notify_one();
+    }
+}
+
+// drainer thread worker function
+void StagingRing::DrainerWorker()
+{
+StagedLog rec;
+for(;;) {
+    while(!empty()) {
+        // with a capture limit, what the sinks have no room for stays in the ring (see overflow.h)
+        captureLimit().waitWorkerRoom(_terminate);
+        if(!pop(rec)) break;
+        pushStaged(std::move(rec));
+        _sentCount.fetch_add(1, std::memory_order_release);
+        }
+
+    std::unique_lock<std::mutex> lock(_wakeLck);
+    _drainerSleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    _wakeCv.wait(lock, [this]{return _terminate || !empty();});
+    _drainerSleeping.store(false, std::memory_order_relaxed);
+    if(_terminate && empty()) break;
+  }
+}
+
+} // g3
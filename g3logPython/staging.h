@@ -0,0 +1,150 @@
+/*
+
+  Asynchronous capture ("staging") of log messages.
+
+  When staging is started, the capture functions (receivelog...) only copy the
+  message and its call-site into a bounded lock-free ring, and return immediately
+  to the caller (the GIL is only held for that copy).
+  A drainer thread then builds the g3log LogMessages and feeds them to the LogWorker.
+
+  Memory bound:
+    at most "capacity" records (rounded up to a power of 2) and "max_bytes" bytes of
+    strings (file + function + message) are staged at any time. The ring itself is
+    allocated once, on startStaging(). When either limit is reached, the caller
+    falls back to the synchronous path: messages are never dropped.
+
+  FATAL messages are never staged: they flush the ring and go through g3log's fatal path.
+  
+  With a capture limit (see overflow.h), the drainer only sends the records while the sinks have room
+  for them: the others wait in the ring, where the DROP_OLDEST policy finds them.
+
+*/
+
+#pragma once
+
+#include <g3log/logmessage.hpp>
+
+#include "context.h"
+#include "fields.h"
+#include "format.h"
+#include "timestamp.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace g3 {
+
+// a log record copied on the caller's thread, the LogMessage is built later by the drainer thread.
+struct StagedLog
+{
+    StagedLog() = default;
+    // the timestamp and the thread id are those of the caller
+    StagedLog(std::string file_, std::string function_, std::string &&message_, int line_, int level_val_):
+        StagedLog(std::move(file_), std::move(function_), std::move(message_), line_, level_val_, captureNow(), std::this_thread::get_id()) {};
+    StagedLog(std::string file_, std::string function_, std::string &&message_, int line_, int level_val_, CaptureTime timestamp_, std::thread::id thread_id_):
+        file(std::move(file_)), function(std::move(function_)), message(std::move(message_)), line(line_), level_val(level_val_), timestamp(timestamp_), thread_id(thread_id_) {};
+    
+    std::string file;
+    std::string function;
+    std::string message;
+    int line = 0;
+    int level_val = 0; // pyLEVEL
+    CaptureTime timestamp; // taken on the caller's thread, from the selected source (see timestamp.h)
+    std::thread::id thread_id; // the caller's thread
+    int site_id = -1; // when >= 0: the call-site is given by this registered id, and file, function, line are not set
+    std::vector<LogValue> args; // when not empty: message is a template, formatted in pushStaged() (see format.h)
+    std::vector<LogField> fields; // structured fields (see fields.h), rendered by the sinks
+    std::shared_ptr<const ContextBlock> context; // the logging context of the caller (see context.h), nullptr: none
+
+    size_t bytes() const {
+        size_t total = file.size() + function.size() + message.size();
+        for(auto &arg: args) total += arg.bytes();
+        for(auto &field: fields) total += field.bytes();
+        return total;
+        };
+};
+
+// builds the LogMessage of a staged record (formatting its message if needed), and sends it to g3log
+void pushStaged(StagedLog &&rec);
+
+// sends a record to the staging ring if it is started (and not full), or directly to g3log
+void stageOrPush(StagedLog &&rec);
+
+//
+// bounded multi-producer multi-consumer ring (D. Vyukov's algorithm),
+// with one drainer thread.
+//
+class StagingRing
+{
+public:
+    StagingRing(): _active(false), _producers(0), _stagedBytes(0), _maxBytes(0), _sentCount(0), _mask(0), _enqPos(0), _deqPos(0), _terminate(false), _drainerSleeping(false) {};
+    ~StagingRing() {stop();};
+    StagingRing(const StagingRing&) = delete;
+    StagingRing &operator=(const StagingRing&) = delete;
+
+    void start(size_t capacity, size_t max_bytes); // throws if already started
+    void stop(); // stages no more messages, drains the ring, and joins the drainer thread
+
+    bool active() const {return _active.load(std::memory_order_acquire);};
+
+    // returns false (and leaves rec untouched) if the record cannot be staged:
+    // the caller has to log it synchronously.
+    bool push(StagedLog &&rec);
+
+    // drops the oldest staged record (the DROP_OLDEST overflow policy): false if none
+    bool dropOldest();
+
+    // emits all the staged records from the calling thread (used before a FATAL message)
+    void drain();
+    
+    // returns once every record staged before the call has been sent to g3log (helping the drainer),
+    // or false if the deadline is reached first.
+    bool flush(std::chrono::steady_clock::time_point deadline);
+    
+    size_t staged() const; // records in the ring (approximate while producers are active)
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        StagedLog rec;
+    };
+
+    bool pop(StagedLog &out);
+    bool empty();
+    void wake_drainer();
+    void DrainerWorker();
+
+    std::mutex _startLck; // serializes start() and stop()
+    std::atomic<bool> _active;
+    std::atomic<int> _producers; // push(), dropOldest() and drain() calls in progress: stop() waits for them before freeing the cells
+    std::atomic<size_t> _stagedBytes;
+    size_t _maxBytes;
+    std::atomic<size_t> _sentCount; // records sent to g3log since start(), compared to _enqPos by flush()
+
+    std::unique_ptr<Cell[]> _cells;
+    size_t _mask; // capacity - 1
+    // the producers' and the consumers' positions are kept on separate cache lines
+    char _pad0[64];
+    std::atomic<size_t> _enqPos;
+    char _pad1[64];
+    std::atomic<size_t> _deqPos;
+    char _pad2[64];
+
+    // drainer thread:
+    std::atomic<bool> _terminate;
+    std::atomic<bool> _drainerSleeping;
+    std::mutex _wakeLck;
+    std::condition_variable _wakeCv;
+    std::thread _drainerThd;
+};
+
+// the unique ring, used by receivelog().
+// note: never destroyed, as it must outlive the ifaceLogWorker singleton, whatever the order of static destructions.
+StagingRing &stagingRing();
+
+} // g3
@@ -5,55 +5,163 @@
 // The objects (ex: a string) have to stay alive until the worker thread has finished using them.
 // The idea is to make a deep-copy of the data, and store them here in a global store for as long as needed.
 // When a worker thread from g3log has finished, the corresponding data can be freed.
-// This is done asynchronously, in a "cleanup-thread".
+// The sink method runs wrapped (CompletingCall): on the sink's thread, once it has returned,
+// its entry is pushed to the completed list, and the "cleanup-thread" is woken up to free it.
+// The cleanup-thread only wakes up on completion: it never polls the pending calls.
 // 
 //
 
 #include "intern_log.h"
 
-#include <chrono>
+#include <cerrno>
+#include <mutex>
+#include <stdexcept>
 #include <thread>
 
+#include <sys/eventfd.h>
+#include <unistd.h>
+
 namespace g3 {
 
+FixedBlockPool &storePool()
+{
+static FixedBlockPool *pool = new FixedBlockPool();
+return *pool;
+}
+
+void *FixedBlockPool::allocate(size_t size)
+{
+if(size > BlockSize) return ::operator new(size);
+
+std::lock_guard<std::mutex> lock(_lock);
+if(_free == nullptr) {
+    // new chunk: all its blocks go to the free-list
+    char *chunk = static_cast<char*>(::operator new(BlockSize * BlocksPerChunk));
+    _chunks.push_back(chunk);
+    for(size_t i = 0; i < BlocksPerChunk; i++) {
+        FreeBlock *block = reinterpret_cast<FreeBlock*>(chunk + i * BlockSize);
+        block -> next = _free;
+        _free = block;
+        }
+    }
+FreeBlock *block = _free;
+_free = block -> next;
+return block;
+}
+
+void FixedBlockPool::deallocate(void *p, size_t size) noexcept
+{
+if(p == nullptr) return;
+if(size > BlockSize) {
+    ::operator delete(p);
+    return;
+    }
+
+std::lock_guard<std::mutex> lock(_lock);
+FreeBlock *block = static_cast<FreeBlock*>(p);
+block -> next = _free;
+_free = block;
+}
+
+StoredIface::~StoredIface()
+{
+if(_completionFd >= 0) close(_completionFd);
+}
+
+namespace {
+void signalFd(int fd)
+{
+uint64_t one = 1;
+while(write(fd, &one, sizeof(one)) < 0 && errno == EINTR) {}
+}
+} // anonymous namespace
+
+int StoredIface::completion_fd()
+{
+std::lock_guard<std::mutex> lock(_notifyLck);
+if(_completionFd < 0) {
+    _completionFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if(_completionFd < 0) throw std::logic_error("StoredIface::completion_fd eventfd() failed");
+    if(_notified) signalFd(_completionFd); // already completed
+    }
+return _completionFd;
+}
+
+void StoredIface::notify_done()
+{
+std::lock_guard<std::mutex> lock(_notifyLck);
+_notified = true;
+if(_completionFd >= 0) signalFd(_completionFd);
+}
+
+void StoredIface::stored(ThdStore *store, std::shared_ptr<StoredIface>&& self)
+{
+_store = store;
+_self = std::move(self);
+if(_state.fetch_or(Stored, std::memory_order_acq_rel) & Finished) _store -> completed(std::move(_self)); // completed before being stored
+}
+
+void StoredIface::finished()
+{
+int prev = _state.fetch_or(Finished, std::memory_order_acq_rel);
+if(prev & Finished) return; // already completed
+notify_done();
+if(prev & Stored) _store -> completed(std::move(_self));
+}
+
+void ThdStore::store(std::shared_ptr<StoredIface>&& p_newData)
+{
+_pending.fetch_add(1, std::memory_order_relaxed);
+StoredIface &entry = *p_newData;
+entry.stored(this, std::move(p_newData));
+if(entry.has_finished() == std::future_status::ready) entry.finished(); // no call to wait for (removed sink), or already done
+}
+
+void ThdStore::completed(std::shared_ptr<StoredIface>&& p_entry)
+{
+  {
+  std::lock_guard<std::mutex> lock(_ShdLstLck);
+  _CompletedList.push_back(std::move(p_entry));
+  }
+_ShdLstCv.notify_one(); // wakes the cleanup-thread up
+}
+
 // join the cleanup-thread
 void ThdStore::sendTerm_n_join()
 {
-    terminate_thd = true;
-    // TODO: wake-up the thread faster than its timeout (enventfd ?)
-    cleanupThd.join();
+  {
+  std::lock_guard<std::mutex> lock(_ShdLstLck);
+  terminate_thd = true;
+  }
+_ShdLstCv.notify_one();
+cleanupThd.join();
 }
 
 void ThdStore::start_thread()
 {
-    cleanupThd = std::thread(&g3::ThdStore::ThdWorker, this);
+cleanupThd = std::thread(&g3::ThdStore::ThdWorker, this);
 }
 
 // cleanup thread worker function
 void ThdStore::ThdWorker()
 {
-    bool all_empty = false;
+std::unique_lock<std::mutex> lock(_ShdLstLck);
+
+for(;;) {
+    // on termination, the pending calls are still waited for
+    _ShdLstCv.wait(lock, [this]{return !_CompletedList.empty() || (terminate_thd && _pending.load(std::memory_order_relaxed) == 0);});
+    if(_CompletedList.empty()) break; // terminated, nothing left
+    
+    StoredList_t completed;
+    completed.splice(completed.end(), _CompletedList);
+    lock.unlock();
+    
+    size_t count = completed.size();
+    completed.clear(); // frees the data, out of the sink's thread
+    _pending.fetch_sub(count, std::memory_order_relaxed);
     
-    // note: after terminate_thd has been set to true, 
-    // normally no additional data will be added to the list.
-    while(!terminate_thd && !all_empty) 
-      {
-        std::this_thread::sleep_for (std::chrono::seconds(1));
-        all_empty = true; // set to false if any elements are found
-        
-        { // raii mutex lock
-        std::lock_guard<std::mutex> lock(_ShdLstLck);
-        if(_SharedList.size() > 0) { // note: size() is constant time since c++11
-            std::list<std::shared_ptr<StoredIface>>::iterator it;
-            it = _CleanupList.end();
-            _CleanupList.splice (it, _SharedList);
-            all_empty = false;
-           }
-        } // mutex
-       
-       _CleanupList.remove_if([](std::shared_ptr<StoredIface> p_data){return p_data.get() -> has_finished() == std::future_status::ready;});
-       if(_CleanupList.size() > 0) all_empty = false; // we have to wait some longer. do one more iteration.
-      }
+    lock.lock();
+  }
 }
 
 } // g3
@@ -0,0 +1,174 @@
+//
+//  timestamp source of the capture path: see timestamp.h
+//
+// The TSC conversion line (base counter value, base wall time, ns per tick) is published with a seqlock:
+// the converting threads never take a lock, one of them recalibrates every second.
+//
+
+#include "timestamp.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace g3 {
+
+std::atomic<int> clockSource{(int)ClockSource::REALTIME};
+
+namespace {
+
+struct Sample
+{
+    uint64_t ticks = 0;
+    int64_t monoNs = 0;
+    int64_t wallNs = 0;
+};
+
+int64_t clockNs(clockid_t id)
+{
+struct timespec ts;
+clock_gettime(id, &ts);
+return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// the clocks, read between two counter readings: the tightest of a few tries
+Sample sample()
+{
+Sample best;
+uint64_t bestSpan = UINT64_MAX;
+for(int i = 0; i < 5; i++) {
+    uint64_t before = readTicks();
+    int64_t mono = clockNs(CLOCK_MONOTONIC);
+    int64_t wall = clockNs(CLOCK_REALTIME);
+    uint64_t after = readTicks();
+    if(after - before < bestSpan) {
+        bestSpan = after - before;
+        best.ticks = before + (after - before) / 2;
+        best.monoNs = mono;
+        best.wallNs = wall;
+        }
+    }
+return best;
+}
+
+class TickClock
+{
+public:
+    void calibrate(); // blocks for 10 ms
+    stamp_t toStamp(uint64_t ticks);
+
+private:
+    void recalibrate(); // _lck held
+    void publish(const Sample &base, double ns_per_tick); // _lck held
+
+    std::mutex _lck;
+    Sample _origin; // the rate is measured from the first calibration (CLOCK_MONOTONIC: no wall clock steps)
+
+    std::atomic<uint32_t> _seq{0}; // odd while the line is written
+    std::atomic<uint64_t> _baseTicks{0};
+    std::atomic<int64_t> _baseNs{0};
+    std::atomic<double> _nsPerTick{0.0};
+    std::atomic<uint64_t> _nextCalibration{UINT64_MAX}; // counter value
+};
+
+TickClock &tickClock()
+{
+static TickClock *clock = new TickClock();
+return *clock;
+}
+
+void TickClock::calibrate()
+{
+std::lock_guard<std::mutex> lock(_lck);
+Sample first = sample();
+std::this_thread::sleep_for(std::chrono::milliseconds(10));
+Sample second = sample();
+_origin = first;
+publish(second, (double)(second.monoNs - first.monoNs) / (double)(second.ticks - first.ticks));
+}
+
+void TickClock::recalibrate()
+{
+Sample now = sample();
+if(now.ticks <= _origin.ticks) return;
+publish(now, (double)(now.monoNs - _origin.monoNs) / (double)(now.ticks - _origin.ticks));
+}
+
+void TickClock::publish(const Sample &base, double ns_per_tick)
+{
+uint32_t seq = _seq.load(std::memory_order_relaxed);
+_seq.store(seq + 1, std::memory_order_relaxed);
+std::atomic_thread_fence(std::memory_order_release);
+_baseTicks.store(base.ticks, std::memory_order_relaxed);
+_baseNs.store(base.wallNs, std::memory_order_relaxed);
+_nsPerTick.store(ns_per_tick, std::memory_order_relaxed);
+_seq.store(seq + 2, std::memory_order_release);
+_nextCalibration.store(base.ticks + (uint64_t)(1e9 / ns_per_tick), std::memory_order_relaxed); // 1 s later
+}
+
+stamp_t TickClock::toStamp(uint64_t ticks)
+{
+if(ticks > _nextCalibration.load(std::memory_order_relaxed) && _lck.try_lock()) {
+    if(ticks > _nextCalibration.load(std::memory_order_relaxed)) recalibrate();
+    _lck.unlock();
+    }
+
+uint64_t baseTicks;
+int64_t baseNs;
+double nsPerTick;
+for(;;) {
+    uint32_t seq = _seq.load(std::memory_order_acquire);
+    baseTicks = _baseTicks.load(std::memory_order_relaxed);
+    baseNs = _baseNs.load(std::memory_order_relaxed);
+    nsPerTick = _nsPerTick.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if((seq & 1) == 0 && _seq.load(std::memory_order_relaxed) == seq) break;
+    std::this_thread::yield();
+  }
+// a record may have been read before the base: signed difference
+int64_t ns = baseNs + (int64_t)((double)(int64_t)(ticks - baseTicks) * nsPerTick);
+return stamp_t(std::chrono::duration_cast<stamp_t::duration>(std::chrono::nanoseconds(ns)));
+}
+
+} // anonymous namespace
+
+bool tscAvailable()
+{
+#if defined(__x86_64__) || defined(__i386__)
+unsigned int eax, ebx, ecx, edx;
+if(!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) return false;
+return (edx & (1u << 8)) != 0; // invariant TSC: constant rate, in every power state
+#elif defined(__aarch64__)
+return true; // the generic timer
+#else
+return false;
+#endif
+}
+
+void setClockSource(int source)
+{
+if(source < (int)ClockSource::REALTIME || source > (int)ClockSource::TSC) throw std::logic_error("setClockSource: invalid clock source");
+if(source == (int)ClockSource::TSC) {
+    if(!tscAvailable()) throw std::logic_error("setClockSource: no invariant TSC on this machine (g3CLOCK_REALTIME_COARSE is the other cheap source)");
+    tickClock().calibrate(); // before the first reading
+    }
+clockSource.store(source, std::memory_order_relaxed);
+}
+
+int getClockSource()
+{
+return clockSource.load(std::memory_order_relaxed);
+}
+
+stamp_t ticksToStamp(uint64_t ticks)
+{
+return tickClock().toStamp(ticks);
+}
+
+} // g3
@@ -0,0 +1,91 @@
+/*
+
+  Timestamp source of the capture path.
+
+  Each record gets its time on the caller's thread. The source is selected with setClockSource():
+    - REALTIME (default): g3log's clock (clock_gettime(CLOCK_REALTIME) through std::chrono).
+    - REALTIME_COARSE: CLOCK_REALTIME_COARSE, read from the vDSO without a clock device access:
+      resolution of the kernel tick (1 to 4 ms).
+    - TSC: a raw read of the CPU's counter (rdtsc on x86, cntvct_el0 on aarch64), converted to wall time
+      when the LogMessage is built (by the drainer thread when the staging is started).
+      The counter is calibrated against CLOCK_MONOTONIC when the source is selected (10 ms), then again
+      every second, and anchored to CLOCK_REALTIME: the times are exact within a few microseconds,
+      and follow the adjustments of the wall clock within a second. Only available with an invariant TSC on x86.
+  receivelog_batch() reads the clock once for the whole batch, whatever the source.
+  The sinks always get regular wall-clock times.
+
+*/
+
+#pragma once
+
+#include <g3log/logmessage.hpp>
+
+#include <atomic>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <time.h>
+
+namespace g3 {
+
+// timestamp type used by g3log's messages
+using stamp_t = decltype(g3::LogMessage::_timestamp);
+
+enum class ClockSource {REALTIME = 0, REALTIME_COARSE = 1, TSC = 2};
+
+// throws if the source is invalid, or not available on this machine (TSC)
+void setClockSource(int source);
+int getClockSource();
+bool tscAvailable();
+
+extern std::atomic<int> clockSource; // a ClockSource
+
+// the time of a record, as read on the capture path
+struct CaptureTime
+{
+    CaptureTime() = default;
+    CaptureTime(stamp_t stamp_): stamp(stamp_) {};
+    stamp_t stamp;
+    uint64_t ticks = 0; // TSC source: the raw counter (the stamp is not set), converted by wallTime()
+};
+
+inline uint64_t readTicks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+return __rdtsc();
+#elif defined(__aarch64__)
+uint64_t ticks;
+asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+return ticks;
+#else
+return 0;
+#endif
+}
+
+inline stamp_t coarseNow()
+{
+struct timespec ts;
+clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+return stamp_t(std::chrono::duration_cast<stamp_t::duration>(std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec)));
+}
+
+// the single clock read of the capture path
+inline CaptureTime captureNow()
+{
+CaptureTime now;
+switch(clockSource.load(std::memory_order_relaxed)) {
+    case (int)ClockSource::REALTIME_COARSE: now.stamp = coarseNow(); break;
+    case (int)ClockSource::TSC: now.ticks = readTicks(); break;
+    default: now.stamp = stamp_t::clock::now(); break;
+    }
+return now;
+}
+
+// the wall time of a record (converts the TSC readings)
+stamp_t ticksToStamp(uint64_t ticks);
+inline stamp_t wallTime(const CaptureTime &time) {return (time.ticks != 0) ? ticksToStamp(time.ticks) : time.stamp;}
+
+} // g3
@@ -1,6 +1,14 @@
 
 #include "intern_log.h"
 #include "g3logPython.h"
+#include "overflow.h"
+#include "ratelimit.h"
+#include "shmring.h"
+#include "staging.h"
+
+#include <csignal>
+
+#include <pthread.h>
 
 namespace g3 {
     
@@ -40,6 +48,166 @@ _instance.lock() -> worker = g3::LogWorker::createLogWorker();
 g3::initializeLogging(_instance.lock() -> worker.get());
 }
    
+ifaceLogWorker::~ifaceLogWorker()
+{
+// the staged messages, and the children's, must reach the LogWorker before it is destroyed
+rateLimiter().flushSummaries(true);
+sharedRing().stop();
+stagingRing().stop();
+}
+
+void ifaceLogWorker::startStaging(size_t capacity, size_t max_bytes)
+{
+checkNotRingChild("startStaging");
+stagingRing().start(capacity, max_bytes);
+}
+
+void ifaceLogWorker::stopStaging()
+{
+if(sharedRing().attached()) return; // the drainer thread is the parent's
+stagingRing().stop();
+}
+
+void ifaceLogWorker::setCaptureLimit(size_t capacity, int overflow, int block_timeout_ms)
+{
+checkNotRingChild("setCaptureLimit");
+captureLimit().set(capacity, overflow, block_timeout_ms);
+}
+
+namespace {
+
+// the crash handlers of g3log, installed with the LogWorker (see ifaceLogWorker::atforkChild)
+const int CrashSignals[] = {SIGABRT, SIGFPE, SIGILL, SIGSEGV, SIGTERM};
+struct sigaction crashActions[sizeof(CrashSignals) / sizeof(CrashSignals[0])];
+
+// no other thread holds the registries' mutexes while forking
+void atforkPrepare()
+{
+callSites().lockAll();
+rateLimiter().lockAll();
+}
+
+void atforkParent()
+{
+rateLimiter().unlockAll();
+callSites().unlockAll();
+}
+
+} // anonymous namespace
+
+void ifaceLogWorker::atforkChild()
+{
+rateLimiter().unlockAll();
+callSites().unlockAll();
+sharedRing().attachChild();
+if(!sharedRing().attached()) return;
+
+// the LogWorker and sink threads don't exist in the child: the interface must never be destroyed there
+std::shared_ptr<ifaceLogWorker> instance = singleton._instance.lock();
+if(instance) new std::shared_ptr<ifaceLogWorker>(std::move(instance)); // leaked
+// g3log's crash handler would wait for the LogWorker forever: the default handlers are restored
+// (unless the program installed its own since)
+for(size_t i = 0; i < sizeof(CrashSignals) / sizeof(CrashSignals[0]); i++) {
+    struct sigaction current;
+    if(sigaction(CrashSignals[i], nullptr, &current) != 0) continue;
+    if((current.sa_flags & SA_SIGINFO) && (crashActions[i].sa_flags & SA_SIGINFO) && current.sa_sigaction == crashActions[i].sa_sigaction) 
+        signal(CrashSignals[i], SIG_DFL);
+    }
+}
+
+void ifaceLogWorker::startSharedRing(size_t capacity, int full_wait_ms)
+{
+sharedRing().start(capacity, full_wait_ms);
+
+static std::once_flag atforkFlag;
+std::call_once(atforkFlag, []{
+    for(size_t i = 0; i < sizeof(CrashSignals) / sizeof(CrashSignals[0]); i++) sigaction(CrashSignals[i], nullptr, &crashActions[i]);
+    pthread_atfork(&atforkPrepare, &atforkParent, &ifaceLogWorker::atforkChild);
+    });
+}
+
+void ifaceLogWorker::stopSharedRing()
+{
+sharedRing().stop();
+}
+
+LoggerStats ifaceLogWorker::stats()
+{
+CaptureMetrics &capture = captureMetrics();
+LoggerStats out;
+for(int level = 0; level < CaptureMetrics::NumLevels; level++) out.captured.push_back(capture.captured[level].sum());
+out.capturedInvalid = capture.captured[CaptureMetrics::NumLevels].sum();
+out.filtered = capture.filtered.sum();
+out.rateLimited = rateLimiter().dropped();
+out.sent = capture.sent.sum();
+out.staged = stagingRing().active() ? stagingRing().staged() : 0;
+out.storePending = Store.pending();
+out.sharedRing = sharedRing().stats();
+if(out.sharedRing.attached) { // the sinks live in the parent
+    out.staged = 0;
+    out.queueHighWater = 0;
+    return out;
+    }
+out.overflow = captureLimit().stats();
+
+SysLogSinks.collectStats("syslog", out.sinks);
+LogRotateSinks.collectStats("logrotate", out.sinks);
+ClrTermSinks.collectStats("colorterm", out.sinks);
+BinSinks.collectStats("binary", out.sinks);
+JournaldSinks.collectStats("journald", out.sinks);
+NetSinks.collectStats("net", out.sinks);
+PluginSinks.collectStats("plugin", out.sinks);
+FlightRecSinks.collectStats("flightrec", out.sinks);
+out.queueHighWater = 0;
+for(auto &sink: out.sinks) if(sink.queueHighWater > out.queueHighWater) out.queueHighWater = sink.queueHighWater;
+return out;
+}
+
+bool ifaceLogWorker::flush(double timeout)
+{
+auto deadline = std::chrono::steady_clock::now() + 
+    std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(timeout < 0 ? 365.0 * 24 * 3600 : timeout));
+if(rateLimiter().active()) rateLimiter().flushSummaries(true); // the call-sites gone quiet
+
+// a child process: its records are handed to the parent (see shmring.h)
+if(sharedRing().attached()) return sharedRing().flush(deadline);
+
+// the staged messages first, and the records of the children read so far: the barrier must follow them
+if(!stagingRing().flush(deadline)) return false;
+if(sharedRing().active() && !sharedRing().flush(deadline)) return false;
+
+int expected = _sinkCount.load();
+if(expected == 0) return true;
+
+uint64_t barrier_id;
+std::shared_ptr<FlushBarrier> barrier = pushFlushBarrier(expected, barrier_id);
+bool reached = barrier -> wait_until(deadline);
+releaseFlushBarrier(barrier_id);
+return reached;
+}
+
+void ifaceLogWorker::dumpFlightRecorders()
+{
+std::shared_ptr<ifaceLogWorker> pworker = singleton._instance.lock();
+if(!pworker) return;
+auto recorders = pworker -> FlightRecSinks._g3logPtrs.options();
+if(recorders.empty()) return;
+auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+
+pworker -> flush(1.0); // the recorders get the messages preceding the FATAL (on timeout: those received so far)
+for(auto &recorder: recorders) {
+    std::future<void> done;
+      { // raii mutex locking with access()
+        try {
+            g3::LockedObj<g3::SinkHandle<g3::FlightRecorderSink> *> MtxPtr = pworker -> FlightRecSinks._g3logPtrs.access(recorder.first);
+            done = MtxPtr.p_hndl -> call(&g3::FlightRecorderSink::fatalDump);
+            }
+        catch(...) {continue;} // removed meanwhile
+      }
+    done.wait_until(deadline); // its dump sink writes the dump before the FATAL message, whatever the timeout
+    }
+}
+   
 /*    
 template< class g3logSinkCls, typename ClbkType, ClbkType g3logMsgMvr, class pySinkCls>
 g3::SinkHandle<g3logSinkCls> * 
@@ -64,53 +232,64 @@ Ptr_Mnger::done(sinkkey_t key)
 }
 */
 
+template< class g3logSinkCls, typename ClbkType, ClbkType g3logMsgMvr, class pySinkCls>
+typename ifaceLogWorker::SinkHndlAccess<g3logSinkCls, ClbkType, g3logMsgMvr, pySinkCls>::Ptr_Mnger::Slot *
+ifaceLogWorker::SinkHndlAccess<g3logSinkCls, ClbkType, g3logMsgMvr, pySinkCls>::
+Ptr_Mnger::find(sinkkey_t key)
+{
+size_t index = (key & ((1u << SinkKeyIndexBits) - 1));
+if(index == 0 || index > _slots.size()) return nullptr;
+Slot &slot = _slots[index - 1];
+if(slot.generation != (key >> SinkKeyIndexBits) || slot.entry.hndl == nullptr) return nullptr;
+return &slot;
+}
+
 template< class g3logSinkCls, typename ClbkType, ClbkType g3logMsgMvr, class pySinkCls>
 g3::LockedObj<g3::SinkHandle<g3logSinkCls> *>
 g3::ifaceLogWorker::SinkHndlAccess<g3logSinkCls, ClbkType, g3logMsgMvr, pySinkCls>::
 Ptr_Mnger::access(sinkkey_t key)
 {
-g3::LockedObj<g3::SinkHandle<g3logSinkCls> *> LockedPtr(_lock);
-  auto search = _key_to_uniquePtr.find(key);
-  if (search == _key_to_uniquePtr.end()) throw std::logic_error("Ptr_Mnger::access element not in map");
-  g3::SinkHandle<g3logSinkCls> *naked = search->second.get();
-  if(naked == NULL)  throw std::logic_error("Ptr_Mnger::access null in map");
-  LockedPtr.p_hndl = naked;
+checkNotRingChild("sink handle");
+g3::LockedObj<g3::SinkHandle<g3logSinkCls> *> LockedPtr(_lock); // shared
+  Slot *slot = find(key);
+  if(slot == nullptr) throw std::logic_error("Ptr_Mnger::access unknown or stale key");
+  LockedPtr.p_hndl = slot -> entry.hndl.get();
 return LockedPtr; // moved
 }
    
 template< class g3logSinkCls, typename ClbkType, ClbkType g3logMsgMvr, class pySinkCls>
 sinkkey_t 
 ifaceLogWorker::SinkHndlAccess<g3logSinkCls, ClbkType, g3logMsgMvr, pySinkCls>::
-Ptr_Mnger::insert(std::unique_ptr<g3::SinkHandle<g3logSinkCls>> g3logHandle)
+Ptr_Mnger::insert(std::unique_ptr<g3::SinkHandle<g3logSinkCls>> g3logHandle, std::list<std::string> &&ctorStrings, std::shared_ptr<SinkOptions> options)
 {
-sinkkey_t newkey;
+if(g3logHandle == nullptr) throw std::logic_error("Ptr_Mnger::insert null handle");
 
-  { // raii mutex scope
-      std::lock_guard<std::mutex> raiiLock(_lock); // https://en.cppreference.com/w/cpp/thread/scoped_lock
-      // https://en.cppreference.com/w/cpp/container/set :
-      if(_free.empty()) {
-          // generate a new key
-          if(_in_use.empty()){
-              // its our first key
-              newkey = 1;
-            } else {
-              // get the value of the last key inserted
-              auto lastkey = _in_use.end();
-              newkey = 1 + (*lastkey);
-            }
-          _in_use.insert(newkey);
-        } else {
-          // reuse a previously-used key
-          auto freekey = _free.end();
-          newkey = *freekey;
-          _free.erase(freekey);
-        }
-      _key_to_uniquePtr.insert({newkey,std::move(g3logHandle) });
-    } // end of RAII mutex scope
-        
-return newkey;
+std::lock_guard<std::shared_timed_mutex> raiiLock(_lock);
+if(_slots.size() >= (1u << SinkKeyIndexBits) - 1) throw std::logic_error("Ptr_Mnger::insert too many sinks");
+_slots.emplace_back();
+size_t index = _slots.size() - 1;
+Slot &slot = _slots[index];
+slot.entry.hndl = std::move(g3logHandle);
+slot.entry.ctorStrings = std::move(ctorStrings);
+slot.entry.options = std::move(options);
+return (slot.generation << SinkKeyIndexBits) | (sinkkey_t)(index + 1);
 }
-   
+
+template< class g3logSinkCls, typename ClbkType, ClbkType g3logMsgMvr, class pySinkCls>
+std::vector<std::pair<sinkkey_t, std::shared_ptr<SinkOptions>>>
+ifaceLogWorker::SinkHndlAccess<g3logSinkCls, ClbkType, g3logMsgMvr, pySinkCls>::
+Ptr_Mnger::options()
+{
+std::shared_lock<std::shared_timed_mutex> raiiLock(_lock);
+std::vector<std::pair<sinkkey_t, std::shared_ptr<SinkOptions>>> out;
+for(size_t index = 0; index < _slots.size(); index++) {
+    const Slot &slot = _slots[index];
+    if(slot.entry.hndl == nullptr) continue;
+    out.emplace_back((slot.generation << SinkKeyIndexBits) | (sinkkey_t)(index + 1), slot.entry.options);
+    }
+return out;
+}
+
 template< class g3logSinkCls, typename ClbkType, ClbkType g3logMsgMvr, class pySinkCls>
 bool 
 ifaceLogWorker::SinkHndlAccess<g3logSinkCls, ClbkType, g3logMsgMvr, pySinkCls>::
@@ -150,6 +329,43 @@ Name_Mnger::get_size()
       return _name_to_key.size();
   }
 }
+
+template< class g3logSinkCls, typename ClbkType, ClbkType g3logMsgMvr, class pySinkCls>
+std::map<sinkkey_t, std::string> 
+ifaceLogWorker::SinkHndlAccess<g3logSinkCls, ClbkType, g3logMsgMvr, pySinkCls>::
+Name_Mnger::names()
+{
+  std::map<sinkkey_t, std::string> out;
+  { // raii mutex scope
+      std::lock_guard<std::mutex> raiiLock(_lock); 
+      for(auto &entry: _name_to_key) out[entry.second] = entry.first;
+  }
+  return out;
+}
+
+template< class g3logSinkCls, typename ClbkType, ClbkType g3logMsgMvr, class pySinkCls>
+void 
+ifaceLogWorker::SinkHndlAccess<g3logSinkCls, ClbkType, g3logMsgMvr, pySinkCls>::
+collectStats(const char *type, std::vector<SinkStats> &out)
+{
+std::map<sinkkey_t, std::string> names = _userNames.names();
+for(auto &sink: _g3logPtrs.options()) {
+    const SinkMetrics &metrics = sink.second -> metrics;
+    SinkStats stats;
+    stats.type = type;
+    auto name = names.find(sink.first);
+    if(name != names.end()) stats.name = name -> second;
+    stats.messages = metrics.messages.load(std::memory_order_relaxed);
+    stats.filtered = metrics.filtered.load(std::memory_order_relaxed);
+    stats.sharedLines = metrics.sharedLines.load(std::memory_order_relaxed);
+    stats.queueDepth = metrics.queueDepth();
+    stats.queueHighWater = metrics.queueHighWater.load(std::memory_order_relaxed);
+    stats.latencyCount = metrics.latency.count();
+    stats.latencySumNs = metrics.latency.sumNs();
+    stats.latencyBuckets = metrics.latency.cumulative();
+    out.push_back(std::move(stats));
+    }
+}
   
 //
 // explicit instantiations: (see also sinks.cpp)
@@ -161,21 +377,23 @@ Name_Mnger::get_size()
 //template g3::SinkHandle<g3::SyslogSink> * ifaceLogWorker::SysLogSinkIface_t::Ptr_Mnger::accessTOREPLACE(sinkkey_t key);
 template g3::LockedObj<g3::SinkHandle<g3::SyslogSink> *> ifaceLogWorker::SysLogSinkIface_t::Ptr_Mnger::access(sinkkey_t key);
 
-template sinkkey_t ifaceLogWorker::SysLogSinkIface_t::Ptr_Mnger::insert(std::unique_ptr<g3::SinkHandle<g3::SyslogSink>>);
+template sinkkey_t ifaceLogWorker::SysLogSinkIface_t::Ptr_Mnger::insert(std::unique_ptr<g3::SinkHandle<g3::SyslogSink>>, std::list<std::string> &&, std::shared_ptr<SinkOptions>);
 template bool      ifaceLogWorker::SysLogSinkIface_t::Name_Mnger::reserve(const std::string& name);
 template void      ifaceLogWorker::SysLogSinkIface_t::Name_Mnger::set_key(const std::string& name, sinkkey_t key);
 template size_t    ifaceLogWorker::SysLogSinkIface_t::Name_Mnger::get_size();
+template void      ifaceLogWorker::SysLogSinkIface_t::collectStats(const char *type, std::vector<SinkStats> &out);
 
 // explicit instantiation of LogRotate:
   
 // template void ifaceLogWorker::LogRotateSinkIface_t::Ptr_Mnger::done(sinkkey_t key);
 //template g3::SinkHandle<LogRotate> * ifaceLogWorker::LogRotateSinkIface_t::Ptr_Mnger::accessTOREPLACE(sinkkey_t key);
-template g3::LockedObj<g3::SinkHandle<LogRotate> *> ifaceLogWorker::LogRotateSinkIface_t::Ptr_Mnger::access(sinkkey_t key);
+template g3::LockedObj<g3::SinkHandle<g3::RotatingLogFile> *> ifaceLogWorker::LogRotateSinkIface_t::Ptr_Mnger::access(sinkkey_t key);
 
-template sinkkey_t ifaceLogWorker::LogRotateSinkIface_t::Ptr_Mnger::insert(std::unique_ptr<g3::SinkHandle<LogRotate>>);
+template sinkkey_t ifaceLogWorker::LogRotateSinkIface_t::Ptr_Mnger::insert(std::unique_ptr<g3::SinkHandle<g3::RotatingLogFile>>, std::list<std::string> &&, std::shared_ptr<SinkOptions>);
 template bool      ifaceLogWorker::LogRotateSinkIface_t::Name_Mnger::reserve(const std::string& name);
 template void      ifaceLogWorker::LogRotateSinkIface_t::Name_Mnger::set_key(const std::string& name, sinkkey_t key);
 template size_t    ifaceLogWorker::LogRotateSinkIface_t::Name_Mnger::get_size();
+template void      ifaceLogWorker::LogRotateSinkIface_t::collectStats(const char *type, std::vector<SinkStats> &out);
 
 // explicit instantiation of ColorTerm:
 
@@ -183,9 +401,60 @@ template size_t    ifaceLogWorker::LogRotateSinkIface_t::Name_Mnger::get_size();
 //template g3::SinkHandle<g3::ColorTermSink> * ifaceLogWorker::ClrTermSinkIface_t::Ptr_Mnger::accessTOREPLACE(sinkkey_t key);
 template g3::LockedObj<g3::SinkHandle<g3::ColorTermSink> *> ifaceLogWorker::ClrTermSinkIface_t::Ptr_Mnger::access(sinkkey_t key);
 
-template sinkkey_t ifaceLogWorker::ClrTermSinkIface_t::Ptr_Mnger::insert(std::unique_ptr<g3::SinkHandle<g3::ColorTermSink>>);
+template sinkkey_t ifaceLogWorker::ClrTermSinkIface_t::Ptr_Mnger::insert(std::unique_ptr<g3::SinkHandle<g3::ColorTermSink>>, std::list<std::string> &&, std::shared_ptr<SinkOptions>);
 template bool      ifaceLogWorker::ClrTermSinkIface_t::Name_Mnger::reserve(const std::string& name);
 template void      ifaceLogWorker::ClrTermSinkIface_t::Name_Mnger::set_key(const std::string& name, sinkkey_t key);
 template size_t    ifaceLogWorker::ClrTermSinkIface_t::Name_Mnger::get_size();
+template void      ifaceLogWorker::ClrTermSinkIface_t::collectStats(const char *type, std::vector<SinkStats> &out);
+
+// explicit instantiation of Binary:
+
+template g3::LockedObj<g3::SinkHandle<g3::BinarySink> *> ifaceLogWorker::BinSinkIface_t::Ptr_Mnger::access(sinkkey_t key);
+
+template sinkkey_t ifaceLogWorker::BinSinkIface_t::Ptr_Mnger::insert(std::unique_ptr<g3::SinkHandle<g3::BinarySink>>, std::list<std::string> &&, std::shared_ptr<SinkOptions>);
+template bool      ifaceLogWorker::BinSinkIface_t::Name_Mnger::reserve(const std::string& name);
+template void      ifaceLogWorker::BinSinkIface_t::Name_Mnger::set_key(const std::string& name, sinkkey_t key);
+template size_t    ifaceLogWorker::BinSinkIface_t::Name_Mnger::get_size();
+template void      ifaceLogWorker::BinSinkIface_t::collectStats(const char *type, std::vector<SinkStats> &out);
+
+// explicit instantiation of Journald:
+
+template g3::LockedObj<g3::SinkHandle<g3::JournaldSink> *> ifaceLogWorker::JournaldSinkIface_t::Ptr_Mnger::access(sinkkey_t key);
+
+template sinkkey_t ifaceLogWorker::JournaldSinkIface_t::Ptr_Mnger::insert(std::unique_ptr<g3::SinkHandle<g3::JournaldSink>>, std::list<std::string> &&, std::shared_ptr<SinkOptions>);
+template bool      ifaceLogWorker::JournaldSinkIface_t::Name_Mnger::reserve(const std::string& name);
+template void      ifaceLogWorker::JournaldSinkIface_t::Name_Mnger::set_key(const std::string& name, sinkkey_t key);
+template size_t    ifaceLogWorker::JournaldSinkIface_t::Name_Mnger::get_size();
+template void      ifaceLogWorker::JournaldSinkIface_t::collectStats(const char *type, std::vector<SinkStats> &out);
+
+// explicit instantiation of Net:
+
+template g3::LockedObj<g3::SinkHandle<g3::NetSink> *> ifaceLogWorker::NetSinkIface_t::Ptr_Mnger::access(sinkkey_t key);
+
+template sinkkey_t ifaceLogWorker::NetSinkIface_t::Ptr_Mnger::insert(std::unique_ptr<g3::SinkHandle<g3::NetSink>>, std::list<std::string> &&, std::shared_ptr<SinkOptions>);
+template bool      ifaceLogWorker::NetSinkIface_t::Name_Mnger::reserve(const std::string& name);
+template void      ifaceLogWorker::NetSinkIface_t::Name_Mnger::set_key(const std::string& name, sinkkey_t key);
+template size_t    ifaceLogWorker::NetSinkIface_t::Name_Mnger::get_size();
+template void      ifaceLogWorker::NetSinkIface_t::collectStats(const char *type, std::vector<SinkStats> &out);
+
+// explicit instantiation of Plugin:
+
+template g3::LockedObj<g3::SinkHandle<g3::PluginSink> *> ifaceLogWorker::PluginSinkIface_t::Ptr_Mnger::access(sinkkey_t key);
+
+template sinkkey_t ifaceLogWorker::PluginSinkIface_t::Ptr_Mnger::insert(std::unique_ptr<g3::SinkHandle<g3::PluginSink>>, std::list<std::string> &&, std::shared_ptr<SinkOptions>);
+template bool      ifaceLogWorker::PluginSinkIface_t::Name_Mnger::reserve(const std::string& name);
+template void      ifaceLogWorker::PluginSinkIface_t::Name_Mnger::set_key(const std::string& name, sinkkey_t key);
+template size_t    ifaceLogWorker::PluginSinkIface_t::Name_Mnger::get_size();
+template void      ifaceLogWorker::PluginSinkIface_t::collectStats(const char *type, std::vector<SinkStats> &out);
+
+// explicit instantiation of FlightRec:
+
+template g3::LockedObj<g3::SinkHandle<g3::FlightRecorderSink> *> ifaceLogWorker::FlightRecSinkIface_t::Ptr_Mnger::access(sinkkey_t key);
+
+template sinkkey_t ifaceLogWorker::FlightRecSinkIface_t::Ptr_Mnger::insert(std::unique_ptr<g3::SinkHandle<g3::FlightRecorderSink>>, std::list<std::string> &&, std::shared_ptr<SinkOptions>);
+template bool      ifaceLogWorker::FlightRecSinkIface_t::Name_Mnger::reserve(const std::string& name);
+template void      ifaceLogWorker::FlightRecSinkIface_t::Name_Mnger::set_key(const std::string& name, sinkkey_t key);
+template size_t    ifaceLogWorker::FlightRecSinkIface_t::Name_Mnger::get_size();
+template void      ifaceLogWorker::FlightRecSinkIface_t::collectStats(const char *type, std::vector<SinkStats> &out);
 
 } // g3
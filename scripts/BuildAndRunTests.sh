@@ -18,6 +18,33 @@ cd Tests
 # TODO : add valgrind here
 #valgrind --error-exitcode=1 --suppressions=/usr/share/doc/python3-devel/valgrind-python.supp python3 ./valgrind_journald.py
 ./WARNING_bad_level.py
+./level_threshold.py
+./staging_threads.py
+./batch.py
+./message_types.py
+./callsite_ids.py
+./deferred_format.py
+./sink_reconfigure.py
+./colorterm_buffered.py
+./sink_handles_threads.py
+./sink_results_asyncio.py
+./flush_barrier.py
+./binary_sink.py
+./structured_fields.py
+./rate_limit.py
+./stats.py
+./journald_native.py
+./shared_ring.py
+./logging_handler.py
+./sink_filters.py
+./shared_render.py
+./net_sink.py
+./plugin_sink.py
+./capture_limit.py
+./clock_source.py
+./logrotate_background.py
+./flight_recorder.py
+./context.py
 ./EXCEPT_same_name_Error.py
 ./EXCEPT_journal_Sink_type_twice.py
 ./Fatal.py || { echo "ERROR return value"; true; }
@@ -43,7 +43,7 @@ else:
 ext_modules = [
     setuptools.Extension(
         '_g3logPython',
-        ['g3logPython/store.cpp', 'g3logPython/ColorTermSink.cpp', 'g3logPython/g3logPython.cpp', 'g3logPython/sinks.cpp', 'g3logPython/worker.cpp', 'g3logPython/log.cpp'],
+        ['g3logPython/store.cpp', 'g3logPython/ColorTermSink.cpp', 'g3logPython/g3logPython.cpp', 'g3logPython/sinks.cpp', 'g3logPython/worker.cpp', 'g3logPython/log.cpp', 'g3logPython/staging.cpp', 'g3logPython/callsites.cpp', 'g3logPython/format.cpp', 'g3logPython/dispatch.cpp', 'g3logPython/BinarySink.cpp', 'g3logPython/fields.cpp', 'g3logPython/ratelimit.cpp', 'g3logPython/metrics.cpp', 'g3logPython/JournaldSink.cpp', 'g3logPython/shmring.cpp', 'g3logPython/render.cpp', 'g3logPython/NetSink.cpp', 'g3logPython/plugin.cpp', 'g3logPython/overflow.cpp', 'g3logPython/timestamp.cpp', 'g3logPython/RotatingLogFile.cpp', 'g3logPython/FlightRecorderSink.cpp', 'g3logPython/context.cpp'],
         include_dirs=[
             # Path to pybind11 headers
             get_pybind_include(),
@@ -51,7 +51,7 @@ ext_modules = [
             '/usr/local/lib',
             '/usr/local/include/',
         ],
-        libraries=['stdc++','g3logger','g3logrotate','g3log_syslog'],
+        libraries=['stdc++','g3logger','g3logrotate','g3log_syslog','systemd','z'],
         extra_compile_args=compile_args,
         extra_link_args=link_args,
         language='c++'
@@ -67,6 +67,7 @@ setuptools.setup(
     description='python bindings for g3log',
     long_description=long_description,
     packages=setuptools.find_packages(),
+    package_data={'g3logPython': ['*.h']}, # plugin.h and its includes, for the sink plugins
     ext_modules=ext_modules,
     python_requires='>=3.6',
     install_requires=['pybind11>=2.2'],